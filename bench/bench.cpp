@@ -0,0 +1,691 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "search.h"
+#include "search_state.h"
+#include "stats.h"
+#include "sudoku.h"
+#include "validator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  //the number of heap allocations so far, counted by the operator new below
+  std::atomic<std::size_t> allocations(0);
+}
+
+void* operator new(std::size_t size)
+{
+  allocations++;
+
+  void* block = std::malloc((size != 0) ? size : 1);
+
+  if (block == 0)
+  {
+    throw std::bad_alloc();
+  }
+
+  return block;
+}
+
+void operator delete(void* block) noexcept
+{
+  std::free(block);
+}
+
+/**
+ * @brief The solvers that the bench can measure
+ **/
+enum Backend
+{
+  /**
+   * @brief Sudoku::solve(), which uses the kernels that are specialized for 4*4, 9*9, 16*16 and
+   *        25*25 boards.
+   **/
+  BACKEND_COLOR,
+  /**
+   * @brief The same colorability search, but always on the general SearchState, to show what the
+   *        specialized kernels are worth.
+   **/
+  BACKEND_GENERAL,
+  /**
+   * @brief Sudoku::solve_dlx_style().
+   **/
+  BACKEND_DLX,
+  /**
+   * @brief Sudoku::solve_bruteforce_style().
+   **/
+  BACKEND_BRUTE,
+  /**
+   * @brief Sudoku::solve_bitboard_style(), which is only run on corpora of 9*9 boards.
+   **/
+  BACKEND_BITBOARD
+};
+
+/**
+ * @brief The names of the backends, as they are given on the command line and in the report
+ **/
+static char const* const backend_names[] = { "color", "general", "dlx", "brute",
+                                                   "bitboard" };
+
+/**
+ * @brief The puzzles of one corpus file, which are read into memory before anything is measured
+ **/
+struct Corpus
+{
+  /**
+   * @brief The path of the file.
+   **/
+  std::string path;
+  /**
+   * @brief The whole file.
+   **/
+  std::string text;
+  /**
+   * @brief Where every puzzle that could be read starts in the text.
+   **/
+  std::vector<std::size_t> offsets;
+  /**
+   * @brief How many characters every puzzle that could be read takes up.
+   **/
+  std::vector<std::size_t> lengths;
+  /**
+   * @brief Every puzzle that could be read, as it was read (so the clues can be checked against
+   *        the solutions).
+   **/
+  std::vector<Grid> puzzles;
+  /**
+   * @brief The most unknowns that any of the puzzles has.
+   **/
+  std::size_t max_unknowns;
+  /**
+   * @brief Whether every puzzle is 9*9.
+   **/
+  bool all_9x9;
+};
+
+/**
+ * @brief What one backend did on one corpus
+ **/
+struct Result
+{
+  Result() : backend(BACKEND_COLOR), skipped(false), passes(0), solved(0), puzzles_per_sec(0),
+    p50_us(0), p99_us(0), nodes_per_puzzle(0), allocations_per_puzzle(0) {}
+
+  /**
+   * @brief The backend.
+   **/
+  Backend backend;
+  /**
+   * @brief Whether the backend was not run, because the puzzles have too many unknowns for it (or
+   *        aren't 9*9, for the bitboard solver).
+   **/
+  bool skipped;
+  /**
+   * @brief The number of times the corpus was solved (not counting the warm-up).
+   **/
+  std::size_t passes;
+  /**
+   * @brief The number of puzzles that were solved correctly in the last pass.
+   **/
+  std::size_t solved;
+  /**
+   * @brief The number of puzzles that were read and solved every second.
+   **/
+  double puzzles_per_sec;
+  /**
+   * @brief The median time it took to read and solve a puzzle, in microseconds.
+   **/
+  double p50_us;
+  /**
+   * @brief The 99th percentile of the time it took to read and solve a puzzle, in microseconds.
+   **/
+  double p99_us;
+  /**
+   * @brief The average number of search nodes a puzzle took (see SearchStats::nodes).
+   **/
+  double nodes_per_puzzle;
+  /**
+   * @brief The average number of heap allocations a puzzle took, once the solver had warmed up.
+   **/
+  double allocations_per_puzzle;
+};
+
+/**
+ * @brief A colorability search on the general SearchState that is reused for every puzzle, just
+ *        like the one that Sudoku keeps for the sizes without a specialized kernel
+ **/
+struct GeneralSearch
+{
+  GeneralSearch() : solution(0), search(state) {}
+
+  /**
+   * @brief The last solution, so that it can be checked.
+   **/
+  Grid solution;
+  /**
+   * @brief The state, which is reloaded for every puzzle.
+   **/
+  SearchState state;
+  /**
+   * @brief The search over the state.
+   **/
+  Search search;
+};
+
+/**
+ * @brief Explain how the program should be run.
+ *
+ * @param program The name of the program.
+ **/
+static void usage(char const* program)
+{
+  std::cerr << "usage: " << program << " [--json] [--backends LIST] [--min-time SECONDS]"
+            << std::endl
+            << "           [--brute-max-unknowns N] CORPUS..." << std::endl
+            << std::endl
+            << "Solve every puzzle of every CORPUS with every backend, and report how fast it went."
+            << std::endl
+            << std::endl
+            << "  --json                the report in JSON instead of a table" << std::endl
+            << "  --backends            a comma-separated list of color, general, dlx, brute and"
+            << std::endl
+            << "                        bitboard" << std::endl
+            << "                        (defaults to all of them)" << std::endl
+            << "  --min-time            how long every backend should keep solving a corpus"
+            << std::endl
+            << "                        (defaults to 0.5)" << std::endl
+            << "  --brute-max-unknowns  skip brute force on corpora with puzzles that have more"
+            << std::endl
+            << "                        unknowns than this (defaults to 50)" << std::endl;
+}
+
+/**
+ * @brief Read a corpus file into memory, and find every puzzle in it.
+ *
+ * @param path The path of the file.
+ * @param corpus Overwritten with the corpus.
+ * @return bool Whether the file could be opened.
+ **/
+static bool read_corpus(char const* path, Corpus& corpus)
+{
+  std::ifstream file(path);
+
+  if (!file)
+  {
+    return false;
+  }
+
+  std::ostringstream text;
+  text << file.rdbuf();
+
+  corpus.path = path;
+  corpus.text = text.str();
+  corpus.max_unknowns = 0;
+  corpus.all_9x9 = true;
+
+  Sudoku sudoku;
+  std::size_t offset = 0;
+
+  while (offset < corpus.text.length())
+  {
+    std::size_t consumed = 0;
+    char const* puzzle = corpus.text.data() + offset;
+
+    if (sudoku.load(puzzle, corpus.text.length() - offset, &consumed) == Sudoku::STATUS_OK)
+    {
+      Grid const& grid = sudoku.get_grid();
+      std::size_t unknowns = 0;
+
+      for (std::size_t k = 0; k < grid.n() * grid.n(); k++)
+      {
+        if (grid.data()[k] == 0)
+        {
+          unknowns++;
+        }
+      }
+
+      corpus.offsets.push_back(offset);
+      corpus.lengths.push_back(consumed);
+      corpus.puzzles.push_back(grid);
+      corpus.max_unknowns = std::max(corpus.max_unknowns, unknowns);
+      corpus.all_9x9 = corpus.all_9x9 && grid.n() == 9;
+    }
+
+    //a trailing blank line doesn't take up anything, so it is the end
+    if (consumed == 0)
+    {
+      break;
+    }
+
+    offset += consumed;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Tells you whether a board is a solution of a puzzle: a good board that still has every
+ *        clue of the puzzle where it was.
+ *
+ * @param puzzle The puzzle, as it was read.
+ * @param solution The board that a backend came up with.
+ * @return bool Whether the board solves the puzzle.
+ **/
+static bool solves(Grid const& puzzle, Grid const& solution)
+{
+  if (solution.n() != puzzle.n() || !Validator::is_good_board(solution))
+  {
+    return false;
+  }
+
+  for (std::size_t k = 0; k < puzzle.n() * puzzle.n(); k++)
+  {
+    if (puzzle.data()[k] != 0 && puzzle.data()[k] != solution.data()[k])
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Read and solve a single puzzle with a backend.
+ *
+ * @param backend The backend.
+ * @param text The first character of the puzzle.
+ * @param length The number of characters the puzzle takes up.
+ * @param sudoku The solver, which is reused for every puzzle.
+ * @param general The general search, which is reused for every puzzle.
+ * @param nodes Incremented by the number of search nodes the puzzle took.
+ * @return Grid const* The solved board, or NULL if the puzzle could not be read.
+ **/
+static Grid const* solve_puzzle(Backend backend, char const* text, std::size_t length,
+                                Sudoku& sudoku, GeneralSearch& general, std::size_t& nodes)
+{
+  if (sudoku.load(text, length) != Sudoku::STATUS_OK)
+  {
+    return 0;
+  }
+
+  switch (backend)
+  {
+    case BACKEND_COLOR:
+    {
+      sudoku.solve();
+      break;
+    }
+    case BACKEND_GENERAL:
+    {
+      general.state.load(sudoku.get_grid());
+      //store() writes n*n cells, so the solution has to be the size of the puzzle first
+      general.solution = sudoku.get_grid();
+
+      if (general.search.run(1) == 1)
+      {
+        general.state.store(general.solution);
+      }
+
+      nodes += general.search.stats().nodes;
+      return &general.solution;
+    }
+    case BACKEND_DLX:
+    {
+      sudoku.solve_dlx_style();
+      break;
+    }
+    case BACKEND_BRUTE:
+    {
+      sudoku.solve_bruteforce_style();
+      break;
+    }
+    case BACKEND_BITBOARD:
+    {
+      sudoku.solve_bitboard_style();
+      break;
+    }
+  }
+
+  nodes += sudoku.get_stats().nodes;
+  return &sudoku.get_grid();
+}
+
+/**
+ * @brief Solve every puzzle of a corpus with a backend, over and over, until enough time has
+ *        passed.
+ *
+ * @param corpus The corpus.
+ * @param backend The backend.
+ * @param min_time The number of seconds to keep going for.
+ * @return Result What happened.
+ **/
+static Result measure(Corpus const& corpus, Backend backend, double min_time)
+{
+  typedef std::chrono::steady_clock Clock;
+
+  const std::size_t count = corpus.offsets.size();
+  Sudoku sudoku;
+  GeneralSearch general;
+  std::vector<double> latencies;
+  std::size_t nodes = 0, allocated = 0;
+  double elapsed = 0;
+  Result result;
+
+  result.backend = backend;
+
+  //the first pass warms up the buffers (and the caches), so it isn't counted
+  for (std::size_t k = 0; k < count; k++)
+  {
+    solve_puzzle(backend, corpus.text.data() + corpus.offsets[k], corpus.lengths[k], sudoku,
+                 general, nodes);
+  }
+
+  latencies.reserve(count);
+
+  while (result.passes == 0 || elapsed < min_time)
+  {
+    result.passes++;
+    result.solved = 0;
+    nodes = 0;
+
+    for (std::size_t k = 0; k < count; k++)
+    {
+      const std::size_t allocations_before = allocations;
+      const Clock::time_point start = Clock::now();
+      Grid const* solution = solve_puzzle(backend, corpus.text.data() + corpus.offsets[k],
+                                          corpus.lengths[k], sudoku, general, nodes);
+      const Clock::time_point end = Clock::now();
+
+      allocated += allocations - allocations_before;
+
+      const double seconds = std::chrono::duration<double>(end - start).count();
+      elapsed += seconds;
+      latencies.push_back(seconds * 1e6);
+
+      if (solution != 0 && solves(corpus.puzzles[k], *solution))
+      {
+        result.solved++;
+      }
+    }
+  }
+
+  const std::size_t solves = result.passes * count;
+
+  std::sort(latencies.begin(), latencies.end());
+
+  if (solves > 0)
+  {
+    result.puzzles_per_sec = (elapsed > 0) ? solves / elapsed : 0;
+    result.p50_us = latencies[(solves - 1) / 2];
+    result.p99_us = latencies[(solves - 1) * 99 / 100];
+    result.nodes_per_puzzle = double(nodes) / count;
+    result.allocations_per_puzzle = double(allocated) / solves;
+  }
+
+  return result;
+}
+
+/**
+ * @brief Print the results of every backend on a corpus as rows of a table.
+ *
+ * @param corpus The corpus.
+ * @param results The results.
+ **/
+static void print_table(Corpus const& corpus, std::vector<Result> const& results)
+{
+  std::printf("%s (%zu puzzles)\n", corpus.path.c_str(), corpus.offsets.size());
+  std::printf("  %-8s %8s %12s %10s %10s %12s %8s\n", "backend", "solved", "puzzles/s", "p50 us",
+              "p99 us", "nodes/puzzle", "allocs");
+
+  for (std::size_t k = 0; k < results.size(); k++)
+  {
+    Result const& result = results[k];
+
+    if (result.skipped)
+    {
+      std::printf("  %-8s skipped (%s)\n", backend_names[result.backend],
+                  (result.backend == BACKEND_BITBOARD) ? "not 9*9" : "too many unknowns");
+      continue;
+    }
+
+    //the nodes aren't counted at all if the library was built with SUDOKU_NO_STATS
+    char nodes[32] = "-";
+
+    if (SearchStats::enabled)
+    {
+      std::snprintf(nodes, sizeof(nodes), "%.1f", result.nodes_per_puzzle);
+    }
+
+    std::printf("  %-8s %8zu %12.1f %10.1f %10.1f %12s %8.2f\n", backend_names[result.backend],
+                result.solved, result.puzzles_per_sec, result.p50_us, result.p99_us, nodes,
+                result.allocations_per_puzzle);
+  }
+
+  std::printf("\n");
+}
+
+/**
+ * @brief Print the results of every backend on a corpus as a JSON object.
+ *
+ * @param corpus The corpus.
+ * @param results The results.
+ * @param last Whether this is the last corpus, which isn't followed by a comma.
+ **/
+static void print_json(Corpus const& corpus, std::vector<Result> const& results, bool last)
+{
+  std::printf("    {\n      \"corpus\": \"");
+
+  //paths don't usually need escaping, but a stray quote shouldn't break the report
+  for (std::size_t k = 0; k < corpus.path.length(); k++)
+  {
+    char c = corpus.path[k];
+    std::printf((c == '"' || c == '\\') ? "\\%c" : "%c", c);
+  }
+
+  std::printf("\",\n      \"puzzles\": %zu,\n      \"results\": [\n", corpus.offsets.size());
+
+  for (std::size_t k = 0; k < results.size(); k++)
+  {
+    Result const& result = results[k];
+    char const* separator = (k + 1 < results.size()) ? "," : "";
+
+    if (result.skipped)
+    {
+      std::printf("        {\"backend\": \"%s\", \"skipped\": true}%s\n",
+                  backend_names[result.backend], separator);
+      continue;
+    }
+
+    //the nodes aren't counted at all if the library was built with SUDOKU_NO_STATS
+    char nodes[32] = "null";
+
+    if (SearchStats::enabled)
+    {
+      std::snprintf(nodes, sizeof(nodes), "%.2f", result.nodes_per_puzzle);
+    }
+
+    std::printf("        {\"backend\": \"%s\", \"skipped\": false, \"passes\": %zu, "
+                "\"solved\": %zu, \"puzzles_per_sec\": %.1f, \"p50_us\": %.2f, "
+                "\"p99_us\": %.2f, \"nodes_per_puzzle\": %s, "
+                "\"allocations_per_puzzle\": %.3f}%s\n",
+                backend_names[result.backend], result.passes, result.solved,
+                result.puzzles_per_sec, result.p50_us, result.p99_us, nodes,
+                result.allocations_per_puzzle, separator);
+  }
+
+  std::printf("      ]\n    }%s\n", last ? "" : ",");
+}
+
+/**
+ * @brief Turn a comma-separated list of backend names into backends.
+ *
+ * @param list The list.
+ * @param backends Overwritten with the backends.
+ * @return bool Whether every name was a backend.
+ **/
+static bool parse_backends(char const* list, std::vector<Backend>& backends)
+{
+  std::string names(list);
+  std::size_t start = 0;
+
+  backends.clear();
+
+  while (start <= names.length())
+  {
+    std::size_t end = names.find(',', start);
+
+    if (end == std::string::npos)
+    {
+      end = names.length();
+    }
+
+    std::string name = names.substr(start, end - start);
+    bool known = false;
+
+    for (int k = BACKEND_COLOR; k <= BACKEND_BITBOARD; k++)
+    {
+      if (name == backend_names[k])
+      {
+        backends.push_back(Backend(k));
+        known = true;
+      }
+    }
+
+    if (!known)
+    {
+      return false;
+    }
+
+    start = end + 1;
+  }
+
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  std::vector<Backend> backends;
+  std::vector<char const*> paths;
+  std::size_t brute_max_unknowns = 50;
+  double min_time = 0.5;
+  bool json = false;
+
+  parse_backends("color,general,dlx,brute,bitboard", backends);
+
+  for (int k = 1; k < argc; k++)
+  {
+    if (std::strcmp(argv[k], "--json") == 0)
+    {
+      json = true;
+    }
+    else if (std::strcmp(argv[k], "--backends") == 0 && k + 1 < argc)
+    {
+      if (!parse_backends(argv[++k], backends))
+      {
+        usage(argv[0]);
+        return 2;
+      }
+    }
+    else if (std::strcmp(argv[k], "--min-time") == 0 && k + 1 < argc)
+    {
+      min_time = std::atof(argv[++k]);
+    }
+    else if (std::strcmp(argv[k], "--brute-max-unknowns") == 0 && k + 1 < argc)
+    {
+      brute_max_unknowns = std::size_t(std::atol(argv[++k]));
+    }
+    else if (argv[k][0] == '-')
+    {
+      usage(argv[0]);
+      return 2;
+    }
+    else
+    {
+      paths.push_back(argv[k]);
+    }
+  }
+
+  if (paths.empty())
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  if (json)
+  {
+    std::printf("{\n  \"corpora\": [\n");
+  }
+
+  for (std::size_t k = 0; k < paths.size(); k++)
+  {
+    Corpus corpus;
+    std::vector<Result> results;
+
+    if (!read_corpus(paths[k], corpus))
+    {
+      std::cerr << "Could not open " << paths[k] << "." << std::endl;
+      return 1;
+    }
+
+    for (std::size_t b = 0; b < backends.size(); b++)
+    {
+      //brute force can take minutes on a single sparse board, and the bitboard solver would just
+      //hand anything but a 9*9 board to the colorability solver
+      if ((backends[b] == BACKEND_BRUTE && corpus.max_unknowns > brute_max_unknowns) ||
+          (backends[b] == BACKEND_BITBOARD && !corpus.all_9x9))
+      {
+        Result skipped;
+        skipped.backend = backends[b];
+        skipped.skipped = true;
+        results.push_back(skipped);
+        continue;
+      }
+
+      results.push_back(measure(corpus, backends[b], min_time));
+    }
+
+    if (json)
+    {
+      print_json(corpus, results, k + 1 == paths.size());
+    }
+    else
+    {
+      print_table(corpus, results);
+    }
+  }
+
+  if (json)
+  {
+    std::printf("  ]\n}\n");
+  }
+
+  return 0;
+}
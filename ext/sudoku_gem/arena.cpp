@@ -0,0 +1,137 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "arena.h"
+
+#include <algorithm>
+
+const std::size_t Arena::min_block;
+
+Arena::Arena(std::size_t limit) : block_size(0), offset(0), used_before(0), peak(0), reserved(0),
+  limit(limit), failures(0)
+{
+}
+
+void* Arena::allocate(std::size_t bytes, std::size_t alignment)
+{
+  if (!this->blocks.empty())
+  {
+    const std::size_t start = (this->offset + alignment - 1) & ~(alignment - 1);
+
+    if (start <= this->block_size && bytes <= this->block_size - start)
+    {
+      this->offset = start + bytes;
+      this->peak = std::max(this->peak, this->used_before + this->offset);
+      return this->blocks.back().get() + start;
+    }
+  }
+
+  //the rest of the current block is wasted until the next reset() folds the blocks together
+  const std::size_t used = this->used_before + this->offset;
+
+  if (!this->grow(bytes))
+  {
+    this->failures++;
+    return 0;
+  }
+
+  //a new block is aligned for anything, so the memory goes at its very start
+  this->used_before = used;
+  this->offset = bytes;
+  this->peak = std::max(this->peak, this->used_before + this->offset);
+  return this->blocks.back().get();
+}
+
+bool Arena::grow(std::size_t bytes)
+{
+  std::size_t size = std::max(std::max(bytes, min_block), 2 * this->block_size);
+
+  if (this->limit != 0)
+  {
+    if (this->reserved > this->limit || bytes > this->limit - this->reserved)
+    {
+      return false;
+    }
+
+    size = std::min(size, this->limit - this->reserved);
+  }
+
+  this->blocks.push_back(std::unique_ptr<char[]>(new char[size]));
+  this->block_size = size;
+  this->reserved += size;
+  return true;
+}
+
+void Arena::reset()
+{
+  const bool over_limit = (this->limit != 0 && this->reserved > this->limit);
+
+  //one block that holds everything is better than a few that add up to it
+  if (this->blocks.size() > 1 || over_limit)
+  {
+    std::size_t size = std::max(this->peak, min_block);
+
+    if (this->limit != 0)
+    {
+      size = std::min(size, this->limit);
+    }
+
+    this->blocks.clear();
+    this->blocks.push_back(std::unique_ptr<char[]>(new char[size]));
+    this->block_size = size;
+    this->reserved = size;
+  }
+
+  this->offset = 0;
+  this->used_before = 0;
+}
+
+void Arena::release()
+{
+  this->blocks.clear();
+  this->block_size = 0;
+  this->offset = 0;
+  this->used_before = 0;
+  this->peak = 0;
+  this->reserved = 0;
+}
+
+void Arena::set_limit(std::size_t limit)
+{
+  this->limit = limit;
+}
+
+std::size_t Arena::get_limit() const
+{
+  return this->limit;
+}
+
+Arena::Usage Arena::usage() const
+{
+  Usage usage;
+  usage.used = this->used_before + this->offset;
+  usage.peak = this->peak;
+  usage.reserved = this->reserved;
+  usage.limit = this->limit;
+  usage.failures = this->failures;
+  return usage;
+}
+
+Arena::~Arena()
+{
+}
@@ -0,0 +1,172 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief A monotonic buffer that hands out the memory of one search, with a cap on how much it
+ *        may hold
+ *
+ * An Arena hands out memory by bumping a pointer through a block, and never frees anything on its
+ * own: everything it handed out is released at once by reset(), which makes the memory available
+ * to the next search. When a block runs out, another (twice as big) is added, but reset() folds
+ * them all back into a single block that is big enough for the largest search so far, so a
+ * solver that works through many puzzles settles on one allocation that it keeps for good, no
+ * matter how the puzzles are mixed. release() gives the memory back to the heap.
+ *
+ * The limit caps the total size of the blocks (not counting the bookkeeping): an allocation that
+ * would take the arena past it fails instead, and is counted (see Usage::failures). An Arena must
+ * only be used by one thread at a time.
+ **/
+class Arena
+{
+public:
+  /**
+   * @brief How much memory an arena is holding, and how much of it is in use
+   **/
+  struct Usage
+  {
+    /**
+     * @brief The number of bytes that were handed out since the last reset() (including the
+     *        padding for alignment).
+     **/
+    std::size_t used;
+    /**
+     * @brief The largest number of bytes that were in use at once since the arena was made (or
+     *        since the last release()).
+     **/
+    std::size_t peak;
+    /**
+     * @brief The number of bytes that the blocks take up.
+     **/
+    std::size_t reserved;
+    /**
+     * @brief The cap on Arena::Usage::reserved, or 0 for none.
+     **/
+    std::size_t limit;
+    /**
+     * @brief The number of allocations that failed because of the limit.
+     **/
+    std::size_t failures;
+  };
+
+  /**
+   * @brief The size of the first block, in bytes.
+   **/
+  static const std::size_t min_block = 4096;
+
+  /**
+   * @brief Construct an arena that doesn't hold any memory yet.
+   *
+   * @param limit The most bytes the arena may hold, or 0 for no limit. Defaults to 0.
+   **/
+  explicit Arena(std::size_t limit = 0);
+  virtual ~Arena();
+
+  /**
+   * @brief Hand out some memory, which stays valid until the next reset() or release().
+   *
+   * @param bytes The number of bytes.
+   * @param alignment The alignment of the memory, which must be a power of 2 (and at most the
+   *                  alignment of std::max_align_t).
+   * @return void* The memory, or NULL if the arena would have to grow past its limit.
+   **/
+  void* allocate(std::size_t bytes, std::size_t alignment);
+  /**
+   * @brief Hand out an array, which stays valid until the next reset() or release(). The
+   *        elements are not initialized, so T has to be trivial.
+   *
+   * @param count The number of elements.
+   * @return T* The first element, or NULL if the arena would have to grow past its limit.
+   **/
+  template <typename T>
+  T* allocate_array(std::size_t count)
+  {
+    return static_cast<T*>(this->allocate(count * sizeof(T), alignof(T)));
+  }
+
+  /**
+   * @brief Take back everything that was handed out, all at once, and keep a single block that
+   *        can hold as much as the largest search so far (up to the limit).
+   **/
+  void reset();
+  /**
+   * @brief Take back everything that was handed out, and give all of the memory back to the heap.
+   **/
+  void release();
+
+  /**
+   * @brief Change the limit. Blocks that are already past a new, smaller limit are given back
+   *        at the next reset().
+   *
+   * @param limit The most bytes the arena may hold, or 0 for no limit.
+   **/
+  void set_limit(std::size_t limit);
+  /**
+   * @brief Accessor for the limit
+   *
+   * @return std::size_t The most bytes the arena may hold, or 0 for no limit.
+   **/
+  std::size_t get_limit() const;
+  /**
+   * @brief How much memory the arena is holding, and how much of it is in use
+   *
+   * @return Usage The usage.
+   **/
+  Usage usage() const;
+
+private:
+  Arena(Arena const&);
+  Arena& operator=(Arena const&);
+
+  /**
+   * @brief Helper method for adding a block that can hold at least a given number of bytes.
+   *
+   * @param bytes The number of bytes.
+   * @return bool Whether the block fits under the limit.
+   **/
+  bool grow(std::size_t bytes);
+
+  /**
+   * @brief The blocks, with the one that is being handed out at the back.
+   **/
+  std::vector<std::unique_ptr<char[]> > blocks;
+  /**
+   * @brief The size of the block that is being handed out.
+   **/
+  std::size_t block_size;
+  /**
+   * @brief The number of bytes of the block that is being handed out that are in use.
+   **/
+  std::size_t offset;
+  /**
+   * @brief The bytes that were handed out from the other blocks.
+   **/
+  std::size_t used_before;
+  /**
+   * @brief See Arena::Usage.
+   **/
+  std::size_t peak, reserved, limit, failures;
+};
+
+#endif // ARENA_H
@@ -0,0 +1,196 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batch.h"
+
+#include <atomic>
+
+BatchSolver::BatchSolver(Parser::Format format) : format(format), input(format)
+{
+}
+
+bool BatchSolver::solve(std::string const& puzzle, std::string& solution)
+{
+  //a packed batch is packed both ways unless we were told otherwise, since the text formats can't
+  //be mistaken for it
+  const Sudoku::Status loaded = (this->input == Parser::FORMAT_PACKED) ?
+    this->sudoku.load_packed(puzzle.data(), puzzle.length()) :
+    this->sudoku.load(puzzle.data(), puzzle.length());
+
+  if (loaded != Sudoku::STATUS_OK)
+  {
+    solution.clear();
+    return false;
+  }
+
+  //every puzzle gets the whole budget to itself
+  if (this->budget)
+  {
+    this->budget->reset();
+  }
+
+  //9*9 boards have a solver of their own, which is much faster than the general one (but it
+  //doesn't know about the cache, so it is only used when there isn't one)
+  if (this->sudoku.get_grid().n() == 9 && this->sudoku.get_cache() == 0)
+  {
+    this->sudoku.solve_bitboard_style();
+  }
+  else
+  {
+    this->sudoku.solve();
+  }
+
+  //a puzzle that has no solution is left as it was read, which mustn't pass for a solution
+  if (this->sudoku.get_status() != Sudoku::STATUS_OK)
+  {
+    solution.clear();
+    return false;
+  }
+
+  //write straight into the solution, so its buffer gets reused
+  solution.resize(this->sudoku.serialized_size(this->format));
+  solution.resize(this->sudoku.serialize(&solution[0], this->format));
+  return true;
+}
+
+std::size_t BatchSolver::solve_batch(std::string const* puzzles, std::size_t count,
+                                     std::vector<std::string>& solutions)
+{
+  std::size_t read = 0;
+
+  solutions.resize(count);
+
+  for (std::size_t k = 0; k < count; k++)
+  {
+    if (this->solve(puzzles[k], solutions[k]))
+    {
+      read++;
+    }
+  }
+
+  return read;
+}
+
+void BatchSolver::set_limits(double time_limit, std::size_t node_limit,
+                             SearchBudget const* overall)
+{
+  if (time_limit <= 0 && node_limit == 0 && overall == 0)
+  {
+    this->budget.reset();
+  }
+  else
+  {
+    this->budget.reset(new SearchBudget(overall));
+    this->budget->set_time_limit(time_limit);
+    this->budget->set_node_limit(node_limit);
+  }
+
+  this->sudoku.set_budget(this->budget.get());
+}
+
+void BatchSolver::set_cache(SolutionCache* cache)
+{
+  this->sudoku.set_cache(cache);
+}
+
+void BatchSolver::set_memory_limit(std::size_t bytes)
+{
+  this->sudoku.set_memory_limit(bytes);
+}
+
+void BatchSolver::set_input_format(Parser::Format format)
+{
+  this->input = format;
+}
+
+BatchSolver::~BatchSolver()
+{
+}
+
+ParallelBatchSolver::ParallelBatchSolver(ThreadPool& pool, Parser::Format format) : pool(pool)
+{
+  for (std::size_t k = 0; k < pool.size(); k++)
+  {
+    this->solvers.push_back(std::unique_ptr<BatchSolver>(new BatchSolver(format)));
+  }
+}
+
+std::size_t ParallelBatchSolver::solve_batch(std::string const* puzzles, std::size_t count,
+                                             std::vector<std::string>& solutions)
+{
+  std::atomic<std::size_t> read(0);
+
+  //every task writes to its own slot, so the solutions don't need a lock
+  solutions.resize(count);
+
+  for (std::size_t k = 0; k < count; k++)
+  {
+    std::string const* puzzle = &puzzles[k];
+    std::string* solution = &solutions[k];
+
+    this->pool.submit([this, puzzle, solution, &read]()
+    {
+      BatchSolver& solver = *this->solvers[ThreadPool::current_worker()];
+
+      if (solver.solve(*puzzle, *solution))
+      {
+        read++;
+      }
+    });
+  }
+
+  this->pool.wait();
+  return read;
+}
+
+void ParallelBatchSolver::set_limits(double time_limit, std::size_t node_limit,
+                                     SearchBudget const* overall)
+{
+  for (std::size_t k = 0; k < this->solvers.size(); k++)
+  {
+    this->solvers[k]->set_limits(time_limit, node_limit, overall);
+  }
+}
+
+void ParallelBatchSolver::set_cache(SolutionCache* cache)
+{
+  for (std::size_t k = 0; k < this->solvers.size(); k++)
+  {
+    this->solvers[k]->set_cache(cache);
+  }
+}
+
+void ParallelBatchSolver::set_memory_limit(std::size_t bytes)
+{
+  for (std::size_t k = 0; k < this->solvers.size(); k++)
+  {
+    this->solvers[k]->set_memory_limit(bytes);
+  }
+}
+
+void ParallelBatchSolver::set_input_format(Parser::Format format)
+{
+  for (std::size_t k = 0; k < this->solvers.size(); k++)
+  {
+    this->solvers[k]->set_input_format(format);
+  }
+}
+
+ParallelBatchSolver::~ParallelBatchSolver()
+{
+}
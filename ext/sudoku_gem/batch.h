@@ -0,0 +1,216 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "budget.h"
+#include "cache.h"
+#include "parser.h"
+#include "sudoku.h"
+#include "thread_pool.h"
+
+/**
+ * @brief A class for solving many puzzles in a row, without paying for a new solver every time.
+ *
+ * A BatchSolver keeps a single Sudoku object, and reuses it (along with its buffers) for every
+ * puzzle it is given, so the cost of setting up a solver is paid once per batch instead of once
+ * per puzzle (once it has warmed up, solving a puzzle doesn't allocate at all). The puzzles use the
+ * same text format as Sudoku::read_puzzle_from_string(), and they are solved with Sudoku::solve(),
+ * except for 9*9 puzzles, which are solved with Sudoku::solve_bitboard_style() unless there is a
+ * cache (see set_cache()).
+ **/
+class BatchSolver
+{
+public:
+  /**
+   * @brief Constructor for a BatchSolver instance.
+   *
+   * @param format The format the solutions should be written in (see Serializer::write()). If
+   *               this is Parser::FORMAT_PACKED, the puzzles are read in the packed format too.
+   *               Defaults to Parser::FORMAT_TEXT.
+   **/
+  explicit BatchSolver(Parser::Format format = Parser::FORMAT_TEXT);
+  virtual ~BatchSolver();
+
+  /**
+   * @brief Solve a single puzzle.
+   *
+   * @param puzzle A string containing a n*n Sudoku board, in the same format as
+   *               Sudoku::read_puzzle_from_string().
+   * @param solution Overwritten with the solved board, in the format the solver was constructed
+   *                 with. If the puzzle could not be read or solved (because it has no
+   *                 solution, or it ran out of budget, see set_limits(), or of memory, see
+   *                 set_memory_limit()), it is cleared instead.
+   *                 Its buffer is reused, so solving into the same string over and over stops
+   *                 allocating.
+   * @return bool Whether the puzzle could be read and solved (within its budget).
+   **/
+  bool solve(std::string const& puzzle, std::string& solution);
+  /**
+   * @brief Give every puzzle that is solved from now on its own budget (see SearchBudget).
+   *
+   * @param time_limit The time each puzzle may take, in seconds, or 0 for no limit.
+   * @param node_limit The number of nodes each puzzle may take, or 0 for no limit.
+   * @param overall A budget that cuts every puzzle short when it runs out, if this is not NULL
+   *                (e.g., to cancel the whole batch). It must outlive its use by this object.
+   *                Defaults to NULL.
+   **/
+  void set_limits(double time_limit, std::size_t node_limit, SearchBudget const* overall = 0);
+  /**
+   * @brief Look every puzzle up in a cache of solutions before solving it (see
+   *        Sudoku::set_cache()).
+   *
+   * @param cache The cache, or NULL to always search. It must outlive its use by this object.
+   **/
+  void set_cache(SolutionCache* cache);
+  /**
+   * @brief Cap the memory that every puzzle may use (see Sudoku::set_memory_limit()).
+   *
+   * @param bytes The most bytes the solver may hold, or 0 for no limit.
+   **/
+  void set_memory_limit(std::size_t bytes);
+  /**
+   * @brief Read the puzzles in a different format than the solutions are written in (e.g., to
+   *        read text puzzles and write packed solutions, which are quicker to take apart).
+   *
+   * @param format Parser::FORMAT_PACKED to read packed puzzles, or anything else to read them in
+   *               the text formats. Defaults to the format the solver was constructed with.
+   **/
+  void set_input_format(Parser::Format format);
+
+  /**
+   * @brief Solve a batch of puzzles.
+   *
+   * @param puzzles The first of the puzzles, in the same format as
+   *                Sudoku::read_puzzle_from_string().
+   * @param count The number of puzzles.
+   * @param solutions Resized to count, and then overwritten with the solutions, in order. The
+   *                  solution of a puzzle that could not be read or solved (or ran out of
+   *                  budget) is an empty string.
+   * @return std::size_t The number of puzzles that could be read and solved (within their
+   *         budget).
+   **/
+  std::size_t solve_batch(std::string const* puzzles, std::size_t count,
+                          std::vector<std::string>& solutions);
+
+private:
+  /**
+   * @brief The solver, which is reused for every puzzle.
+   **/
+  Sudoku sudoku;
+  /**
+   * @brief The budget that is reset for every puzzle, if there are limits.
+   **/
+  std::unique_ptr<SearchBudget> budget;
+  /**
+   * @brief The format the solutions are written in.
+   **/
+  Parser::Format format;
+  /**
+   * @brief The format the puzzles are read in.
+   **/
+  Parser::Format input;
+};
+
+/**
+ * @brief A class for solving many puzzles at the same time, on the workers of a ThreadPool.
+ *
+ * Every puzzle is its own task, so the pool's work stealing keeps every worker busy even when a
+ * few of the puzzles are much harder than the rest. Each worker solves its puzzles with its own
+ * BatchSolver, and nothing else is shared between the workers (a Sudoku object has no static
+ * state), so the workers never wait on each other. A ParallelBatchSolver itself must only be used
+ * by one thread at a time.
+ **/
+class ParallelBatchSolver
+{
+public:
+  /**
+   * @brief Constructor for a ParallelBatchSolver instance.
+   *
+   * @param pool The workers that solve the puzzles. It must outlive the solver, and it must not be
+   *             running any other tasks while solve_batch() is waiting on it.
+   * @param format The format the solutions should be written in (and the puzzles read in, if
+   *               it is Parser::FORMAT_PACKED). Defaults to Parser::FORMAT_TEXT.
+   **/
+  explicit ParallelBatchSolver(ThreadPool& pool, Parser::Format format = Parser::FORMAT_TEXT);
+  virtual ~ParallelBatchSolver();
+
+  /**
+   * @brief Solve a batch of puzzles. See BatchSolver::solve_batch().
+   *
+   * @param puzzles The first of the puzzles, in the same format as
+   *                Sudoku::read_puzzle_from_string().
+   * @param count The number of puzzles.
+   * @param solutions Resized to count, and then overwritten with the solutions, in order. The
+   *                  solution of a puzzle that could not be read or solved (or ran out of
+   *                  budget) is an empty string.
+   * @return std::size_t The number of puzzles that could be read and solved (within their
+   *         budget).
+   **/
+  std::size_t solve_batch(std::string const* puzzles, std::size_t count,
+                          std::vector<std::string>& solutions);
+  /**
+   * @brief Give every puzzle its own budget. See BatchSolver::set_limits().
+   *
+   * @param time_limit The time each puzzle may take, in seconds, or 0 for no limit.
+   * @param node_limit The number of nodes each puzzle may take, or 0 for no limit.
+   * @param overall A budget that cuts every puzzle short when it runs out, or NULL. Defaults to
+   *                NULL.
+   **/
+  void set_limits(double time_limit, std::size_t node_limit, SearchBudget const* overall = 0);
+  /**
+   * @brief Look every puzzle up in a cache of solutions before solving it. The cache is shared by
+   *        every worker, and its shards keep them from waiting on each other (see SolutionCache).
+   *
+   * @param cache The cache, or NULL to always search. It must outlive its use by this object.
+   **/
+  void set_cache(SolutionCache* cache);
+  /**
+   * @brief Cap the memory that every worker's solver may hold (see Sudoku::set_memory_limit()).
+   *        Every worker has a limit of its own, so the batch may hold up to one per worker.
+   *
+   * @param bytes The most bytes each solver may hold, or 0 for no limit.
+   **/
+  void set_memory_limit(std::size_t bytes);
+  /**
+   * @brief Read the puzzles in a different format than the solutions are written in. See
+   *        BatchSolver::set_input_format().
+   *
+   * @param format Parser::FORMAT_PACKED to read packed puzzles, or anything else to read them in
+   *               the text formats.
+   **/
+  void set_input_format(Parser::Format format);
+
+private:
+  /**
+   * @brief The workers that solve the puzzles.
+   **/
+  ThreadPool& pool;
+  /**
+   * @brief The solvers, one per worker.
+   **/
+  std::vector<std::unique_ptr<BatchSolver> > solvers;
+};
+
+#endif // BATCH_H
@@ -0,0 +1,516 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bitboard.h"
+
+#include "color_mask.h"
+
+namespace
+{
+  //every cell of a band
+  const std::uint32_t band_cells = 0x7ffffff;
+  //the first row, block and column of a band (the others are shifted by 9, 3 and 1 bits)
+  const std::uint32_t row_cells = 0x1ff, block_cells = 0x1c0e07, column_cells = 0x40201;
+  //the first cell of every three cells of a row that are in the same block
+  const std::uint32_t triple_starts = 0x1249249;
+
+  //the peers of every cell (its row, column and block, but not the cell itself), per band
+  struct PeerTable
+  {
+    PeerTable()
+    {
+      for (std::size_t cell = 0; cell < 81; cell++)
+      {
+        const std::size_t x = cell % 9, y = cell / 9, band = y / 3;
+
+        for (std::size_t b = 0; b < 3; b++)
+        {
+          this->peers[cell][b] = column_cells << x;
+        }
+
+        this->peers[cell][band] |= (row_cells << (9 * (y % 3))) | (block_cells << (3 * (x / 3)));
+        this->peers[cell][band] &= ~(std::uint32_t(1) << (cell % 27));
+      }
+    }
+
+    std::uint32_t peers[81][3];
+  };
+
+  const PeerTable peer_table;
+
+  //whether a mask has exactly one bit set
+  inline bool single_bit(std::uint32_t mask)
+  {
+    return mask != 0 && (mask & (mask - 1)) == 0;
+  }
+
+  //the index of the lowest bit of a mask, which must not be 0
+  inline std::size_t lowest_bit(std::uint32_t mask)
+  {
+    return std::size_t(lowest_color(mask) - 1);
+  }
+}
+
+BitboardSolver::BitboardSolver() : consistent(false), budget(0)
+{
+}
+
+bool BitboardSolver::load(Grid const& grid)
+{
+  Board& root = this->boards[0];
+
+  this->consistent = false;
+
+  if (grid.n() != 9)
+  {
+    return false;
+  }
+
+  for (std::size_t b = 0; b < 3; b++)
+  {
+    for (std::size_t digit = 0; digit < 9; digit++)
+    {
+      root.candidates[digit][b] = band_cells;
+    }
+
+    root.unsolved[b] = band_cells;
+  }
+
+  std::uint8_t const* values = grid.data();
+
+  for (std::size_t cell = 0; cell < 81; cell++)
+  {
+    if (values[cell] == 0)
+    {
+      continue;
+    }
+
+    if (values[cell] > 9)
+    {
+      return false;
+    }
+
+    const std::size_t digit = values[cell] - 1;
+
+    //a known value that one of its peers has already taken away is a repeat
+    if ((root.candidates[digit][cell / 27] & (std::uint32_t(1) << (cell % 27))) == 0)
+    {
+      return false;
+    }
+
+    place(root, cell, digit);
+  }
+
+  this->consistent = true;
+  return true;
+}
+
+void BitboardSolver::place(Board& board, std::size_t cell, std::size_t digit)
+{
+  const std::size_t band = cell / 27;
+  const std::uint32_t bit = std::uint32_t(1) << (cell % 27);
+  std::uint32_t const* peers = peer_table.peers[cell];
+
+  for (std::size_t other = 0; other < 9; other++)
+  {
+    board.candidates[other][band] &= ~bit;
+  }
+
+  for (std::size_t b = 0; b < 3; b++)
+  {
+    board.candidates[digit][b] &= ~peers[b];
+  }
+
+  board.candidates[digit][band] |= bit;
+  board.unsolved[band] &= ~bit;
+}
+
+std::uint32_t BitboardSolver::cell_candidates(Board const& board, std::size_t cell)
+{
+  const std::size_t band = cell / 27, shift = cell % 27;
+  std::uint32_t colors = 0;
+
+  for (std::size_t digit = 0; digit < 9; digit++)
+  {
+    colors |= ((board.candidates[digit][band] >> shift) & 1) << digit;
+  }
+
+  return colors;
+}
+
+bool BitboardSolver::propagate(Board& board)
+{
+  std::size_t placed = 0;
+  bool progress = true;
+
+  while (progress)
+  {
+    progress = false;
+
+    //naked singles: add up the candidates of every cell of a band at once, one bit at a time
+    for (std::size_t b = 0; b < 3; b++)
+    {
+      std::uint32_t ones = 0, twos = 0;
+
+      for (std::size_t digit = 0; digit < 9; digit++)
+      {
+        const std::uint32_t cells = board.candidates[digit][b];
+        twos |= ones & cells;
+        ones |= cells;
+      }
+
+      if ((board.unsolved[b] & ~ones) != 0)
+      {
+        return false;
+      }
+
+      for (std::uint32_t singles = board.unsolved[b] & ~twos; singles != 0;
+           singles &= singles - 1)
+      {
+        const std::size_t cell = 27 * b + lowest_bit(singles);
+        const std::uint32_t colors = cell_candidates(board, cell);
+
+        //the last single we placed may have taken this one's value away
+        if (colors == 0)
+        {
+          return false;
+        }
+
+        place(board, cell, lowest_bit(colors));
+        placed++;
+        progress = true;
+      }
+    }
+
+    //a solved board has nothing left to find
+    if (progress || (board.unsolved[0] | board.unsolved[1] | board.unsolved[2]) == 0)
+    {
+      continue;
+    }
+
+    //hidden singles: a digit that only has one cell left in a row, a block or a column
+    for (std::size_t digit = 0; digit < 9; digit++)
+    {
+      std::uint32_t const* cells = board.candidates[digit];
+
+      //a digit that has been placed in every unit has nothing left to find
+      if (((cells[0] & board.unsolved[0]) | (cells[1] & board.unsolved[1]) |
+           (cells[2] & board.unsolved[2])) == 0)
+      {
+        continue;
+      }
+
+      for (std::size_t b = 0; b < 3; b++)
+      {
+        for (std::size_t k = 0; k < 3; k++)
+        {
+          const std::uint32_t row = cells[b] & (row_cells << (9 * k));
+          const std::uint32_t block = cells[b] & (block_cells << (3 * k));
+
+          if (row == 0 || block == 0)
+          {
+            return false;
+          }
+
+          if (single_bit(row) && (row & board.unsolved[b]) != 0)
+          {
+            place(board, 27 * b + lowest_bit(row), digit);
+            placed++;
+            progress = true;
+          }
+
+          //the row may have been the block's only cell, so look at the block again
+          const std::uint32_t block_left = cells[b] & (block_cells << (3 * k));
+
+          if (single_bit(block_left) && (block_left & board.unsolved[b]) != 0)
+          {
+            place(board, 27 * b + lowest_bit(block_left), digit);
+            placed++;
+            progress = true;
+          }
+        }
+      }
+
+      for (std::size_t x = 0; x < 9; x++)
+      {
+        const std::uint32_t mask = column_cells << x;
+        const std::uint32_t top = cells[0] & mask, middle = cells[1] & mask,
+          bottom = cells[2] & mask;
+
+        if ((top | middle | bottom) == 0)
+        {
+          return false;
+        }
+
+        //the column has a single cell left if exactly one band has exactly one cell of it
+        std::size_t band;
+
+        if (middle == 0 && bottom == 0 && single_bit(top))
+        {
+          band = 0;
+        }
+        else if (top == 0 && bottom == 0 && single_bit(middle))
+        {
+          band = 1;
+        }
+        else if (top == 0 && middle == 0 && single_bit(bottom))
+        {
+          band = 2;
+        }
+        else
+        {
+          continue;
+        }
+
+        const std::uint32_t cell = cells[band] & mask;
+
+        if ((cell & board.unsolved[band]) != 0)
+        {
+          place(board, 27 * band + lowest_bit(cell), digit);
+          placed++;
+          progress = true;
+        }
+      }
+    }
+
+    if (!progress)
+    {
+      progress = lock_candidates(board);
+    }
+  }
+
+  this->counters.propagated(placed);
+  return true;
+}
+
+bool BitboardSolver::lock_candidates(Board& board)
+{
+  bool eliminated = false;
+
+  for (std::size_t digit = 0; digit < 9; digit++)
+  {
+    for (std::size_t b = 0; b < 3; b++)
+    {
+      std::uint32_t& cells = board.candidates[digit][b];
+
+      //the lowest bit of every (row, block) intersection of the band tells whether the digit has
+      //a cell left in it, so a block's rows are at 3 * j, 3 * j + 9 and 3 * j + 18, and a row's
+      //blocks are at 9 * r, 9 * r + 3 and 9 * r + 6
+      const std::uint32_t present = (cells | (cells >> 1) | (cells >> 2)) & triple_starts;
+
+      for (std::size_t k = 0; k < 3; k++)
+      {
+        const std::uint32_t rows = present & (column_cells << (3 * k));
+        const std::uint32_t blocks = present & (triple_starts & (row_cells << (9 * k)));
+
+        //pointing: the digit is only in one row of block k, so the rest of the row can't have it
+        if (single_bit(rows))
+        {
+          const std::uint32_t others = (row_cells << (9 * (lowest_bit(rows) / 9))) &
+            ~(block_cells << (3 * k));
+
+          if ((cells & others) != 0)
+          {
+            cells &= ~others;
+            eliminated = true;
+          }
+        }
+
+        //claiming: the digit is only in one block of row k, so the rest of the block can't have it
+        if (single_bit(blocks))
+        {
+          const std::uint32_t others = (block_cells << (3 * ((lowest_bit(blocks) % 9) / 3))) &
+            ~(row_cells << (9 * k));
+
+          if ((cells & others) != 0)
+          {
+            cells &= ~others;
+            eliminated = true;
+          }
+        }
+      }
+    }
+  }
+
+  return eliminated;
+}
+
+std::size_t BitboardSolver::choose_cell(Board const& board)
+{
+  std::size_t fallback = 81;
+
+  for (std::size_t b = 0; b < 3; b++)
+  {
+    std::uint32_t ones = 0, twos = 0, threes = 0, fours = 0;
+
+    for (std::size_t digit = 0; digit < 9; digit++)
+    {
+      const std::uint32_t cells = board.candidates[digit][b];
+      fours |= threes & cells;
+      threes |= twos & cells;
+      twos |= ones & cells;
+      ones |= cells;
+    }
+
+    const std::uint32_t pairs = board.unsolved[b] & ~threes;
+
+    if (pairs != 0)
+    {
+      return 27 * b + lowest_bit(pairs);
+    }
+
+    const std::uint32_t triples = board.unsolved[b] & ~fours;
+
+    if (fallback == 81 && triples != 0)
+    {
+      fallback = 27 * b + lowest_bit(triples);
+    }
+  }
+
+  if (fallback != 81)
+  {
+    return fallback;
+  }
+
+  for (std::size_t b = 0; b < 3; b++)
+  {
+    if (board.unsolved[b] != 0)
+    {
+      return 27 * b + lowest_bit(board.unsolved[b]);
+    }
+  }
+
+  return 0;
+}
+
+std::size_t BitboardSolver::solve(std::size_t limit)
+{
+  std::size_t found = 0, level = 0;
+  SearchBudget::Meter meter(this->budget);
+
+  this->counters = SearchStats();
+
+  if (!this->consistent)
+  {
+    return 0;
+  }
+
+  //boards[1] is the loaded board with everything that is forced filled in, and every guess on
+  //level k of the search is made on a copy of boards[k + 1]
+  this->boards[1] = this->boards[0];
+
+  if (!this->propagate(this->boards[1]))
+  {
+    return 0;
+  }
+
+  if ((this->boards[1].unsolved[0] | this->boards[1].unsolved[1] |
+       this->boards[1].unsolved[2]) == 0)
+  {
+    this->solution = this->boards[1];
+    return 1;
+  }
+
+  this->cells[0] = std::uint8_t(choose_cell(this->boards[1]));
+  this->untried[0] = cell_candidates(this->boards[1], this->cells[0]);
+
+  while (true)
+  {
+    if (this->untried[level] == 0)
+    {
+      //we ran out of values for this cell, so backtrack
+      if (level == 0)
+      {
+        break;
+      }
+
+      level--;
+      this->counters.backtrack();
+      continue;
+    }
+
+    if (meter.tick())
+    {
+      break;
+    }
+
+    const std::size_t digit = lowest_bit(this->untried[level]);
+    Board& child = this->boards[level + 2];
+
+    this->untried[level] &= this->untried[level] - 1;
+    child = this->boards[level + 1];
+    place(child, this->cells[level], digit);
+    this->counters.node();
+    this->counters.reached(level + 1);
+
+    if (!this->propagate(child))
+    {
+      continue;
+    }
+
+    if ((child.unsolved[0] | child.unsolved[1] | child.unsolved[2]) == 0)
+    {
+      found++;
+      this->solution = child;
+
+      if (found >= limit)
+      {
+        break;
+      }
+
+      continue;
+    }
+
+    level++;
+    this->cells[level] = std::uint8_t(choose_cell(child));
+    this->untried[level] = cell_candidates(child, this->cells[level]);
+  }
+
+  return found;
+}
+
+void BitboardSolver::fill(Grid& grid) const
+{
+  std::uint8_t* values = grid.data();
+
+  for (std::size_t digit = 0; digit < 9; digit++)
+  {
+    for (std::size_t b = 0; b < 3; b++)
+    {
+      for (std::uint32_t cells = this->solution.candidates[digit][b]; cells != 0;
+           cells &= cells - 1)
+      {
+        values[27 * b + lowest_bit(cells)] = std::uint8_t(digit + 1);
+      }
+    }
+  }
+}
+
+SearchStats const& BitboardSolver::stats() const
+{
+  return this->counters;
+}
+
+void BitboardSolver::set_budget(SearchBudget* budget)
+{
+  this->budget = budget;
+}
+
+BitboardSolver::~BitboardSolver()
+{
+}
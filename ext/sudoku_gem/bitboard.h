@@ -0,0 +1,178 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "budget.h"
+#include "grid.h"
+#include "stats.h"
+
+/**
+ * @brief A solver for 9*9 boards only, which keeps one bitboard of candidate cells per digit
+ *
+ * Every digit has an 81-bit bitboard of the cells it may still go in, stored as three 27-bit
+ * words, one per band (so that a row or a block is always inside a single word, and a cell's
+ * peers are three masks). Placing a digit is a handful of and-nots on those words, and the cells
+ * that have a single candidate left (or none at all) are found for a whole band at once, by
+ * adding up the nine bitboards bit by bit. Hidden singles are found by looking for a unit in
+ * which a digit has a single cell left. The search itself copies the whole board (120 bytes) for
+ * every guess instead of undoing anything, and it is iterative, over a stack of boards that is
+ * part of the object, so solving never allocates.
+ **/
+class BitboardSolver
+{
+public:
+  /**
+   * @brief Construct a solver without a board. See load().
+   **/
+  BitboardSolver();
+  virtual ~BitboardSolver();
+
+  /**
+   * @brief Start over with a given board
+   *
+   * @param grid A 9*9 Sudoku board.
+   * @return bool Whether the board could be loaded, i.e., whether it is 9*9 and none of its
+   *         known values rule each other out. If not, solve() finds nothing.
+   **/
+  bool load(Grid const& grid);
+  /**
+   * @brief Look for solutions of the board, stopping as soon as enough of them have been found
+   *        (or the budget runs out, see set_budget()). The board is left as it was loaded, so it
+   *        is okay to call this more than once.
+   *
+   * @param limit The number of solutions after which the search should stop. Must be at least 1.
+   * @return std::size_t The number of solutions that were found (at most limit).
+   **/
+  std::size_t solve(std::size_t limit);
+
+  /**
+   * @brief Write the last solution that was found by solve() onto a grid
+   *
+   * @param grid The board that was loaded.
+   **/
+  void fill(Grid& grid) const;
+  /**
+   * @brief What the last solve() did
+   *
+   * @return SearchStats const& The counts of the last solve().
+   **/
+  SearchStats const& stats() const;
+  /**
+   * @brief Limit the next solve(), which then gives up as soon as the budget runs out (see
+   *        SearchBudget). By default, there is no limit.
+   *
+   * @param budget The budget, or NULL for no limit. It must outlive its use by this object.
+   **/
+  void set_budget(SearchBudget* budget);
+
+private:
+  /**
+   * @brief The state of the board at one level of the search
+   **/
+  struct Board
+  {
+    /**
+     * @brief The cells each digit may go in (including the cells it has been placed in), one
+     *        word per band, with the cell (x, y) at the bit (y % 3) * 9 + x of the word y / 3.
+     **/
+    std::uint32_t candidates[9][3];
+    /**
+     * @brief The cells that do not have a value yet, in the same layout.
+     **/
+    std::uint32_t unsolved[3];
+  };
+
+  /**
+   * @brief Helper method for giving a cell a value, and taking that value away from its peers.
+   *        The value must still be one of the cell's candidates.
+   *
+   * @param board The board.
+   * @param cell The cell, as y * 9 + x.
+   * @param digit The value, minus one.
+   **/
+  static void place(Board& board, std::size_t cell, std::size_t digit);
+  /**
+   * @brief Helper method for filling in every naked and hidden single, for as long as there are
+   *        any.
+   *
+   * @param board The board.
+   * @return bool Whether the board is still consistent (i.e., every cell has a candidate left,
+   *         and every unit has a cell left for every digit).
+   **/
+  bool propagate(Board& board);
+  /**
+   * @brief Helper method for taking candidates away with the locked candidates of every band: a
+   *        digit that only has cells left in one row of a block can't go anywhere else in that
+   *        row, and a digit that only has cells left in one block of a row can't go anywhere else
+   *        in that block.
+   *
+   * @param board The board.
+   * @return bool Whether any candidates were taken away.
+   **/
+  static bool lock_candidates(Board& board);
+  /**
+   * @brief Helper method for picking the cell to guess at: one with two candidates if there is
+   *        one, then one with three, and otherwise the first one without a value.
+   *
+   * @param board The board, which must have a cell without a value.
+   * @return std::size_t The cell, as y * 9 + x.
+   **/
+  static std::size_t choose_cell(Board const& board);
+  /**
+   * @brief Helper method for finding the candidates of a single cell.
+   *
+   * @param board The board.
+   * @param cell The cell, as y * 9 + x.
+   * @return std::uint32_t The candidates, with the value 1 in the lowest bit.
+   **/
+  static std::uint32_t cell_candidates(Board const& board, std::size_t cell);
+
+  /**
+   * @brief The board as it was loaded, followed by one board for every level of the search.
+   **/
+  Board boards[83];
+  /**
+   * @brief The cell that was guessed at on every level of the search, and the values that are
+   *        left to try on it.
+   **/
+  std::uint8_t cells[81];
+  std::uint32_t untried[81];
+  /**
+   * @brief The last solution that was found.
+   **/
+  Board solution;
+  /**
+   * @brief Whether the board was loaded without any contradictions.
+   **/
+  bool consistent;
+  /**
+   * @brief The counts of the last solve().
+   **/
+  SearchStats counters;
+  /**
+   * @brief The limits on solve(), if any.
+   **/
+  SearchBudget* budget;
+};
+
+#endif // BITBOARD_H
@@ -0,0 +1,105 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "budget.h"
+
+#include <algorithm>
+
+const std::size_t SearchBudget::check_interval;
+
+SearchBudget::SearchBudget(SearchBudget const* parent) : parent(parent), time_limit(0),
+  node_limit(0), nodes(0), stop(false)
+{
+}
+
+void SearchBudget::set_time_limit(double seconds)
+{
+  this->time_limit = (seconds > 0) ? seconds : 0;
+  this->deadline = std::chrono::steady_clock::now() +
+                   std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                     std::chrono::duration<double>(this->time_limit));
+}
+
+void SearchBudget::set_node_limit(std::size_t nodes)
+{
+  this->node_limit = nodes;
+}
+
+void SearchBudget::reset()
+{
+  this->nodes = 0;
+  this->stop = false;
+
+  if (this->time_limit > 0)
+  {
+    this->set_time_limit(this->time_limit);
+  }
+}
+
+void SearchBudget::cancel()
+{
+  this->stop = true;
+}
+
+bool SearchBudget::spend(std::size_t nodes)
+{
+  const std::size_t total = (this->nodes += nodes);
+
+  //only look at the clock once per check, since that's the expensive part
+  if ((this->node_limit != 0 && total >= this->node_limit) ||
+      (this->time_limit > 0 && std::chrono::steady_clock::now() >= this->deadline) ||
+      (this->parent != 0 && this->parent->expired()))
+  {
+    this->stop = true;
+  }
+
+  return this->stop.load(std::memory_order_relaxed);
+}
+
+bool SearchBudget::expired() const
+{
+  return this->stop.load(std::memory_order_relaxed) ||
+         (this->parent != 0 && this->parent->expired());
+}
+
+std::size_t SearchBudget::spent() const
+{
+  return this->nodes;
+}
+
+std::size_t SearchBudget::next_check(std::size_t interval) const
+{
+  const std::size_t spent = this->nodes.load(std::memory_order_relaxed);
+
+  if (this->node_limit != 0)
+  {
+    interval = std::min(interval, (spent < this->node_limit) ? this->node_limit - spent : 1);
+  }
+
+  return std::max<std::size_t>(interval, 1);
+}
+
+std::size_t SearchBudget::interval_for(std::size_t cells)
+{
+  //a 9*9 board gets the whole interval
+  return std::max<std::size_t>(1, check_interval * 81 / std::max<std::size_t>(cells, 81));
+}
+
+SearchBudget::~SearchBudget()
+{
+}
@@ -0,0 +1,231 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+/**
+ * @brief A limit on how long the solvers may search: a deadline, a number of nodes, or both,
+ *        along with a flag that lets any thread cancel the searches right away
+ *
+ * A solver that is given a budget (see Sudoku::set_budget()) counts its nodes on a Meter. The
+ * flag is a single relaxed load, so it is checked on every node, but the nodes are only spent on
+ * the budget (which is when the clock is read and the node limit is checked) every check_interval
+ * nodes, or more often on boards whose nodes take longer (see interval_for()) and when the node
+ * limit is close. This keeps the expensive checks off the hot path, so a search may overrun its
+ * deadline by up to an interval (per thread). Once the budget runs out, every search that uses it
+ * gives up at its next check, leaves the board as it found it, and reports that it timed out (see
+ * Sudoku::STATUS_TIMED_OUT).
+ *
+ * The nodes are spent with atomics, so one budget can be shared by the workers of a parallel
+ * search, and cancel() can be called from any thread (e.g., from an interrupt handler). A budget
+ * can also have a parent, in which case it runs out as soon as its parent does, so a batch of
+ * puzzles can give every puzzle its own limits and still be cancelled as a whole.
+ **/
+class SearchBudget
+{
+public:
+  /**
+   * @brief The number of nodes a search of a 9*9 board counts before it spends them.
+   **/
+  static const std::size_t check_interval = 1024;
+
+  /**
+   * @brief The nodes that one search (on one thread) has not spent on its budget yet
+   **/
+  class Meter
+  {
+  public:
+    /**
+     * @brief Start counting the nodes of a search.
+     *
+     * @param budget The budget to spend them on, or NULL if the search has no limits.
+     * @param interval The most nodes to count before spending them. Defaults to check_interval.
+     **/
+    explicit Meter(SearchBudget* budget, std::size_t interval = check_interval) : budget(budget),
+      interval(interval), count(0), stopped(budget != 0 && budget->expired())
+    {
+      this->limit = (budget != 0) ? budget->next_check(interval) : interval;
+    }
+    /**
+     * @brief Spend the nodes that are left over on the budget.
+     **/
+    ~Meter()
+    {
+      if (this->budget != 0 && this->count != 0)
+      {
+        this->budget->spend(this->count);
+      }
+    }
+
+    /**
+     * @brief Count a node, and check the budget if it is time to.
+     *
+     * @return bool Whether the search should give up (once it should, this keeps returning true).
+     **/
+    bool tick()
+    {
+      if (this->budget == 0)
+      {
+        return false;
+      }
+
+      if (++this->count >= this->limit)
+      {
+        this->stopped = this->budget->spend(this->count);
+        this->count = 0;
+        this->limit = this->budget->next_check(this->interval);
+      }
+      else if (this->budget->expired())
+      {
+        this->stopped = true;
+      }
+
+      return this->stopped;
+    }
+
+  private:
+    Meter(Meter const&);
+    Meter& operator=(Meter const&);
+
+    /**
+     * @brief The budget to spend the nodes on, if any.
+     **/
+    SearchBudget* budget;
+    /**
+     * @brief The most nodes to count before spending them.
+     **/
+    std::size_t interval;
+    /**
+     * @brief The number of nodes to count before spending them this time.
+     **/
+    std::size_t limit;
+    /**
+     * @brief The nodes that have not been spent yet.
+     **/
+    std::size_t count;
+    /**
+     * @brief Whether the budget had run out the last time it was checked.
+     **/
+    bool stopped;
+  };
+
+  /**
+   * @brief Construct a budget without any limits.
+   *
+   * @param parent A budget that this one runs out with, if this is not NULL. It must outlive
+   *               this one. Defaults to NULL.
+   **/
+  explicit SearchBudget(SearchBudget const* parent = 0);
+  virtual ~SearchBudget();
+
+  /**
+   * @brief Set the deadline a given time from now.
+   *
+   * @param seconds The time the searches may take, in seconds, or 0 for no deadline.
+   **/
+  void set_time_limit(double seconds);
+  /**
+   * @brief Set the number of nodes the searches may visit between them.
+   *
+   * @param nodes The number of nodes, or 0 for no limit.
+   **/
+  void set_node_limit(std::size_t nodes);
+  /**
+   * @brief Start the budget over: forget the nodes that have been spent and any cancel(), and
+   *        move the deadline (if there is one) to the time limit from now.
+   **/
+  void reset();
+
+  /**
+   * @brief Make every search that uses this budget (or a budget whose parent is this one) give
+   *        up at its next check. This is safe to call from any thread.
+   **/
+  void cancel();
+  /**
+   * @brief Spend some nodes, and check the limits
+   *
+   * @param nodes The number of nodes.
+   * @return bool Whether the budget has run out.
+   **/
+  bool spend(std::size_t nodes);
+  /**
+   * @brief Whether the budget has run out (as of its last check), or was cancelled
+   *
+   * @return bool Whether the searches should give up.
+   **/
+  bool expired() const;
+  /**
+   * @brief Accessor for SearchBudget::nodes
+   *
+   * @return std::size_t The number of nodes that have been spent since the last reset().
+   **/
+  std::size_t spent() const;
+  /**
+   * @brief The number of nodes a search should count before it spends them, so that it doesn't
+   *        overrun the node limit by more than it has to
+   *
+   * @param interval The most nodes the search wants to count.
+   * @return std::size_t The number of nodes, at least 1.
+   **/
+  std::size_t next_check(std::size_t interval) const;
+  /**
+   * @brief The interval at which a search of a board should spend its nodes: a node of a bigger
+   *        board takes longer (it has more cells to propagate), so its search checks the clock
+   *        after fewer of them.
+   *
+   * @param cells The number of cells of the board.
+   * @return std::size_t The interval, between 1 and check_interval.
+   **/
+  static std::size_t interval_for(std::size_t cells);
+
+private:
+  SearchBudget(SearchBudget const&);
+  SearchBudget& operator=(SearchBudget const&);
+
+  /**
+   * @brief The budget that this one runs out with, if any.
+   **/
+  SearchBudget const* parent;
+  /**
+   * @brief The time the searches may take, in seconds, or 0 for no deadline.
+   **/
+  double time_limit;
+  /**
+   * @brief When the time limit runs out, if there is one.
+   **/
+  std::chrono::steady_clock::time_point deadline;
+  /**
+   * @brief The number of nodes the searches may visit, or 0 for no limit.
+   **/
+  std::size_t node_limit;
+  /**
+   * @brief The number of nodes that have been spent.
+   **/
+  std::atomic<std::size_t> nodes;
+  /**
+   * @brief Set once the budget has run out, or was cancelled.
+   **/
+  std::atomic<bool> stop;
+};
+
+#endif // BUDGET_H
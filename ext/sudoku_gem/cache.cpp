@@ -0,0 +1,228 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cache.h"
+
+#include <cstring>
+
+const std::size_t SolutionCache::entry_overhead;
+const std::size_t SolutionCache::min_shard_capacity;
+
+SolutionCache::SolutionCache(std::size_t capacity, std::size_t shards) : capacity(capacity),
+  active(1)
+{
+  if (shards == 0)
+  {
+    shards = 1;
+  }
+
+  for (std::size_t k = 0; k < shards; k++)
+  {
+    this->shards.push_back(std::unique_ptr<Shard>(new Shard()));
+  }
+
+  this->active = shards_for(capacity, shards);
+}
+
+std::uint64_t SolutionCache::hash_of(Grid const& form)
+{
+  const std::size_t n = form.n();
+  std::uint8_t const* cells = form.data();
+  std::uint64_t hash = 14695981039346656037ULL;
+
+  hash = (hash ^ n) * 1099511628211ULL;
+
+  for (std::size_t k = 0; k < n * n; k++)
+  {
+    hash = (hash ^ cells[k]) * 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+bool SolutionCache::matches(Entry const& entry, Grid const& form)
+{
+  const std::size_t n = form.n();
+
+  return entry.key.size() == n * n + 1 && std::uint8_t(entry.key[0]) == n &&
+         std::memcmp(entry.key.data() + 1, form.data(), n * n) == 0;
+}
+
+std::size_t SolutionCache::cost_of(Entry const& entry)
+{
+  return entry.key.size() + entry.solution.size() + entry_overhead;
+}
+
+std::size_t SolutionCache::shards_for(std::size_t capacity, std::size_t shards)
+{
+  const std::size_t wanted = capacity / min_shard_capacity;
+  return (wanted < 1) ? 1 : (wanted < shards) ? wanted : shards;
+}
+
+std::size_t SolutionCache::shard_of(std::uint64_t hash) const
+{
+  //the low bits pick the bucket in the index, so use the high bits to pick the shard
+  return (hash >> 32) % this->active;
+}
+
+void SolutionCache::evict(Shard& shard, std::size_t budget)
+{
+  while (shard.bytes > budget && !shard.entries.empty())
+  {
+    Entry const& last = shard.entries.back();
+    shard.bytes -= cost_of(last);
+    shard.index.erase(last.hash);
+    shard.entries.pop_back();
+  }
+}
+
+bool SolutionCache::find(Grid const& form, Grid& solution)
+{
+  const std::uint64_t hash = hash_of(form);
+  Shard& shard = *this->shards[this->shard_of(hash)];
+  std::lock_guard<std::mutex> guard(shard.lock);
+
+  std::unordered_map<std::uint64_t, std::list<Entry>::iterator>::iterator found =
+    shard.index.find(hash);
+
+  if (found == shard.index.end() || !matches(*found->second, form))
+  {
+    shard.misses++;
+    return false;
+  }
+
+  //splicing moves the node to the front without copying (or allocating) anything
+  shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+  shard.hits++;
+
+  const std::size_t n = form.n();
+  std::string const& cells = found->second->solution;
+
+  solution.reset(n);
+  std::memcpy(solution.data(), cells.data(), n * n);
+  return true;
+}
+
+void SolutionCache::insert(Grid const& form, Grid const& solution)
+{
+  const std::size_t n = form.n();
+  const std::uint64_t hash = hash_of(form);
+  const std::size_t index = this->shard_of(hash);
+  Shard& shard = *this->shards[index];
+  const std::size_t budget = this->capacity / this->active;
+
+  //build the entry before taking the lock, so the other solvers don't wait on the allocations
+  std::list<Entry> node(1);
+  Entry& entry = node.front();
+  entry.hash = hash;
+  entry.key.reserve(n * n + 1);
+  entry.key.push_back(char(n));
+  entry.key.append((char const*)form.data(), n * n);
+  entry.solution.assign((char const*)solution.data(), n * n);
+
+  if (cost_of(entry) > budget)
+  {
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard(shard.lock);
+
+  //set_capacity() may have just stopped using this shard (and emptied it), so don't refill it
+  if (index >= this->active)
+  {
+    return;
+  }
+
+  //an entry with the same hash is either the same form or a collision, and either way it goes
+  std::unordered_map<std::uint64_t, std::list<Entry>::iterator>::iterator found =
+    shard.index.find(hash);
+
+  if (found != shard.index.end())
+  {
+    shard.bytes -= cost_of(*found->second);
+    shard.entries.erase(found->second);
+    shard.index.erase(found);
+  }
+
+  shard.bytes += cost_of(entry);
+  shard.entries.splice(shard.entries.begin(), node);
+  shard.index[hash] = shard.entries.begin();
+  evict(shard, budget);
+}
+
+void SolutionCache::clear()
+{
+  for (std::size_t k = 0; k < this->shards.size(); k++)
+  {
+    Shard& shard = *this->shards[k];
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    shard.entries.clear();
+    shard.index.clear();
+    shard.bytes = 0;
+    shard.hits = 0;
+    shard.misses = 0;
+  }
+}
+
+void SolutionCache::set_capacity(std::size_t capacity)
+{
+  const std::size_t active = shards_for(capacity, this->shards.size());
+  const bool resharded = (active != this->active);
+
+  this->capacity = capacity;
+  this->active = active;
+
+  //with a different number of shards, every form may belong to a different shard, so the
+  //solutions are all evicted rather than left where no lookup would find them
+  const std::size_t budget = resharded ? 0 : capacity / active;
+
+  for (std::size_t k = 0; k < this->shards.size(); k++)
+  {
+    Shard& shard = *this->shards[k];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    evict(shard, budget);
+  }
+}
+
+std::size_t SolutionCache::get_capacity() const
+{
+  return this->capacity;
+}
+
+SolutionCache::Usage SolutionCache::usage() const
+{
+  Usage total;
+
+  for (std::size_t k = 0; k < this->shards.size(); k++)
+  {
+    Shard const& shard = *this->shards[k];
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    total.hits += shard.hits;
+    total.misses += shard.misses;
+    total.entries += shard.entries.size();
+    total.bytes += shard.bytes;
+  }
+
+  return total;
+}
+
+SolutionCache::~SolutionCache()
+{
+}
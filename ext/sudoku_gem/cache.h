@@ -0,0 +1,261 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "grid.h"
+
+/**
+ * @brief A bounded cache of solutions, keyed by the canonical form of their puzzles (see
+ *        CanonicalForm), that many solvers can share
+ *
+ * The cache is split into shards, each with its own lock, its own entries and its own share of
+ * the capacity, and every form goes to the shard that its hash picks. The solvers of a parallel
+ * batch then only wait on each other when two of them look at the same shard at the same time. A
+ * shard keeps its entries in least-recently-used order, and once they take up more than its share
+ * of the capacity, the least recently used ones are evicted. A small cache uses fewer shards (at
+ * least min_shard_capacity bytes each), so that a single solution is never too big for its share;
+ * only a solution that is bigger than the whole capacity is left out.
+ *
+ * The capacity is in bytes: every entry counts its key and its solution (one byte per cell each),
+ * plus entry_overhead for its list node and its slot in the index. A lookup never allocates, and
+ * it compares the whole key, so two forms whose hashes collide never get each other's solutions
+ * (the newer one just replaces the older one).
+ **/
+class SolutionCache
+{
+public:
+  /**
+   * @brief How much the cache has been used
+   **/
+  struct Usage
+  {
+    /**
+     * @brief Construct a usage of an empty cache that has never been looked at.
+     **/
+    Usage() : hits(0), misses(0), entries(0), bytes(0) {}
+
+    /**
+     * @brief The number of lookups that found a solution.
+     **/
+    std::size_t hits;
+    /**
+     * @brief The number of lookups that didn't.
+     **/
+    std::size_t misses;
+    /**
+     * @brief The number of solutions in the cache.
+     **/
+    std::size_t entries;
+    /**
+     * @brief The number of bytes the solutions count for (see SolutionCache).
+     **/
+    std::size_t bytes;
+  };
+
+  /**
+   * @brief The number of bytes that every entry counts for, on top of its key and its solution.
+   **/
+  static const std::size_t entry_overhead = 128;
+  /**
+   * @brief The smallest share of the capacity that a shard gets, unless there is only one.
+   **/
+  static const std::size_t min_shard_capacity = 64 * 1024;
+
+  /**
+   * @brief Constructor for a SolutionCache instance.
+   *
+   * @param capacity The number of bytes the solutions may take up (see SolutionCache).
+   * @param shards The most shards (and locks) the cache may use. Must be at least 1. Defaults to
+   *               16.
+   **/
+  explicit SolutionCache(std::size_t capacity, std::size_t shards = 16);
+  virtual ~SolutionCache();
+
+  /**
+   * @brief Look up the solution of a canonical form, and mark it as the most recently used.
+   *
+   * @param form The canonical form of the puzzle (see CanonicalForm::grid()).
+   * @param solution Overwritten with the solution of the form, if it is in the cache.
+   * @return bool Whether the solution was in the cache.
+   **/
+  bool find(Grid const& form, Grid& solution);
+  /**
+   * @brief Add the solution of a canonical form to the cache (or replace it), evicting the least
+   *        recently used solutions of its shard if it doesn't fit.
+   *
+   * @param form The canonical form of the puzzle.
+   * @param solution A solution of the form (see CanonicalForm::to_canonical()).
+   **/
+  void insert(Grid const& form, Grid const& solution);
+  /**
+   * @brief Evict every solution, and start counting the hits and misses over.
+   **/
+  void clear();
+
+  /**
+   * @brief Change the capacity, evicting the least recently used solutions until they fit.
+   *
+   * @param capacity The number of bytes the solutions may take up.
+   **/
+  void set_capacity(std::size_t capacity);
+  /**
+   * @brief Accessor for SolutionCache::capacity
+   *
+   * @return std::size_t The number of bytes the solutions may take up.
+   **/
+  std::size_t get_capacity() const;
+  /**
+   * @brief How much the cache has been used, summed over the shards
+   *
+   * @return Usage The usage.
+   **/
+  Usage usage() const;
+
+private:
+  /**
+   * @brief A cached solution
+   **/
+  struct Entry
+  {
+    /**
+     * @brief The hash of the form.
+     **/
+    std::uint64_t hash;
+    /**
+     * @brief The side length of the form, followed by its cells.
+     **/
+    std::string key;
+    /**
+     * @brief The cells of the solution of the form.
+     **/
+    std::string solution;
+  };
+
+  /**
+   * @brief The entries of one shard, in least-recently-used order, and everything that protects
+   *        or counts them
+   **/
+  struct Shard
+  {
+    /**
+     * @brief Construct an empty shard.
+     **/
+    Shard() : bytes(0), hits(0), misses(0) {}
+
+    /**
+     * @brief The lock that protects everything else in the shard.
+     **/
+    mutable std::mutex lock;
+    /**
+     * @brief The entries, with the most recently used one at the front.
+     **/
+    std::list<Entry> entries;
+    /**
+     * @brief The entries, by the hash of their form.
+     **/
+    std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index;
+    /**
+     * @brief The number of bytes the entries count for.
+     **/
+    std::size_t bytes;
+    /**
+     * @brief The number of lookups that found a solution.
+     **/
+    std::size_t hits;
+    /**
+     * @brief The number of lookups that didn't.
+     **/
+    std::size_t misses;
+  };
+
+  SolutionCache(SolutionCache const&);
+  SolutionCache& operator=(SolutionCache const&);
+
+  /**
+   * @brief Helper method for hashing a form (FNV-1a, over its side length and its cells).
+   *
+   * @param form The form.
+   * @return std::uint64_t The hash.
+   **/
+  static std::uint64_t hash_of(Grid const& form);
+  /**
+   * @brief Helper method for checking whether an entry is the one for a form.
+   *
+   * @param entry The entry.
+   * @param form The form.
+   * @return bool Whether the key of the entry is the form.
+   **/
+  static bool matches(Entry const& entry, Grid const& form);
+  /**
+   * @brief Helper method for the number of bytes an entry counts for.
+   *
+   * @param entry The entry.
+   * @return std::size_t The number of bytes.
+   **/
+  static std::size_t cost_of(Entry const& entry);
+  /**
+   * @brief Helper method for the number of shards a capacity should be split between.
+   *
+   * @param capacity The number of bytes the solutions may take up.
+   * @param shards The number of shards there are.
+   * @return std::size_t The number of shards to use, between 1 and shards.
+   **/
+  static std::size_t shards_for(std::size_t capacity, std::size_t shards);
+  /**
+   * @brief Helper method for picking the shard of a hash, among the shards that are in use.
+   *
+   * @param hash The hash of a form.
+   * @return std::size_t The index of the shard.
+   **/
+  std::size_t shard_of(std::uint64_t hash) const;
+  /**
+   * @brief Helper method for evicting the least recently used entries of a shard until they fit,
+   *        while holding its lock.
+   *
+   * @param shard The shard.
+   * @param budget The number of bytes the entries may take up.
+   **/
+  static void evict(Shard& shard, std::size_t budget);
+
+  /**
+   * @brief The shards.
+   **/
+  std::vector<std::unique_ptr<Shard> > shards;
+  /**
+   * @brief The number of bytes the solutions may take up, between all of the shards.
+   **/
+  std::atomic<std::size_t> capacity;
+  /**
+   * @brief The number of shards that are in use (the first ones), which depends on the capacity.
+   **/
+  std::atomic<std::size_t> active;
+};
+
+#endif // CACHE_H
@@ -0,0 +1,420 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "canonical.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+const std::size_t CanonicalForm::max_candidates;
+
+namespace
+{
+  //fold a value into a hash (the invariants only have to be consistent, not strong)
+  inline std::uint64_t mix(std::uint64_t hash, std::uint64_t value)
+  {
+    return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+  }
+
+  //the key of a line is the number of values it has, and how full the lines across it are
+  std::uint64_t line_key(std::size_t count, std::size_t const* across, std::uint8_t const* cells,
+                         std::size_t n, std::size_t stride)
+  {
+    std::uint8_t histogram[65] = { 0 };
+
+    for (std::size_t k = 0; k < n; k++)
+    {
+      if (cells[k * stride] != 0)
+      {
+        histogram[across[k]]++;
+      }
+    }
+
+    std::uint64_t key = count;
+
+    for (std::size_t v = 0; v <= n; v++)
+    {
+      if (histogram[v] != 0)
+      {
+        key = mix(key, (v << 8) | histogram[v]);
+      }
+    }
+
+    return key;
+  }
+
+  //the key of a band is the keys of its rows, in sorted order
+  std::uint64_t group_key(std::uint64_t const* keys, std::size_t root)
+  {
+    std::uint64_t sorted[8];
+
+    //a band has at most 8 rows, so an insertion sort is all it needs
+    for (std::size_t k = 0; k < root; k++)
+    {
+      std::size_t j = k;
+
+      for (; j > 0 && sorted[j - 1] > keys[k]; j--)
+      {
+        sorted[j] = sorted[j - 1];
+      }
+
+      sorted[j] = keys[k];
+    }
+
+    std::uint64_t key = 0;
+
+    for (std::size_t k = 0; k < root; k++)
+    {
+      key = mix(key, sorted[k]);
+    }
+
+    return key;
+  }
+}
+
+CanonicalForm::CanonicalForm() : dim(0), root(0), form(0), found(false), transposed(false)
+{
+  std::memset(this->labels, 0, sizeof(this->labels));
+  std::memset(this->values, 0, sizeof(this->values));
+}
+
+void CanonicalForm::compute_invariants()
+{
+  const std::size_t n = this->dim, root = this->root;
+  std::uint8_t const* cells = this->oriented.data();
+
+  std::fill(this->row_counts.begin(), this->row_counts.end(), 0);
+  std::fill(this->column_counts.begin(), this->column_counts.end(), 0);
+
+  for (std::size_t y = 0; y < n; y++)
+  {
+    for (std::size_t x = 0; x < n; x++)
+    {
+      if (cells[y * n + x] != 0)
+      {
+        this->row_counts[y]++;
+        this->column_counts[x]++;
+      }
+    }
+  }
+
+  for (std::size_t k = 0; k < n; k++)
+  {
+    this->row_keys[k] = line_key(this->row_counts[k], this->column_counts.data(), cells + k * n,
+                                 n, 1);
+    this->column_keys[k] = line_key(this->column_counts[k], this->row_counts.data(), cells + k,
+                                    n, n);
+  }
+
+  for (std::size_t k = 0; k < root; k++)
+  {
+    this->band_keys[k] = group_key(&this->row_keys[k * root], root);
+    this->stack_keys[k] = group_key(&this->column_keys[k * root], root);
+  }
+}
+
+std::size_t CanonicalForm::list_orders(std::vector<std::uint64_t> const& line_keys,
+                                       std::vector<std::uint64_t> const& group_keys,
+                                       std::vector<std::uint8_t>& orders)
+{
+  const std::size_t n = this->dim, root = this->root;
+  std::vector<std::uint8_t>& seq = this->seq;
+
+  //the odometer holds the order of the bands, and then the order of the rows within each band
+  seq.resize(root + n);
+
+  for (std::size_t k = 0; k < root; k++)
+  {
+    seq[k] = std::uint8_t(k);
+  }
+
+  std::sort(seq.begin(), seq.begin() + root, [&group_keys](std::uint8_t a, std::uint8_t b)
+  {
+    return (group_keys[a] != group_keys[b]) ? (group_keys[a] < group_keys[b]) : (a < b);
+  });
+
+  for (std::size_t g = 0; g < root; g++)
+  {
+    std::uint64_t const* keys = &line_keys[g * root];
+    std::vector<std::uint8_t>::iterator first = seq.begin() + root + g * root;
+
+    for (std::size_t k = 0; k < root; k++)
+    {
+      first[k] = std::uint8_t(k);
+    }
+
+    std::sort(first, first + root, [keys](std::uint8_t a, std::uint8_t b)
+    {
+      return (keys[a] != keys[b]) ? (keys[a] < keys[b]) : (a < b);
+    });
+  }
+
+  //find the runs of ties, and how many orderings they make between them
+  std::size_t count = 1;
+  this->runs.clear();
+
+  for (std::size_t segment = 0; segment <= root; segment++)
+  {
+    const std::size_t start = (segment == 0) ? 0 : root + (segment - 1) * root;
+
+    for (std::size_t lo = 0; lo < root; )
+    {
+      std::size_t hi = lo + 1;
+
+      while (hi < root &&
+             ((segment == 0) ? (group_keys[seq[start + hi]] == group_keys[seq[start + lo]])
+                             : (line_keys[(segment - 1) * root + seq[start + hi]] ==
+                                line_keys[(segment - 1) * root + seq[start + lo]])))
+      {
+        hi++;
+      }
+
+      if (hi - lo > 1)
+      {
+        this->runs.push_back(start + lo);
+        this->runs.push_back(start + hi);
+
+        for (std::size_t k = 2; k <= hi - lo && count <= max_candidates; k++)
+        {
+          count *= k;
+        }
+      }
+
+      lo = hi;
+    }
+  }
+
+  orders.clear();
+
+  for (;;)
+  {
+    for (std::size_t p = 0; p < root; p++)
+    {
+      const std::size_t g = seq[p];
+
+      for (std::size_t k = 0; k < root; k++)
+      {
+        orders.push_back(std::uint8_t(g * root + seq[root + g * root + k]));
+      }
+    }
+
+    //there are too many ties to try them all, so the first ordering will have to do
+    if (count > max_candidates)
+    {
+      return 0;
+    }
+
+    //turn the odometer: every run steps through its permutations, carrying into the next one
+    std::size_t r = 0;
+
+    while (r < this->runs.size() &&
+           !std::next_permutation(seq.begin() + this->runs[r], seq.begin() + this->runs[r + 1]))
+    {
+      r += 2;
+    }
+
+    if (r == this->runs.size())
+    {
+      return count;
+    }
+  }
+}
+
+void CanonicalForm::try_order(bool transposed, std::uint8_t const* rows,
+                              std::uint8_t const* columns)
+{
+  const std::size_t n = this->dim;
+  std::uint8_t const* best = this->form.data();
+  std::uint8_t* candidate = this->candidate.data();
+  std::uint8_t map[65] = { 0 };
+  std::uint8_t next = 1;
+  bool decided = !this->found;
+
+  for (std::size_t y = 0; y < n; y++)
+  {
+    std::uint8_t const* row = &this->oriented[rows[y] * n];
+
+    for (std::size_t x = 0; x < n; x++)
+    {
+      const std::size_t k = y * n + x;
+      std::uint8_t value = row[columns[x]];
+
+      //the values are relabeled in the order they appear, so relabeled boards compare equal
+      if (value != 0)
+      {
+        if (map[value] == 0)
+        {
+          map[value] = next++;
+        }
+
+        value = map[value];
+      }
+
+      //give up on this ordering as soon as it is bigger than the best one
+      if (!decided)
+      {
+        if (value > best[k])
+        {
+          return;
+        }
+
+        decided = (value < best[k]);
+      }
+
+      candidate[k] = value;
+    }
+  }
+
+  //an ordering that ties with the best one gives the same form, so it can be ignored
+  if (!decided)
+  {
+    return;
+  }
+
+  std::copy(candidate, candidate + n * n, this->form.data());
+  std::copy(rows, rows + n, this->row_order.begin());
+  std::copy(columns, columns + n, this->column_order.begin());
+  std::copy(map, map + 65, this->labels);
+  this->transposed = transposed;
+  this->found = true;
+}
+
+bool CanonicalForm::compute(Grid const& puzzle)
+{
+  const std::size_t n = puzzle.n();
+  std::uint8_t const* cells = puzzle.data();
+  bool exact = true;
+
+  this->dim = n;
+  this->root = std::size_t(std::sqrt(double(n)) + 0.5);
+  this->found = false;
+  this->form.reset(n);
+  this->oriented.resize(n * n);
+  this->candidate.resize(n * n);
+  this->row_order.resize(n);
+  this->column_order.resize(n);
+  this->row_keys.resize(n);
+  this->column_keys.resize(n);
+  this->row_counts.resize(n);
+  this->column_counts.resize(n);
+  this->band_keys.resize(this->root);
+  this->stack_keys.resize(this->root);
+
+  for (int transposed = 0; transposed < 2; transposed++)
+  {
+    for (std::size_t y = 0; y < n; y++)
+    {
+      for (std::size_t x = 0; x < n; x++)
+      {
+        this->oriented[y * n + x] = transposed ? cells[x * n + y] : cells[y * n + x];
+      }
+    }
+
+    this->compute_invariants();
+
+    std::size_t rows = this->list_orders(this->row_keys, this->band_keys, this->row_orders);
+    std::size_t columns = this->list_orders(this->column_keys, this->stack_keys,
+                                            this->column_orders);
+
+    if (rows == 0 || columns == 0 || rows * columns > max_candidates)
+    {
+      exact = false;
+      rows = 1;
+      columns = 1;
+    }
+
+    for (std::size_t r = 0; r < rows; r++)
+    {
+      for (std::size_t c = 0; c < columns; c++)
+      {
+        this->try_order(transposed != 0, &this->row_orders[r * n], &this->column_orders[c * n]);
+      }
+    }
+  }
+
+  //the values that aren't on the board can go anywhere, so they get the remaining labels in order
+  std::uint8_t next = 1;
+
+  for (std::size_t v = 1; v <= n; v++)
+  {
+    if (this->labels[v] != 0)
+    {
+      next++;
+    }
+  }
+
+  for (std::size_t v = 1; v <= n; v++)
+  {
+    if (this->labels[v] == 0)
+    {
+      this->labels[v] = next++;
+    }
+
+    this->values[this->labels[v]] = std::uint8_t(v);
+  }
+
+  this->labels[0] = 0;
+  this->values[0] = 0;
+  return exact;
+}
+
+Grid const& CanonicalForm::grid() const
+{
+  return this->form;
+}
+
+void CanonicalForm::to_canonical(Grid const& solution, Grid& out) const
+{
+  const std::size_t n = this->dim;
+  std::uint8_t const* cells = solution.data();
+
+  out.reset(n);
+  std::uint8_t* canonical = out.data();
+
+  for (std::size_t y = 0; y < n; y++)
+  {
+    for (std::size_t x = 0; x < n; x++)
+    {
+      const std::size_t r = this->row_order[y], c = this->column_order[x];
+      canonical[y * n + x] = this->labels[cells[this->transposed ? c * n + r : r * n + c]];
+    }
+  }
+}
+
+void CanonicalForm::from_canonical(Grid const& solution, Grid& out) const
+{
+  const std::size_t n = this->dim;
+  std::uint8_t const* canonical = solution.data();
+
+  out.reset(n);
+  std::uint8_t* cells = out.data();
+
+  for (std::size_t y = 0; y < n; y++)
+  {
+    for (std::size_t x = 0; x < n; x++)
+    {
+      const std::size_t r = this->row_order[y], c = this->column_order[x];
+      cells[this->transposed ? c * n + r : r * n + c] = this->values[canonical[y * n + x]];
+    }
+  }
+}
+
+CanonicalForm::~CanonicalForm()
+{
+}
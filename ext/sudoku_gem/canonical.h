@@ -0,0 +1,189 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CANONICAL_H
+#define CANONICAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "grid.h"
+
+/**
+ * @brief The canonical form of a Sudoku board under the symmetries that keep it a Sudoku board
+ *        (relabeling the values, permuting the bands and the rows within a band, permuting the
+ *        stacks and the columns within a stack, and transposing), along with the transformation
+ *        that takes the board there
+ *
+ * Two boards that are the same up to those symmetries get the same form, so a solution that was
+ * found for one of them can be mapped onto the other (see SolutionCache). Trying every symmetry
+ * would take millions of comparisons per board, so the form is found in two steps instead. First,
+ * the rows and columns are ordered by invariants that none of the symmetries change (how many
+ * values a row has, and how full the columns they are in are), and the bands and stacks by the
+ * invariants of their rows and columns. Then, every ordering that only differs in rows, columns,
+ * bands or stacks whose invariants are tied is tried, on both orientations, and the one that is
+ * smallest in row-major order (after its values are relabeled in the order they appear) wins.
+ *
+ * If there are too many ties to try them all (e.g., on a nearly empty board), only the first
+ * ordering is tried, and the form is not canonical any more: an equivalent board may get a
+ * different form. The form is still the board under a valid transformation, though, so a mapped
+ * solution is always a solution; only the chance of finding it is lost.
+ **/
+class CanonicalForm
+{
+public:
+  /**
+   * @brief The most orderings of each orientation that compute() tries.
+   **/
+  static const std::size_t max_candidates = 256;
+
+  /**
+   * @brief Constructor for a CanonicalForm instance, which has the form of an empty 0*0 board.
+   **/
+  CanonicalForm();
+  virtual ~CanonicalForm();
+
+  /**
+   * @brief Find the canonical form of a board. The buffers are reused from one board to the next,
+   *        so this only allocates when the boards get bigger.
+   *
+   * @param puzzle The board, with 0 for unknown values.
+   * @return bool Whether the form is really canonical (i.e., whether every tie was tried).
+   **/
+  bool compute(Grid const& puzzle);
+  /**
+   * @brief Accessor for CanonicalForm::form
+   *
+   * @return Grid const& The canonical form of the last board.
+   **/
+  Grid const& grid() const;
+
+  /**
+   * @brief Take a solution of the last board to the canonical orientation and labels.
+   *
+   * @param solution A solution of the last board that compute() was given.
+   * @param out Overwritten with the solution of the canonical form.
+   **/
+  void to_canonical(Grid const& solution, Grid& out) const;
+  /**
+   * @brief Take a solution of the canonical form back to the orientation and labels of the last
+   *        board.
+   *
+   * @param solution A solution of the canonical form.
+   * @param out Overwritten with the solution of the last board that compute() was given.
+   **/
+  void from_canonical(Grid const& solution, Grid& out) const;
+
+private:
+  /**
+   * @brief Helper method for computing the invariants of one orientation of the board, which is
+   *        in CanonicalForm::oriented.
+   **/
+  void compute_invariants();
+  /**
+   * @brief Helper method for listing every ordering of the rows (or columns) that keeps them
+   *        sorted by their invariants.
+   *
+   * @param line_keys The invariants of the rows, one per row.
+   * @param group_keys The invariants of the bands, one per band.
+   * @param orders Overwritten with the orderings, one after another (n entries each).
+   * @return std::size_t The number of orderings, or 0 if there are more than max_candidates
+   *         (in which case only the first one is listed).
+   **/
+  std::size_t list_orders(std::vector<std::uint64_t> const& line_keys,
+                          std::vector<std::uint64_t> const& group_keys,
+                          std::vector<std::uint8_t>& orders);
+  /**
+   * @brief Helper method for trying one ordering of the oriented board, and keeping it if it is
+   *        the smallest so far.
+   *
+   * @param transposed Whether the oriented board is the transpose of the board.
+   * @param rows The order of the rows.
+   * @param columns The order of the columns.
+   **/
+  void try_order(bool transposed, std::uint8_t const* rows, std::uint8_t const* columns);
+
+  /**
+   * @brief The side length of the last board.
+   **/
+  std::size_t dim;
+  /**
+   * @brief The side length of a block of the last board.
+   **/
+  std::size_t root;
+  /**
+   * @brief The canonical form of the last board.
+   **/
+  Grid form;
+  /**
+   * @brief Whether a form has been found yet, while compute() is running.
+   **/
+  bool found;
+  /**
+   * @brief Whether the form is the transpose of the board, permuted.
+   **/
+  bool transposed;
+  /**
+   * @brief The row (of the oriented board) that every row of the form comes from.
+   **/
+  std::vector<std::uint8_t> row_order;
+  /**
+   * @brief The column (of the oriented board) that every column of the form comes from.
+   **/
+  std::vector<std::uint8_t> column_order;
+  /**
+   * @brief The label in the form of every value of the board (0 stays 0). The values that are
+   *        not on the board get the labels after the ones that are, in order.
+   **/
+  std::uint8_t labels[65];
+  /**
+   * @brief The value on the board of every label in the form (the inverse of labels).
+   **/
+  std::uint8_t values[65];
+
+  /**
+   * @brief The board in the orientation that is being tried.
+   **/
+  std::vector<std::uint8_t> oriented;
+  /**
+   * @brief The invariants of the rows, the columns, the bands and the stacks of the oriented
+   *        board.
+   **/
+  std::vector<std::uint64_t> row_keys, column_keys, band_keys, stack_keys;
+  /**
+   * @brief The number of values in every row and column of the oriented board.
+   **/
+  std::vector<std::size_t> row_counts, column_counts;
+  /**
+   * @brief The orderings of the rows and the columns that are tried, and the odometer that lists
+   *        them.
+   **/
+  std::vector<std::uint8_t> row_orders, column_orders, seq;
+  /**
+   * @brief The runs of tied entries of the odometer, as pairs of their first and one past their
+   *        last position.
+   **/
+  std::vector<std::size_t> runs;
+  /**
+   * @brief The ordering that is being tried, relabeled.
+   **/
+  std::vector<std::uint8_t> candidate;
+};
+
+#endif // CANONICAL_H
@@ -0,0 +1,117 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COLOR_MASK_H
+#define COLOR_MASK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+/**
+ * @brief The narrowest unsigned integer with one bit for every color of a N*N board. A size of 0
+ *        means that the size is only known at runtime, so the mask has to fit up to 64 colors.
+ *
+ * Color masks are encoded the same way everywhere: the least significant bit corresponds to the
+ * color 1, the next bit corresponds to the color 2, and so on. Boards are limited to 64*64, so a
+ * 64-bit integer always has room for every color; all of the shifts below are done on the mask
+ * type itself (never on int), since shifting an int by 31 or more is undefined.
+ **/
+template <std::size_t N>
+struct ColorMask
+{
+  typedef typename std::conditional<(N <= 16), std::uint16_t,
+    typename std::conditional<(N <= 32), std::uint32_t, std::uint64_t>::type>::type type;
+};
+
+template <>
+struct ColorMask<0>
+{
+  typedef std::uint_fast64_t type;
+};
+
+/**
+ * @brief The mask with only a single color set
+ *
+ * @param i The color, in [1, 64].
+ * @return Mask The mask.
+ **/
+template <typename Mask>
+inline Mask color_bit(int i)
+{
+  return Mask(Mask(1) << (i - 1));
+}
+
+/**
+ * @brief The mask with every color of a n*n board set (i.e., the lowest n bits)
+ *
+ * @param n The side length of the board, in [0, 64].
+ * @return Mask The mask.
+ **/
+template <typename Mask>
+inline Mask all_colors(std::size_t n)
+{
+  //shifting a 64-bit integer by 64 is undefined, so the full 64*64 board needs its own case
+  return Mask((n >= 64) ? ~std::uint64_t(0) : ((std::uint64_t(1) << n) - 1));
+}
+
+/**
+ * @brief The number of colors in a mask
+ *
+ * @param mask The mask.
+ * @return int The number of bits that are set.
+ **/
+inline int count_colors(std::uint64_t mask)
+{
+#if defined(__GNUC__)
+  return __builtin_popcountll(mask);
+#else
+  int count = 0;
+
+  for (; mask != 0; mask &= mask - 1)
+  {
+    count++;
+  }
+
+  return count;
+#endif
+}
+
+/**
+ * @brief The smallest color in a mask
+ *
+ * @param mask The mask. Must not be 0.
+ * @return int The color corresponding to the least significant bit that is set.
+ **/
+inline int lowest_color(std::uint64_t mask)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll(mask) + 1;
+#else
+  int i = 1;
+
+  for (; (mask & 1) == 0; mask >>= 1)
+  {
+    i++;
+  }
+
+  return i;
+#endif
+}
+
+#endif // COLOR_MASK_H
@@ -0,0 +1,340 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dlx.h"
+
+#include <cmath>
+
+DancingLinks::DancingLinks(Grid const& grid) : first_row(0), dim(grid.n()), budget(0)
+{
+  const std::size_t n = this->dim, n_root = std::size_t(sqrt(n) + 0.5);
+  std::vector<std::uint_fast64_t> row_masks(n, 0), column_masks(n, 0), block_masks(n, 0);
+
+  //figure out which colors are already used by every row, column and block
+  for (std::size_t y = 0; y < n; y++)
+  {
+    for (std::size_t x = 0; x < n; x++)
+    {
+      int a = grid.get(x, y);
+
+      if (a != -1)
+      {
+        std::uint_fast64_t bit = color_bit<std::uint_fast64_t>(a);
+        row_masks[y] |= bit;
+        column_masks[x] |= bit;
+        block_masks[(y / n_root) * n_root + (x / n_root)] |= bit;
+      }
+    }
+  }
+
+  //the root is its own, empty, circular list
+  Node root = { 0, 0, 0, 0, 0 };
+  this->nodes.push_back(root);
+  this->sizes.push_back(0);
+  this->headers.assign(4 * n * n, 0);
+
+  //add a column for every constraint that the known values don't satisfy yet
+  for (std::size_t y = 0; y < n; y++)
+  {
+    for (std::size_t x = 0; x < n; x++)
+    {
+      if (grid.get(x, y) == -1)
+      {
+        this->add_column(y * n + x);
+      }
+    }
+  }
+
+  for (std::size_t unit = 0; unit < n; unit++)
+  {
+    for (std::size_t i = 0; i < n; i++)
+    {
+      std::uint_fast64_t bit = color_bit<std::uint_fast64_t>(int(i) + 1);
+
+      if ((row_masks[unit] & bit) == 0)
+      {
+        this->add_column(n * n + unit * n + i);
+      }
+
+      if ((column_masks[unit] & bit) == 0)
+      {
+        this->add_column(2 * n * n + unit * n + i);
+      }
+
+      if ((block_masks[unit] & bit) == 0)
+      {
+        this->add_column(3 * n * n + unit * n + i);
+      }
+    }
+  }
+
+  //add a row for every color that every unknown cell may use
+  this->first_row = (std::uint32_t)this->nodes.size();
+
+  for (std::size_t y = 0; y < n; y++)
+  {
+    for (std::size_t x = 0; x < n; x++)
+    {
+      if (grid.get(x, y) == -1)
+      {
+        std::uint_fast64_t colors = all_colors<std::uint_fast64_t>(n) & ~(row_masks[y] |
+          column_masks[x] | block_masks[(y / n_root) * n_root + (x / n_root)]);
+
+        for (; colors != 0; colors &= colors - 1)
+        {
+          this->add_row(x, y, lowest_color(colors));
+        }
+      }
+    }
+  }
+
+  //every level of the search colors one unknown cell
+  this->row_stack.resize(n * n + 1);
+  this->column_stack.resize(n * n + 1);
+}
+
+void DancingLinks::add_column(std::size_t constraint)
+{
+  std::uint32_t c = (std::uint32_t)this->nodes.size();
+
+  //append the header to the end of the root's list
+  Node header = { this->nodes[0].left, 0, c, c, c };
+  this->nodes.push_back(header);
+  this->nodes[header.left].right = c;
+  this->nodes[0].left = c;
+
+  this->sizes.push_back(0);
+  this->headers[constraint] = c;
+}
+
+void DancingLinks::add_row(std::size_t x, std::size_t y, int i)
+{
+  const std::size_t n = this->dim, n_root = std::size_t(sqrt(n) + 0.5);
+  const std::size_t block = (y / n_root) * n_root + (x / n_root);
+  const std::size_t constraints[4] = {
+    y * n + x,
+    n * n + y * n + (i - 1),
+    2 * n * n + x * n + (i - 1),
+    3 * n * n + block * n + (i - 1)
+  };
+  std::uint32_t first = (std::uint32_t)this->nodes.size();
+
+  for (std::uint32_t k = 0; k < 4; k++)
+  {
+    std::uint32_t node = first + k, c = this->headers[constraints[k]];
+
+    //link the node into its row (a ring of 4), and append it to the bottom of its column
+    Node element = { first + (k + 3) % 4, first + (k + 1) % 4, this->nodes[c].up, c, c };
+    this->nodes.push_back(element);
+    this->nodes[element.up].down = node;
+    this->nodes[c].up = node;
+    this->sizes[c]++;
+  }
+
+  this->choices.push_back((std::uint32_t)(y * n + x));
+  this->choices.push_back((std::uint32_t)i);
+}
+
+void DancingLinks::cover(std::uint32_t c)
+{
+  std::vector<Node>& m = this->nodes;
+
+  m[m[c].right].left = m[c].left;
+  m[m[c].left].right = m[c].right;
+
+  for (std::uint32_t i = m[c].down; i != c; i = m[i].down)
+  {
+    for (std::uint32_t j = m[i].right; j != i; j = m[j].right)
+    {
+      m[m[j].down].up = m[j].up;
+      m[m[j].up].down = m[j].down;
+      this->sizes[m[j].column]--;
+    }
+  }
+}
+
+void DancingLinks::uncover(std::uint32_t c)
+{
+  std::vector<Node>& m = this->nodes;
+
+  for (std::uint32_t i = m[c].up; i != c; i = m[i].up)
+  {
+    for (std::uint32_t j = m[i].left; j != i; j = m[j].left)
+    {
+      this->sizes[m[j].column]++;
+      m[m[j].down].up = j;
+      m[m[j].up].down = j;
+    }
+  }
+
+  m[m[c].right].left = c;
+  m[m[c].left].right = c;
+}
+
+void DancingLinks::select(std::uint32_t r)
+{
+  for (std::uint32_t j = this->nodes[r].right; j != r; j = this->nodes[j].right)
+  {
+    this->cover(this->nodes[j].column);
+  }
+}
+
+void DancingLinks::deselect(std::uint32_t r)
+{
+  for (std::uint32_t j = this->nodes[r].left; j != r; j = this->nodes[j].left)
+  {
+    this->uncover(this->nodes[j].column);
+  }
+}
+
+std::uint32_t DancingLinks::choose_column() const
+{
+  std::uint32_t best = this->nodes[0].right, best_size = this->sizes[best];
+
+  for (std::uint32_t c = this->nodes[best].right; c != 0 && best_size > 1; c = this->nodes[c].right)
+  {
+    if (this->sizes[c] < best_size)
+    {
+      best = c;
+      best_size = this->sizes[c];
+    }
+  }
+
+  return best;
+}
+
+std::size_t DancingLinks::solve(std::size_t limit)
+{
+  std::size_t found = 0, depth = 0;
+  SearchBudget::Meter meter(this->budget);
+
+  this->counters = SearchStats();
+
+  //if every constraint is already satisfied, then the board is already solved
+  if (this->nodes[0].right == 0)
+  {
+    this->solution.clear();
+    return 1;
+  }
+
+  std::uint32_t c = this->choose_column();
+  this->cover(c);
+  this->column_stack[0] = c;
+  this->row_stack[0] = this->nodes[c].down;
+
+  while (true)
+  {
+    if (meter.tick())
+    {
+      //we're out of time, so put the matrix back together and give up
+      this->uncover(this->column_stack[depth]);
+
+      while (depth > 0)
+      {
+        depth--;
+        this->deselect(this->row_stack[depth]);
+        this->uncover(this->column_stack[depth]);
+      }
+
+      break;
+    }
+
+    std::uint32_t r = this->row_stack[depth];
+
+    if (r == this->column_stack[depth])
+    {
+      //we ran out of rows for this column, so backtrack
+      this->uncover(this->column_stack[depth]);
+
+      if (depth == 0)
+      {
+        break;
+      }
+
+      depth--;
+      this->counters.backtrack();
+      this->deselect(this->row_stack[depth]);
+      this->row_stack[depth] = this->nodes[this->row_stack[depth]].down;
+      continue;
+    }
+
+    this->select(r);
+    this->counters.node();
+    this->counters.reached(depth + 1);
+
+    if (this->nodes[0].right == 0)
+    {
+      //every constraint is satisfied, so this is a solution
+      found++;
+      this->solution.assign(this->row_stack.begin(), this->row_stack.begin() + depth + 1);
+      this->deselect(r);
+      this->row_stack[depth] = this->nodes[r].down;
+
+      if (found >= limit)
+      {
+        //put the matrix back together before we stop
+        this->uncover(this->column_stack[depth]);
+
+        while (depth > 0)
+        {
+          depth--;
+          this->deselect(this->row_stack[depth]);
+          this->uncover(this->column_stack[depth]);
+        }
+
+        break;
+      }
+
+      continue;
+    }
+
+    //go one level deeper, on the most constrained column
+    c = this->choose_column();
+    depth++;
+    this->cover(c);
+    this->column_stack[depth] = c;
+    this->row_stack[depth] = this->nodes[c].down;
+  }
+
+  return found;
+}
+
+void DancingLinks::fill(Grid& grid) const
+{
+  for (std::size_t k = 0; k < this->solution.size(); k++)
+  {
+    std::uint32_t row = (this->solution[k] - this->first_row) / 4;
+    std::uint32_t cell = this->choices[2 * row], color = this->choices[2 * row + 1];
+
+    grid.set(cell % this->dim, cell / this->dim, (int)color);
+  }
+}
+
+SearchStats const& DancingLinks::stats() const
+{
+  return this->counters;
+}
+
+void DancingLinks::set_budget(SearchBudget* budget)
+{
+  this->budget = budget;
+}
+
+DancingLinks::~DancingLinks()
+{
+}
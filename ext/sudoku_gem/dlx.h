@@ -0,0 +1,181 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DLX_H
+#define DLX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "budget.h"
+#include "color_mask.h"
+#include "grid.h"
+#include "stats.h"
+
+/**
+ * @brief An exact cover solver for Sudoku boards, using Knuth's dancing links (Algorithm X)
+ *
+ * A n*n Sudoku board is an exact cover problem with 4*n*n constraints (columns): every cell needs
+ * exactly one color, and every row, every column and every block needs every color exactly once.
+ * Each way of coloring an unknown cell is a row of the exact cover matrix, which satisfies four
+ * of those constraints. The constraints that are already satisfied by the known values of the
+ * board are left out of the matrix, and so are the rows that would conflict with the known values.
+ *
+ * The matrix is stored as a sparse, circular, doubly-linked mesh of nodes in a single array, and
+ * the search is iterative (with an explicit stack), so a 64*64 board cannot overflow the stack.
+ **/
+class DancingLinks
+{
+public:
+  /**
+   * @brief Build the exact cover matrix for a given board
+   *
+   * @param grid A Sudoku board with no repeated elements (see Validator::is_good_partial_board).
+   **/
+  DancingLinks(Grid const& grid);
+  virtual ~DancingLinks();
+
+  /**
+   * @brief Look for exact covers (i.e., solutions of the board), stopping as soon as enough of
+   *        them have been found (or the budget runs out, see set_budget()). The matrix is
+   *        restored before the method returns, so it is okay to call this more than once.
+   *
+   * @param limit The number of solutions after which the search should stop. Must be at least 1.
+   * @return std::size_t The number of solutions that were found (at most limit).
+   **/
+  std::size_t solve(std::size_t limit);
+
+  /**
+   * @brief Write the last solution that was found by solve() onto a grid
+   *
+   * @param grid The board that the matrix was built from.
+   **/
+  void fill(Grid& grid) const;
+  /**
+   * @brief What the last solve() did
+   *
+   * @return SearchStats const& The counts of the last solve().
+   **/
+  SearchStats const& stats() const;
+  /**
+   * @brief Limit the next solve(), which then gives up as soon as the budget runs out (see
+   *        SearchBudget). By default, there is no limit.
+   *
+   * @param budget The budget, or NULL for no limit. It must outlive its use by this object.
+   **/
+  void set_budget(SearchBudget* budget);
+
+private:
+  /**
+   * @brief One element of the mesh. Column headers are nodes too, and the root is node 0.
+   **/
+  struct Node
+  {
+    std::uint32_t left, right, up, down, column;
+  };
+
+  /**
+   * @brief Helper method for adding a column header for a constraint
+   *
+   * @param constraint The index of the constraint, in [0, 4*n*n).
+   **/
+  void add_column(std::size_t constraint);
+  /**
+   * @brief Helper method for adding a row for an (unknown cell, color) pair
+   *
+   * @param x The x position of the cell.
+   * @param y The y position of the cell.
+   * @param i The color of the cell.
+   **/
+  void add_row(std::size_t x, std::size_t y, int i);
+
+  /**
+   * @brief Remove a column, and every row that intersects it, from the matrix
+   *
+   * @param c The column header.
+   **/
+  void cover(std::uint32_t c);
+  /**
+   * @brief Undo cover()
+   *
+   * @param c The column header.
+   **/
+  void uncover(std::uint32_t c);
+  /**
+   * @brief Cover every other column of a row (i.e., commit to using this row)
+   *
+   * @param r A node of the row.
+   **/
+  void select(std::uint32_t r);
+  /**
+   * @brief Undo select()
+   *
+   * @param r The same node that was passed to select().
+   **/
+  void deselect(std::uint32_t r);
+  /**
+   * @brief Find the column with the fewest rows left
+   *
+   * @return std::uint32_t The column header.
+   **/
+  std::uint32_t choose_column() const;
+
+  /**
+   * @brief The mesh: the root, then the column headers, then four nodes for every row.
+   **/
+  std::vector<Node> nodes;
+  /**
+   * @brief The number of rows left in each column, indexed by the column header's node.
+   **/
+  std::vector<std::uint32_t> sizes;
+  /**
+   * @brief The column header of every constraint, or 0 if the constraint is already satisfied.
+   **/
+  std::vector<std::uint32_t> headers;
+  /**
+   * @brief The cell (encoded as y * n + x) and the color used by every row, in that order.
+   **/
+  std::vector<std::uint32_t> choices;
+  /**
+   * @brief The rows that were chosen at each level of the search, and their columns.
+   **/
+  std::vector<std::uint32_t> row_stack, column_stack;
+  /**
+   * @brief The rows of the last solution that was found.
+   **/
+  std::vector<std::uint32_t> solution;
+  /**
+   * @brief The index of the first row node.
+   **/
+  std::uint32_t first_row;
+  /**
+   * @brief The side length of the board.
+   **/
+  std::size_t dim;
+  /**
+   * @brief The counts of the last solve().
+   **/
+  SearchStats counters;
+  /**
+   * @brief The limits on solve(), if any.
+   **/
+  SearchBudget* budget;
+};
+
+#endif // DLX_H
@@ -1,7 +1,8 @@
 require 'mkmf'
 
 CONFIG['CC'] = CONFIG['CXX'] or 'g++'
-$CFLAGS << ' --std=c++11'
+$CFLAGS << ' --std=c++11 -pthread'
+$LDFLAGS << ' -pthread'
 have_library('stdc++')
 $warnflags.gsub!(' -Wdeclaration-after-statement','')
 $warnflags.gsub!(' -Wimplicit-function-declaration','')
@@ -0,0 +1,374 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "generator.h"
+
+#include <atomic>
+#include <cmath>
+
+#include "parser.h"
+
+const std::size_t Generator::hard_backtracks;
+const std::size_t Generator::default_check_nodes;
+
+namespace
+{
+  //a fisher-yates shuffle that only depends on the generator (unlike std::shuffle, whose choices
+  //differ between standard libraries), so a seed makes the same puzzle everywhere
+  template <typename Iterator>
+  void shuffle(Iterator first, Iterator last, std::mt19937_64& random)
+  {
+    for (std::size_t k = std::size_t(last - first); k > 1; k--)
+    {
+      std::swap(first[k - 1], first[random() % k]);
+    }
+  }
+}
+
+Generator::Generator() : overall(0), check_nodes(default_check_nodes), board(0)
+{
+  this->set_budget(0);
+}
+
+std::uint64_t Generator::seed_for(std::uint64_t seed, std::size_t index)
+{
+  //splitmix64, over the seed of the batch stepped once per puzzle
+  std::uint64_t z = seed + (std::uint64_t(index) + 1) * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+Generator::Difficulty Generator::rate(SearchStats const& stats, double& score)
+{
+  if (stats.nodes == 0)
+  {
+    score = 0;
+    return DIFFICULTY_EASY;
+  }
+
+  score = 1 + std::log2(1 + double(stats.backtracks));
+
+  if (stats.backtracks == 0)
+  {
+    return DIFFICULTY_MEDIUM;
+  }
+
+  return (stats.backtracks < hard_backtracks) ? DIFFICULTY_HARD : DIFFICULTY_EXPERT;
+}
+
+void Generator::set_budget(SearchBudget* budget)
+{
+  this->overall = budget;
+  this->check.reset(new SearchBudget(budget));
+  this->check->set_node_limit(this->check_nodes);
+  this->sudoku.set_budget(budget);
+}
+
+void Generator::set_check_limit(std::size_t nodes)
+{
+  this->check_nodes = nodes;
+  this->check->set_node_limit(nodes);
+}
+
+void Generator::shuffle_lines(std::vector<std::size_t>& order, std::size_t n, std::size_t root)
+{
+  this->bands.resize(root);
+
+  for (std::size_t k = 0; k < root; k++)
+  {
+    this->bands[k] = k;
+  }
+
+  shuffle(this->bands.begin(), this->bands.end(), this->random);
+  order.resize(n);
+
+  for (std::size_t b = 0; b < root; b++)
+  {
+    std::vector<std::size_t>::iterator band = order.begin() + b * root;
+
+    for (std::size_t k = 0; k < root; k++)
+    {
+      band[k] = this->bands[b] * root + k;
+    }
+
+    shuffle(band, band + root, this->random);
+  }
+}
+
+bool Generator::fill(std::size_t n, Grid& solution)
+{
+  const std::size_t root = std::size_t(std::sqrt(double(n)) + 0.5);
+
+  this->values.resize(n);
+
+  for (std::size_t k = 0; k < n; k++)
+  {
+    this->values[k] = k + 1;
+  }
+
+  //the diagonal blocks don't share a row or a column, so they can be filled in independently
+  do
+  {
+    this->board.reset(n);
+    std::uint8_t* cells = this->board.data();
+
+    for (std::size_t b = 0; b < root; b++)
+    {
+      shuffle(this->values.begin(), this->values.end(), this->random);
+
+      for (std::size_t k = 0; k < n; k++)
+      {
+        cells[(b * root + k / root) * n + b * root + k % root] = std::uint8_t(this->values[k]);
+      }
+    }
+
+    this->sudoku.load(this->board);
+
+    if (this->sudoku.solve() == Sudoku::STATUS_TIMED_OUT)
+    {
+      return false;
+    }
+  }
+  while (this->sudoku.get_status() != Sudoku::STATUS_OK);
+
+  //the solver fills in the rest the same way every time, so shuffle its choices around
+  this->shuffle_lines(this->rows, n, root);
+  this->shuffle_lines(this->columns, n, root);
+
+  std::uint8_t const* filled = this->sudoku.get_grid().data();
+  solution.reset(n);
+  std::uint8_t* cells = solution.data();
+
+  for (std::size_t y = 0; y < n; y++)
+  {
+    for (std::size_t x = 0; x < n; x++)
+    {
+      cells[y * n + x] = filled[this->rows[y] * n + this->columns[x]];
+    }
+  }
+
+  return true;
+}
+
+bool Generator::unique_without(std::size_t cell, std::uint8_t value, bool& settled)
+{
+  const std::size_t n = this->board.n();
+  const std::size_t root = std::size_t(std::sqrt(double(n)) + 0.5);
+  const std::size_t x = cell % n, y = cell / n;
+  const std::size_t block_x = x - x % root, block_y = y - y % root;
+  std::uint8_t* cells = this->board.data();
+  std::uint64_t used = 0;
+
+  //the values that the row, the column and the block of the cell already have
+  for (std::size_t k = 0; k < n; k++)
+  {
+    const std::size_t peers[3] = { y * n + k, k * n + x,
+                                   (block_y + k / root) * n + block_x + k % root };
+
+    for (std::size_t p = 0; p < 3; p++)
+    {
+      if (cells[peers[p]] != 0)
+      {
+        used |= std::uint64_t(1) << (cells[peers[p]] - 1);
+      }
+    }
+  }
+
+  settled = true;
+
+  //every check gets the same number of nodes, no matter how many values it has to try
+  this->check->reset();
+  this->sudoku.set_budget(this->check.get());
+
+  bool unique = true;
+
+  for (std::size_t other = 1; other <= n && unique && settled; other++)
+  {
+    if (other == value || (used >> (other - 1)) & 1)
+    {
+      continue;
+    }
+
+    cells[cell] = std::uint8_t(other);
+    this->sudoku.load(this->board);
+
+    if (this->sudoku.count_solutions(1) != 0)
+    {
+      unique = false;
+    }
+    else if (this->check->expired())
+    {
+      settled = false;
+    }
+  }
+
+  cells[cell] = 0;
+  this->sudoku.set_budget(this->overall);
+  return unique;
+}
+
+bool Generator::generate(std::size_t n, std::size_t target_clues, std::uint64_t seed,
+                         Puzzle& out)
+{
+  if (!Parser::is_good_size(n))
+  {
+    return false;
+  }
+
+  this->random.seed(seed);
+
+  if (!this->fill(n, out.solution))
+  {
+    return false;
+  }
+
+  this->board = out.solution;
+  this->cells.resize(n * n);
+
+  for (std::size_t k = 0; k < n * n; k++)
+  {
+    this->cells[k] = k;
+  }
+
+  shuffle(this->cells.begin(), this->cells.end(), this->random);
+
+  std::uint8_t* cells = this->board.data();
+  std::size_t clues = n * n;
+
+  //take away every clue that the puzzle can do without, until it is down to the target
+  for (std::size_t k = 0; k < n * n && clues > target_clues; k++)
+  {
+    const std::size_t cell = this->cells[k];
+    const std::uint8_t value = cells[cell];
+    bool settled;
+
+    cells[cell] = 0;
+
+    const bool unique = this->unique_without(cell, value, settled);
+
+    if (this->overall != 0 && this->overall->expired())
+    {
+      return false;
+    }
+
+    //a check that ran out of nodes didn't show that the clue can go, so it stays
+    if (unique && settled)
+    {
+      clues--;
+    }
+    else
+    {
+      cells[cell] = value;
+    }
+  }
+
+  out.puzzle = this->board;
+  out.clues = clues;
+
+  //rate the puzzle by solving it from scratch (a generator has no thread pool, so the counts are
+  //the same every time)
+  this->sudoku.load(this->board);
+
+  if (this->sudoku.solve() != Sudoku::STATUS_OK)
+  {
+    return false;
+  }
+
+  out.stats = this->sudoku.get_stats();
+  out.difficulty = rate(out.stats, out.score);
+  return true;
+}
+
+std::size_t Generator::generate_batch(std::size_t n, std::size_t target_clues, std::uint64_t seed,
+                                      std::size_t count, std::vector<Puzzle>& puzzles)
+{
+  std::size_t made = 0;
+
+  puzzles.resize(count);
+
+  for (std::size_t k = 0; k < count; k++)
+  {
+    if (this->generate(n, target_clues, seed_for(seed, k), puzzles[k]))
+    {
+      made++;
+    }
+  }
+
+  return made;
+}
+
+Generator::~Generator()
+{
+}
+
+ParallelGenerator::ParallelGenerator(ThreadPool& pool) : pool(pool)
+{
+  for (std::size_t k = 0; k < pool.size(); k++)
+  {
+    this->generators.push_back(std::unique_ptr<Generator>(new Generator()));
+  }
+}
+
+std::size_t ParallelGenerator::generate_batch(std::size_t n, std::size_t target_clues,
+                                              std::uint64_t seed, std::size_t count,
+                                              std::vector<Generator::Puzzle>& puzzles)
+{
+  std::atomic<std::size_t> made(0);
+
+  //every task writes to its own slot, so the puzzles don't need a lock
+  puzzles.resize(count);
+
+  for (std::size_t k = 0; k < count; k++)
+  {
+    Generator::Puzzle* puzzle = &puzzles[k];
+
+    this->pool.submit([this, n, target_clues, seed, k, puzzle, &made]()
+    {
+      Generator& generator = *this->generators[ThreadPool::current_worker()];
+
+      if (generator.generate(n, target_clues, Generator::seed_for(seed, k), *puzzle))
+      {
+        made++;
+      }
+    });
+  }
+
+  this->pool.wait();
+  return made;
+}
+
+void ParallelGenerator::set_budget(SearchBudget* budget)
+{
+  for (std::size_t k = 0; k < this->generators.size(); k++)
+  {
+    this->generators[k]->set_budget(budget);
+  }
+}
+
+void ParallelGenerator::set_check_limit(std::size_t nodes)
+{
+  for (std::size_t k = 0; k < this->generators.size(); k++)
+  {
+    this->generators[k]->set_check_limit(nodes);
+  }
+}
+
+ParallelGenerator::~ParallelGenerator()
+{
+}
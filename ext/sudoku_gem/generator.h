@@ -0,0 +1,324 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "budget.h"
+#include "grid.h"
+#include "stats.h"
+#include "sudoku.h"
+#include "thread_pool.h"
+
+/**
+ * @brief A class for making new puzzles that have exactly one solution
+ *
+ * A Generator starts from a random solved board: it fills the blocks on the diagonal with random
+ * permutations (they don't share a row or a column, so any values will do), lets the solver
+ * finish the board, and then shuffles its bands, stacks, rows and columns. It then clears the
+ * cells one at a time, in a random order, and puts a value back whenever clearing it would let the
+ * puzzle have a second solution. The puzzle had only one solution before the cell was cleared, so
+ * any other solution has a different value in that cell: the check only tries the values that the
+ * row, column and block of the cell still allow, and only has to find out whether any of them can
+ * be finished at all (a cell that allows no other value is cleared without a search). The
+ * clearing stops once the puzzle is down to the number of clues it was asked for, or once every
+ * cell has been tried (in which case no clue can be taken away without losing the uniqueness).
+ *
+ * Every check gets a node limit of its own (see set_check_limit()), and a clue whose check runs
+ * out of it is kept, so a puzzle always gets made in a bounded amount of time; a big board just
+ * keeps more of its clues. The limit counts nodes rather than time, so it doesn't change which
+ * puzzle a seed makes. With the default limit, a 16*16 puzzle takes well under a second and a
+ * 25*25 puzzle a few seconds; bigger boards work too, but they keep most of their clues.
+ *
+ * Every puzzle is rated by solving it and looking at what the search had to do (see rate()). The
+ * puzzles only depend on their seed, so a batch comes out the same no matter how many threads it
+ * is made on (see generate_batch() and ParallelGenerator).
+ **/
+class Generator
+{
+public:
+  /**
+   * @brief How hard a puzzle is to solve
+   **/
+  enum Difficulty
+  {
+    /**
+     * @brief The puzzle is solved by propagation alone, with no guessing at all.
+     **/
+    DIFFICULTY_EASY,
+    /**
+     * @brief The solver has to guess, but none of its guesses turn out to be wrong.
+     **/
+    DIFFICULTY_MEDIUM,
+    /**
+     * @brief The solver has to take back a few guesses (fewer than hard_backtracks).
+     **/
+    DIFFICULTY_HARD,
+    /**
+     * @brief The solver has to take back many guesses.
+     **/
+    DIFFICULTY_EXPERT
+  };
+
+  /**
+   * @brief A puzzle that was made by generate(), along with its solution and its rating
+   **/
+  struct Puzzle
+  {
+    /**
+     * @brief Construct an empty 0*0 puzzle.
+     **/
+    Puzzle() : puzzle(0), solution(0), clues(0), score(0), difficulty(DIFFICULTY_EASY) {}
+
+    /**
+     * @brief The puzzle, with 0 for unknown values.
+     **/
+    Grid puzzle;
+    /**
+     * @brief The only solution of the puzzle.
+     **/
+    Grid solution;
+    /**
+     * @brief The number of known values of the puzzle.
+     **/
+    std::size_t clues;
+    /**
+     * @brief How hard the puzzle is, on a continuous scale (see rate()).
+     **/
+    double score;
+    /**
+     * @brief How hard the puzzle is.
+     **/
+    Difficulty difficulty;
+    /**
+     * @brief What the solver did on the puzzle, which the rating is based on.
+     **/
+    SearchStats stats;
+  };
+
+  /**
+   * @brief The number of backtracks at which a puzzle gets rated DIFFICULTY_EXPERT.
+   **/
+  static const std::size_t hard_backtracks = 64;
+  /**
+   * @brief The number of nodes that every uniqueness check may visit, by default.
+   **/
+  static const std::size_t default_check_nodes = 2000;
+
+  /**
+   * @brief Constructor for a Generator instance.
+   **/
+  Generator();
+  virtual ~Generator();
+
+  /**
+   * @brief Make a new puzzle.
+   *
+   * @param n The side length of the board. Must be a perfect square between 1 and 64.
+   * @param target_clues The number of clues the puzzle should be cut down to, or 0 to take away as
+   *                     many as possible. A puzzle may end up with more clues than this if no more
+   *                     of them can be taken away.
+   * @param seed The seed of the random choices. The same seed (and size and target) always makes
+   *             the same puzzle.
+   * @param out Overwritten with the puzzle. If it could not be made, its contents are unspecified.
+   * @return bool Whether the puzzle was made (i.e., whether the size was good and the budget
+   *         lasted).
+   **/
+  bool generate(std::size_t n, std::size_t target_clues, std::uint64_t seed, Puzzle& out);
+  /**
+   * @brief Make a batch of puzzles, one after another.
+   *
+   * @param n The side length of the boards.
+   * @param target_clues The number of clues every puzzle should be cut down to, or 0.
+   * @param seed The seed of the batch. Every puzzle gets its own seed from it (see seed_for()).
+   * @param count The number of puzzles.
+   * @param puzzles Resized to count, and then overwritten with the puzzles, in order.
+   * @return std::size_t The number of puzzles that were made (which is count, unless the size was
+   *         bad or the budget ran out).
+   **/
+  std::size_t generate_batch(std::size_t n, std::size_t target_clues, std::uint64_t seed,
+                             std::size_t count, std::vector<Puzzle>& puzzles);
+  /**
+   * @brief Limit the searches of every puzzle that is made from now on (see
+   *        Sudoku::set_budget()). The budget is not reset between puzzles, so it limits the whole
+   *        batch. By default, there is no budget.
+   *
+   * @param budget The budget, or NULL for no limits. It must outlive its use by this object.
+   **/
+  void set_budget(SearchBudget* budget);
+  /**
+   * @brief Limit the search of every uniqueness check from now on. A clue whose check runs out of
+   *        nodes is kept, since it can't be shown that the puzzle does without it.
+   *
+   * @param nodes The number of nodes each check may visit, or 0 for no limit (in which case a
+   *              big board may take a very, very long time). Defaults to default_check_nodes.
+   **/
+  void set_check_limit(std::size_t nodes);
+
+  /**
+   * @brief Rate a puzzle by what the solver did on it. The score is 0 for a puzzle that is solved
+   *        by propagation alone, 1 for a puzzle that is solved by guesses that are never wrong,
+   *        and grows with the logarithm of the backtracks from there. If SUDOKU_NO_STATS was
+   *        defined, nothing is counted, so every puzzle is rated DIFFICULTY_EASY.
+   *
+   * @param stats What the solver did on the puzzle.
+   * @param score Overwritten with the score.
+   * @return Difficulty The difficulty.
+   **/
+  static Difficulty rate(SearchStats const& stats, double& score);
+  /**
+   * @brief The seed of a puzzle of a batch, which mixes the seed of the batch with the index of the
+   *        puzzle (so that neighbouring indices get unrelated seeds).
+   *
+   * @param seed The seed of the batch.
+   * @param index The index of the puzzle.
+   * @return std::uint64_t The seed of the puzzle.
+   **/
+  static std::uint64_t seed_for(std::uint64_t seed, std::size_t index);
+
+private:
+  /**
+   * @brief Helper method for making a random solved board.
+   *
+   * @param n The side length of the board.
+   * @param solution Overwritten with the board.
+   * @return bool Whether the board was made before the budget ran out.
+   **/
+  bool fill(std::size_t n, Grid& solution);
+  /**
+   * @brief Helper method for shuffling a list of rows (or columns) within their bands, and the
+   *        bands themselves.
+   *
+   * @param order Overwritten with the shuffled list, one entry per row.
+   * @param n The side length of the board.
+   * @param root The side length of a block.
+   **/
+  void shuffle_lines(std::vector<std::size_t>& order, std::size_t n, std::size_t root);
+  /**
+   * @brief Helper method for finding out whether the board keeps its only solution without one of
+   *        its clues, by looking for a solution with a different value in that cell.
+   *
+   * @param cell The index of the cell, which must have its clue already cleared.
+   * @param value The value the cell had, which is the value it has in the only solution.
+   * @param settled Overwritten with whether the check finished (rather than running out of
+   *                nodes, or running out of the budget of the whole puzzle).
+   * @return bool Whether no other value can be finished (if the check finished).
+   **/
+  bool unique_without(std::size_t cell, std::uint8_t value, bool& settled);
+
+  /**
+   * @brief The solver that fills the boards, checks their uniqueness and rates them, which is
+   *        reused (along with its buffers) for every puzzle.
+   **/
+  Sudoku sudoku;
+  /**
+   * @brief The budget of the whole puzzle, if any (see set_budget()).
+   **/
+  SearchBudget* overall;
+  /**
+   * @brief The budget that is reset for every uniqueness check, which runs out with the budget of
+   *        the whole puzzle.
+   **/
+  std::unique_ptr<SearchBudget> check;
+  /**
+   * @brief The number of nodes every uniqueness check may visit, or 0 for no limit.
+   **/
+  std::size_t check_nodes;
+  /**
+   * @brief The random choices of the puzzle that is being made.
+   **/
+  std::mt19937_64 random;
+  /**
+   * @brief The board that is being cut down.
+   **/
+  Grid board;
+  /**
+   * @brief The order in which the cells are cleared.
+   **/
+  std::vector<std::size_t> cells;
+  /**
+   * @brief The shuffled values, bands, rows and columns, kept around so their buffers can be
+   *        reused.
+   **/
+  std::vector<std::size_t> values, bands, rows, columns;
+};
+
+/**
+ * @brief A class for making many puzzles at the same time, on the workers of a ThreadPool.
+ *
+ * Every puzzle is its own task, and each worker makes its puzzles with its own Generator, so the
+ * workers never wait on each other. The puzzles get the same seeds as they would from
+ * Generator::generate_batch(), so they come out the same. A ParallelGenerator itself must only be
+ * used by one thread at a time.
+ **/
+class ParallelGenerator
+{
+public:
+  /**
+   * @brief Constructor for a ParallelGenerator instance.
+   *
+   * @param pool The workers that make the puzzles. It must outlive the generator, and it must not
+   *             be running any other tasks while generate_batch() is waiting on it.
+   **/
+  explicit ParallelGenerator(ThreadPool& pool);
+  virtual ~ParallelGenerator();
+
+  /**
+   * @brief Make a batch of puzzles. See Generator::generate_batch().
+   *
+   * @param n The side length of the boards.
+   * @param target_clues The number of clues every puzzle should be cut down to, or 0.
+   * @param seed The seed of the batch.
+   * @param count The number of puzzles.
+   * @param puzzles Resized to count, and then overwritten with the puzzles, in order.
+   * @return std::size_t The number of puzzles that were made.
+   **/
+  std::size_t generate_batch(std::size_t n, std::size_t target_clues, std::uint64_t seed,
+                             std::size_t count, std::vector<Generator::Puzzle>& puzzles);
+  /**
+   * @brief Limit the searches of every puzzle. See Generator::set_budget(). The budget is shared
+   *        by every worker.
+   *
+   * @param budget The budget, or NULL for no limits. It must outlive its use by this object.
+   **/
+  void set_budget(SearchBudget* budget);
+  /**
+   * @brief Limit the search of every uniqueness check. See Generator::set_check_limit().
+   *
+   * @param nodes The number of nodes each check may visit, or 0 for no limit.
+   **/
+  void set_check_limit(std::size_t nodes);
+
+private:
+  /**
+   * @brief The workers that make the puzzles.
+   **/
+  ThreadPool& pool;
+  /**
+   * @brief The generators, one per worker.
+   **/
+  std::vector<std::unique_ptr<Generator> > generators;
+};
+
+#endif // GENERATOR_H
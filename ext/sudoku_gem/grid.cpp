@@ -18,31 +18,61 @@
 
 #include "grid.h"
 
+#include <cstring>
 #include <sstream>
 
-Grid::Grid(std::size_t n) : matrix(boost::extents[n][n]), dim(n)
+const std::size_t Grid::inline_capacity;
+
+Grid::Grid(std::size_t n) : dim(0)
 {
+  this->reset(n);
 }
 
-Grid::Grid(const Grid& grid) : matrix(grid.matrix), dim(grid.dim)
+Grid::Grid(const Grid& grid) : dim(0)
 {
+  *this = grid;
 }
 
 Grid& Grid::operator=(const Grid& grid)
 {
-  this->matrix = grid.matrix;
-  this->dim = grid.dim;
+  if (this != &grid)
+  {
+    this->dim = grid.dim;
+
+    if (this->dim * this->dim <= inline_capacity)
+    {
+      std::memcpy(this->inline_cells.data(), grid.inline_cells.data(), this->dim * this->dim);
+    }
+    else
+    {
+      this->heap_cells = grid.heap_cells;
+    }
+  }
+
   return *this;
 }
 
 int Grid::get(std::size_t x, std::size_t y) const
 {
-  return this->matrix[y][x];
+  std::uint8_t a = this->data()[y * this->dim + x];
+  return (a == 0) ? -1 : int(a);
 }
 
 void Grid::set(std::size_t x, std::size_t y, int i)
 {
-  this->matrix[y][x] = i;
+  this->data()[y * this->dim + x] = (i == -1) ? 0 : std::uint8_t(i);
+}
+
+std::uint8_t const* Grid::data() const
+{
+  return (this->dim * this->dim <= inline_capacity) ? this->inline_cells.data()
+                                                    : this->heap_cells.data();
+}
+
+std::uint8_t* Grid::data()
+{
+  return (this->dim * this->dim <= inline_capacity) ? this->inline_cells.data()
+                                                    : this->heap_cells.data();
 }
 
 std::size_t Grid::n() const
@@ -52,8 +82,16 @@ std::size_t Grid::n() const
 
 void Grid::reset(std::size_t n)
 {
-  this->matrix.resize(boost::extents[n][n]);
   this->dim = n;
+
+  if (n * n <= inline_capacity)
+  {
+    std::memset(this->inline_cells.data(), 0, n * n);
+  }
+  else
+  {
+    this->heap_cells.assign(n * n, 0);
+  }
 }
 
 std::string Grid::to_s() const
@@ -79,7 +117,7 @@ void Grid::to_s(std::ostream& out) const
         out << ' ';
       }
 
-      out << this->matrix[y][x];
+      out << this->get(x, y);
     }
   }
 }
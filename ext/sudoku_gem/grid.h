@@ -19,18 +19,25 @@
 #ifndef GRID_H
 #define GRID_H
 
+#include <array>
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <streambuf>
-#include <boost/multi_array.hpp>
+#include <vector>
 
 /**
  * @brief A class that represents the state of a Sudoku board
  * 
  * The Grid class represents the current state of a particular Sudoku board. It is essentially a
  * wrapper around a square, 2D array, except that it does not need to be defined at compile-time.
- * The grid is stored in an underlying boost::multi_array<int, 2>, and it has all the typical
- * accessors: set an element, get an element, get the grid size, and set the grid size.
+ * It has all the typical accessors: set an element, get an element, get the grid size, and set the
+ * grid size.
+ *
+ * The cells are stored contiguously in row-major order, one byte per cell, with 0 for an unknown
+ * cell (a board can have at most 64 colors, so every color fits in a byte). Boards of up to 25*25
+ * are stored in a buffer inside the object, so they never touch the heap, and copying them is a
+ * single memcpy. Only larger boards fall back to a heap-allocated buffer.
  **/
 class Grid
 {
@@ -58,7 +65,7 @@ public:
   Grid& operator =(Grid const& grid);
 
   /**
-   * @brief Resize the existing grid so that it is an n*n grid
+   * @brief Resize the existing grid so that it is an n*n grid, and mark every cell as unknown
    *
    * @param n Side length of the square, 2D array.
    **/
@@ -81,6 +88,21 @@ public:
    **/
   void set(std::size_t x, std::size_t y, int i);
 
+  /**
+   * @brief Direct access to the cells, in row-major order, with 0 for an unknown cell (unlike
+   *        get() and set(), which use -1)
+   *
+   * @return std::uint8_t const* The first of the n*n cells.
+   **/
+  std::uint8_t const* data() const;
+  /**
+   * @brief Direct access to the cells, in row-major order, with 0 for an unknown cell (unlike
+   *        get() and set(), which use -1)
+   *
+   * @return std::uint8_t* The first of the n*n cells.
+   **/
+  std::uint8_t* data();
+
   /**
    * @brief The side length of the square, 2D array
    *
@@ -103,9 +125,18 @@ public:
 
 private:
   /**
-   * @brief The underlying grid.
+   * @brief The number of cells that fit in Grid::inline_cells.
+   **/
+  static const std::size_t inline_capacity = 25 * 25;
+
+  /**
+   * @brief The cells of boards that fit in the object.
+   **/
+  std::array<std::uint8_t, inline_capacity> inline_cells;
+  /**
+   * @brief The cells of boards that do not fit in the object.
    **/
-  boost::multi_array<int, 2> matrix;
+  std::vector<std::uint8_t> heap_cells;
   /**
    * @brief The side length of the grid.
    **/
@@ -16,13 +16,486 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "serializer.h"
 #include "sudoku.h"
+#include "thread_pool.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
 
-int main(int argc, char* argv[])
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Explain how the program should be run.
+ *
+ * @param program The name of the program.
+ **/
+static void usage(char const* program)
+{
+  std::cerr << "usage: " << program << " [--stream | --bulk] [--threads N] [--compact] [FILE]"
+            << std::endl
+            << std::endl
+            << "Solve the puzzle in FILE (or standard input). Puzzles are either n lines of n"
+            << std::endl
+            << "space-separated cells with '?' for unknowns, or single lines of n*n characters"
+            << std::endl
+            << "with '.' or '0' for unknowns." << std::endl
+            << std::endl
+            << "  --stream   solve every puzzle in the file, one at a time, and only print the"
+            << std::endl
+            << "             solutions (a puzzle that can't be read or solved gets an empty line)"
+            << std::endl
+            << "  --bulk     like --stream, but map FILE into memory and solve the puzzles on"
+            << std::endl
+            << "             every core, printing the solutions in order" << std::endl
+            << "  --threads  the number of cores --bulk should use (defaults to all of them)"
+            << std::endl
+            << "  --compact  print the solutions as single lines of n*n characters" << std::endl;
+}
+
+/**
+ * @brief Write the solution of a puzzle that was just solved, in the format it was read in (or
+ *        in the compact format if asked to).
+ *
+ * @param puzzle The solved puzzle.
+ * @param compact Whether the solution should be written in the compact format.
+ * @param out The string that the solution should be appended to.
+ **/
+static void append_solution(Sudoku const& puzzle, bool compact, std::string& out)
+{
+  Grid const& grid = puzzle.get_grid();
+
+  //the compact format only has characters for boards up to 49*49
+  if ((compact || puzzle.get_format() == Parser::FORMAT_COMPACT) &&
+      Serializer::compact_capacity(grid.n()) != 0)
+  {
+    Serializer::append(grid, Parser::FORMAT_COMPACT, out);
+    out.push_back('\n');
+    return;
+  }
+
+  Serializer::append(grid, Parser::FORMAT_TEXT, out);
+  out.append("\n\n");
+}
+
+/**
+ * @brief Describe why a puzzle could not be read.
+ *
+ * @param puzzle The puzzle that could not be read.
+ * @param index The position of the puzzle in the input, counting from 1.
+ * @param out The string that the description should be appended to.
+ **/
+static void append_error(Sudoku const& puzzle, std::size_t index, std::string& out)
+{
+  std::ostringstream message;
+  message << "puzzle " << index << ", line " << puzzle.get_error_line() << ", column "
+          << puzzle.get_error_column() << ": " << puzzle.get_error_message() << '\n';
+  out.append(message.str());
+}
+
+/**
+ * @brief Describe a puzzle that could be read, but has no solution.
+ *
+ * @param index The position of the puzzle in the input, counting from 1.
+ * @param out The string that the description should be appended to.
+ **/
+static void append_unsolvable(std::size_t index, std::string& out)
+{
+  std::ostringstream message;
+  message << "puzzle " << index << ": the puzzle has no solution" << '\n';
+  out.append(message.str());
+}
+
+/**
+ * @brief Skip the blank lines in front of the next puzzle.
+ *
+ * @param in The input stream.
+ * @return bool Whether there is another puzzle.
+ **/
+static bool skip_blank_lines(std::istream& in)
+{
+  while (in.peek() == '\n' || in.peek() == '\r')
+  {
+    in.get();
+  }
+
+  return (in.peek() != std::istream::traits_type::eof());
+}
+
+/**
+ * @brief Solve every puzzle in a stream, and print the solutions in order.
+ *
+ * @param in The input stream.
+ * @param compact Whether every solution should be printed in the compact format, even if its
+ *                puzzle was not.
+ * @return int The exit status: 0 if every puzzle could be read and solved, and 1 otherwise.
+ **/
+static int solve_stream(std::istream& in, bool compact)
+{
+  Sudoku puzzle;
+  std::string out;
+  std::size_t count = 0;
+  int status = 0;
+
+  while (skip_blank_lines(in))
+  {
+    count++;
+    out.clear();
+
+    if (!puzzle.read_puzzle_from_file(in))
+    {
+      append_error(puzzle, count, out);
+      std::cerr << out;
+      std::cout << '\n';
+      status = 1;
+      continue;
+    }
+
+    puzzle.solve_colorability_style();
+
+    //a puzzle that has no solution is left as it was read, which mustn't be printed as one (there
+    //is no budget or memory limit here, so that is the only way a solve can fail)
+    if (puzzle.get_status() != Sudoku::STATUS_OK)
+    {
+      append_unsolvable(count, out);
+      std::cerr << out;
+      std::cout << '\n';
+      status = 1;
+      continue;
+    }
+
+    append_solution(puzzle, compact, out);
+    std::cout << out;
+  }
+
+  std::cout.flush();
+  return status;
+}
+
+/**
+ * @brief A read-only view of a whole file, mapped into memory
+ **/
+class MappedFile
+{
+public:
+  /**
+   * @brief Map a file into memory.
+   *
+   * @param path The path of the file.
+   **/
+  explicit MappedFile(char const* path) : text(0), length(0), mapped(false), opened(false)
+  {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+
+    if (fd < 0)
+    {
+      return;
+    }
+
+    if (fstat(fd, &info) == 0)
+    {
+      this->length = std::size_t(info.st_size);
+      this->opened = true;
+
+      //there is nothing to map in an empty file
+      if (this->length > 0)
+      {
+        void* address = mmap(0, this->length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (address != MAP_FAILED)
+        {
+          this->text = (char const*)address;
+          this->mapped = true;
+
+          //we read it from front to back, exactly once
+          madvise(address, this->length, MADV_SEQUENTIAL);
+        }
+        else
+        {
+          this->opened = false;
+        }
+      }
+    }
+
+    close(fd);
+  }
+
+  virtual ~MappedFile()
+  {
+    if (this->mapped)
+    {
+      munmap((void*)this->text, this->length);
+    }
+  }
+
+  /**
+   * @brief The first character of the file (or NULL if it is empty).
+   **/
+  char const* text;
+  /**
+   * @brief The number of characters in the file.
+   **/
+  std::size_t length;
+  /**
+   * @brief Whether the file is mapped into memory.
+   **/
+  bool mapped;
+  /**
+   * @brief Whether the file could be opened (and mapped, if it isn't empty).
+   **/
+  bool opened;
+
+private:
+  MappedFile(MappedFile const&);
+  MappedFile& operator=(MappedFile const&);
+};
+
+/**
+ * @brief A run of consecutive puzzles from the input, which is solved by a single task
+ **/
+struct BulkBatch
+{
+  /**
+   * @brief The first character of the first puzzle.
+   **/
+  char const* text;
+  /**
+   * @brief The number of characters that the puzzles take up.
+   **/
+  std::size_t length;
+  /**
+   * @brief The position of the first puzzle in the input, counting from 1.
+   **/
+  std::size_t first;
+  /**
+   * @brief The solutions, in order.
+   **/
+  std::string out;
+  /**
+   * @brief Why some of the puzzles could not be read.
+   **/
+  std::string errors;
+  /**
+   * @brief Whether the task has finished.
+   **/
+  bool done;
+};
+
+/**
+ * @brief Tells you whether there are any puzzles left in a buffer.
+ *
+ * @param text The first character of the buffer.
+ * @param length The number of characters in the buffer.
+ * @return bool Whether the buffer has nothing but blank lines in it.
+ **/
+static bool only_blank_lines(char const* text, std::size_t length)
+{
+  for (std::size_t k = 0; k < length; k++)
+  {
+    if (text[k] != '\n' && text[k] != '\r')
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Write out a whole buffer.
+ *
+ * @param out The buffer.
+ * @param file The file to write to.
+ * @return bool Whether everything was written.
+ **/
+static bool write_all(std::string const& out, std::FILE* file)
+{
+  return (std::fwrite(out.data(), 1, out.length(), file) == out.length());
+}
+
+/**
+ * @brief Solve every puzzle in a file on every core, and print the solutions in order.
+ *
+ * The file is mapped into memory and cut into batches of puzzles (see Parser::measure()), and
+ * every batch is parsed, solved and written to its own buffer by one task on a ThreadPool. The
+ * buffers are written out in the order of the input, each with a single write, and only a few
+ * batches per worker are in flight at once, so the memory use doesn't grow with the file.
+ *
+ * @param path The path of the file.
+ * @param compact Whether every solution should be printed in the compact format, even if its
+ *                puzzle was not.
+ * @param threads The number of workers.
+ * @return int The exit status: 0 if every puzzle could be read and solved, and 1 otherwise.
+ **/
+static int solve_bulk(char const* path, bool compact, std::size_t threads)
+{
+  //enough puzzles per batch to make a task (and a write) worthwhile
+  const std::size_t batch_size = 1024;
+
+  MappedFile file(path);
+
+  if (!file.opened)
+  {
+    std::cerr << "Could not map " << path << "." << std::endl;
+    return 1;
+  }
+
+  ThreadPool pool(threads);
+  const std::size_t max_in_flight = 4 * pool.size();
+
+  //every worker reuses the same puzzle (and its buffers) for every batch it gets
+  std::vector<std::unique_ptr<Sudoku> > puzzles;
+
+  for (std::size_t k = 0; k < pool.size(); k++)
+  {
+    puzzles.push_back(std::unique_ptr<Sudoku>(new Sudoku()));
+  }
+
+  std::deque<std::unique_ptr<BulkBatch> > in_flight;
+  std::mutex lock;
+  std::condition_variable finished;
+  std::size_t cursor = 0, count = 0;
+  int status = 0;
+
+  //the batches are written in big pieces anyway, so don't break them up into lines
+  std::setvbuf(stdout, 0, _IOFBF, 1 << 20);
+
+  for (;;)
+  {
+    //cut off the next batch (a batch that is nothing but blank lines has no puzzles in it)
+    std::unique_ptr<BulkBatch> batch(new BulkBatch());
+    std::size_t puzzle_count = 0;
+
+    batch->text = file.text + cursor;
+    batch->first = count + 1;
+    batch->done = false;
+
+    while (puzzle_count < batch_size && !only_blank_lines(file.text + cursor, file.length - cursor))
+    {
+      cursor += Parser::measure(file.text + cursor, file.length - cursor);
+      puzzle_count++;
+    }
+
+    batch->length = (file.text + cursor) - batch->text;
+    count += puzzle_count;
+
+    if (puzzle_count > 0)
+    {
+      BulkBatch* task_batch = batch.get();
+
+      pool.submit([task_batch, puzzle_count, compact, &puzzles, &lock, &finished]()
+      {
+        Sudoku& puzzle = *puzzles[ThreadPool::current_worker()];
+        char const* cur = task_batch->text;
+        char const* const end = task_batch->text + task_batch->length;
+
+        for (std::size_t k = 0; k < puzzle_count; k++)
+        {
+          std::size_t consumed;
+
+          //count the lines of an error from the first line of its puzzle, just like --stream
+          while (*cur == '\n' || *cur == '\r')
+          {
+            cur++;
+          }
+
+          if (puzzle.read_puzzle_from_buffer(cur, end - cur, &consumed))
+          {
+            puzzle.solve_colorability_style();
+
+            //just like --stream, a puzzle that has no solution gets an error and an empty line
+            if (puzzle.get_status() == Sudoku::STATUS_OK)
+            {
+              append_solution(puzzle, compact, task_batch->out);
+            }
+            else
+            {
+              append_unsolvable(task_batch->first + k, task_batch->errors);
+              task_batch->out.push_back('\n');
+            }
+          }
+          else
+          {
+            append_error(puzzle, task_batch->first + k, task_batch->errors);
+            task_batch->out.push_back('\n');
+          }
+
+          cur += consumed;
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        task_batch->done = true;
+        finished.notify_all();
+      });
+
+      in_flight.push_back(std::move(batch));
+    }
+
+    const bool last = only_blank_lines(file.text + cursor, file.length - cursor);
+
+    //write out the finished batches in order, and wait for room (or for everything, at the end)
+    while (!in_flight.empty() && (last || in_flight.size() >= max_in_flight))
+    {
+      BulkBatch& front = *in_flight.front();
+
+      {
+        std::unique_lock<std::mutex> guard(lock);
+
+        while (!front.done)
+        {
+          finished.wait(guard);
+        }
+      }
+
+      if (!front.errors.empty())
+      {
+        status = 1;
+        write_all(front.errors, stderr);
+      }
+
+      if (!write_all(front.out, stdout))
+      {
+        status = 1;
+      }
+
+      in_flight.pop_front();
+    }
+
+    if (last)
+    {
+      break;
+    }
+  }
+
+  std::fflush(stdout);
+  return status;
+}
+
+/**
+ * @brief Solve a single puzzle, and explain what is going on along the way.
+ *
+ * @param in The input stream.
+ * @param compact Whether the boards should be printed in the compact format.
+ * @return int The exit status: 0 if the puzzle could be read and solved, and 1 otherwise.
+ **/
+static int solve_one(std::istream& in, bool compact)
 {
   Sudoku puzzle;
-  puzzle.read_puzzle_from_file(std::cin);
+  puzzle.read_puzzle_from_file(in);
 
   if (puzzle)
   {
@@ -35,14 +508,104 @@ int main(int argc, char* argv[])
   }
 
   std::cout << "Here's the current state of the board." << std::endl;
-  puzzle.print(std::cout);
+
+  if (compact)
+  {
+    std::cout << puzzle.to_compact_s() << std::endl;
+  }
+  else
+  {
+    puzzle.print(std::cout);
+  }
 
   std::cout << std::endl << "Solving the puzzle..." << std::endl;
 
   puzzle.solve_colorability_style();
 
+  if (puzzle.get_status() != Sudoku::STATUS_OK)
+  {
+    std::cout << "The puzzle has no solution." << std::endl;
+    return 1;
+  }
+
   std::cout << "A solution was found!" << std::endl;
-  puzzle.print(std::cout);
+
+  if (compact)
+  {
+    std::cout << puzzle.to_compact_s() << std::endl;
+  }
+  else
+  {
+    puzzle.print(std::cout);
+  }
 
   return 0;
 }
+
+int main(int argc, char* argv[])
+{
+  bool stream = false, bulk = false, compact = false;
+  std::size_t threads = 0;
+  char const* path = 0;
+
+  for (int k = 1; k < argc; k++)
+  {
+    if (std::strcmp(argv[k], "--stream") == 0)
+    {
+      stream = true;
+    }
+    else if (std::strcmp(argv[k], "--bulk") == 0)
+    {
+      bulk = true;
+    }
+    else if (std::strcmp(argv[k], "--threads") == 0 && k + 1 < argc && std::atoi(argv[k + 1]) > 0)
+    {
+      threads = std::size_t(std::atoi(argv[++k]));
+    }
+    else if (std::strcmp(argv[k], "--compact") == 0)
+    {
+      compact = true;
+    }
+    else if (argv[k][0] == '-' || path != 0)
+    {
+      usage(argv[0]);
+      return 2;
+    }
+    else
+    {
+      path = argv[k];
+    }
+  }
+
+  if (bulk)
+  {
+    //a memory map needs a real file
+    if (path == 0 || stream)
+    {
+      usage(argv[0]);
+      return 2;
+    }
+
+    return solve_bulk(path, compact, threads);
+  }
+
+  std::ifstream file;
+
+  if (path != 0)
+  {
+    file.open(path);
+
+    if (!file)
+    {
+      std::cerr << "Could not open " << path << "." << std::endl;
+      return 1;
+    }
+  }
+
+  std::istream& in = (path != 0) ? file : std::cin;
+
+  //don't tie cout to cin, so the solutions aren't flushed one line at a time
+  std::cin.tie(0);
+
+  return stream ? solve_stream(in, compact) : solve_one(in, compact);
+}
@@ -0,0 +1,325 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARALLEL_SEARCH_H
+#define PARALLEL_SEARCH_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "search.h"
+#include "search_state.h"
+#include "thread_pool.h"
+
+/**
+ * @brief A depth-first search for the colorings of a Sudoku board that runs on every worker of a
+ *        ThreadPool
+ *
+ * The ParallelSearch class expands the top few levels of the search tree itself, breadth-first,
+ * until it has a few subtrees for every worker (or until the tree runs out). Every subtree gets
+ * its own copy of the state, and is then searched by a BasicSearch on one of the workers. The
+ * subtrees are disjoint, so the searches never wait on each other; they only share a
+ * SearchBase::SharedCount, which stops all of them as soon as enough colorings have been found
+ * between them. The subtrees that have not been started by then are skipped.
+ *
+ * The subtrees are expanded in the same order as the serial search would visit them, but they
+ * finish in whatever order the workers get to them, so run(1) on a board with several solutions
+ * may find a different one than BasicSearch::run(1).
+ **/
+template <typename State>
+class ParallelSearch : public SearchBase
+{
+public:
+  /**
+   * @brief Construct a parallel search over a given state
+   *
+   * @param state The Sudoku game board. It must outlive the search.
+   * @param pool The workers to search on. It must outlive the search, and the search must not be
+   *             run by one of its workers.
+   * @param options The policies the search should follow. Defaults to Options().
+   **/
+  ParallelSearch(State& state, ThreadPool& pool, Options const& options = Options());
+  virtual ~ParallelSearch();
+
+  /**
+   * @brief Look for colorings of the board, stopping as soon as enough of them have been found.
+   *        This behaves like BasicSearch::run().
+   *
+   * @param limit The number of colorings after which the search should stop. Must be at least 1.
+   * @return std::size_t The number of colorings that were found (at most limit).
+   **/
+  std::size_t run(std::size_t limit);
+  /**
+   * @brief Show every coloring that is counted to a visitor. See BasicSearch::visit().
+   *
+   * The visitor is called from the workers, possibly from several of them at once, so it must be
+   * safe to call concurrently.
+   *
+   * @param visitor The visitor. If this is empty, the search stops visiting.
+   **/
+  void visit(typename BasicSearch<State>::Visitor visitor);
+  /**
+   * @brief Whether the last run() stopped because one of the subtrees found the solution that
+   *        reached the limit (in which case that solution has been copied to the state)
+   *
+   * @return bool Whether the limit was reached.
+   **/
+  bool limit_reached() const;
+  /**
+   * @brief What the last run() did, between the expansion and every subtree
+   *
+   * @return SearchStats const& The counts of the last run().
+   **/
+  SearchStats const& stats() const;
+
+private:
+  /**
+   * @brief Helper method for replacing every subtree with its children, one level further down
+   *        the search tree. Subtrees that are already solved are kept as they are, and children
+   *        that are dead ends are dropped.
+   *
+   * @return bool Whether any subtree had children.
+   **/
+  bool expand();
+  /**
+   * @brief Helper method for searching one subtree on a worker.
+   *
+   * @param k The index of the subtree.
+   * @param shared The count that the searches share.
+   **/
+  void search(std::size_t k, SharedCount& shared);
+
+  /**
+   * @brief The board that is being searched.
+   **/
+  State& state;
+  /**
+   * @brief The workers that search the subtrees.
+   **/
+  ThreadPool& pool;
+  /**
+   * @brief The policies the search follows.
+   **/
+  Options options;
+  /**
+   * @brief The visitor of the colorings, if any.
+   **/
+  typename BasicSearch<State>::Visitor visitor;
+  /**
+   * @brief The subtrees that are left to search, each with its own copy of the state.
+   **/
+  std::vector<State> subtrees;
+  /**
+   * @brief The subtree whose search reached the limit, or subtrees.size() if none has.
+   **/
+  std::atomic<std::size_t> winner;
+  /**
+   * @brief Whether the last run() stopped on the solution that reached the limit.
+   **/
+  bool reached;
+  /**
+   * @brief The number of levels of the search tree that the last run() expanded itself.
+   **/
+  std::size_t levels;
+  /**
+   * @brief The counts of the last run().
+   **/
+  SearchStats counters;
+  /**
+   * @brief The lock that the subtrees take to add their counts to ParallelSearch::counters.
+   **/
+  std::mutex counters_lock;
+};
+
+template <typename State>
+ParallelSearch<State>::ParallelSearch(State& state, ThreadPool& pool, Options const& options) :
+  state(state), pool(pool), options(options), winner(0), reached(false), levels(0)
+{
+}
+
+template <typename State>
+void ParallelSearch<State>::visit(typename BasicSearch<State>::Visitor visitor)
+{
+  this->visitor = visitor;
+}
+
+template <typename State>
+bool ParallelSearch<State>::limit_reached() const
+{
+  return this->reached;
+}
+
+template <typename State>
+SearchStats const& ParallelSearch<State>::stats() const
+{
+  return this->counters;
+}
+
+template <typename State>
+bool ParallelSearch<State>::expand()
+{
+  std::vector<State> children;
+  bool expanded = false;
+
+  for (std::size_t k = 0; k < this->subtrees.size(); k++)
+  {
+    State& parent = this->subtrees[k];
+    std::size_t x, y;
+    bool found;
+
+    if (this->options.selection == SELECT_FEWEST_CANDIDATES)
+    {
+      found = parent.find_most_constrained(x, y);
+    }
+    else
+    {
+      found = parent.find_unknown(0, 0, x, y);
+    }
+
+    if (!found)
+    {
+      //a solved subtree has no children, but it still has to be counted
+      children.push_back(parent);
+      continue;
+    }
+
+    typedef typename State::Mask Mask;
+
+    //one child per color, in the same order as the serial search would try them (see
+    //BasicSearch::pop_color())
+    for (Mask colors = parent.candidates(x, y); colors != 0; )
+    {
+      const std::size_t mark = parent.checkpoint();
+      int color;
+
+      if (this->options.order == ORDER_LEAST_CONSTRAINING && (colors & (colors - 1)) != 0)
+      {
+        color = parent.least_constraining_color(x, y, colors);
+      }
+      else
+      {
+        color = lowest_color(colors);
+      }
+
+      colors &= Mask(~color_bit<Mask>(color));
+      parent.assign(x, y, color);
+      this->counters.node();
+
+      const std::size_t guessed = parent.checkpoint();
+      const bool propagated = parent.propagate();
+      this->counters.propagated(parent.checkpoint() - guessed);
+
+      if (propagated)
+      {
+        children.push_back(parent);
+      }
+
+      parent.rollback(mark);
+    }
+
+    expanded = true;
+  }
+
+  if (expanded)
+  {
+    this->levels++;
+    this->counters.reached(this->levels);
+  }
+
+  this->subtrees.swap(children);
+  return expanded;
+}
+
+template <typename State>
+void ParallelSearch<State>::search(std::size_t k, SharedCount& shared)
+{
+  //don't bother starting if the other subtrees have already found enough (or used up the budget)
+  if (shared.stop.load(std::memory_order_relaxed) ||
+      (this->options.budget != 0 && this->options.budget->expired()))
+  {
+    return;
+  }
+
+  BasicSearch<State> subtree_search(this->subtrees[k], this->options);
+  subtree_search.share(&shared);
+  subtree_search.visit(this->visitor);
+  subtree_search.run(shared.limit);
+
+  if (subtree_search.limit_reached())
+  {
+    this->winner = k;
+  }
+
+  std::lock_guard<std::mutex> guard(this->counters_lock);
+  this->counters.add(subtree_search.stats(), this->levels);
+}
+
+template <typename State>
+std::size_t ParallelSearch<State>::run(std::size_t limit)
+{
+  //a few subtrees per worker, so the work stealing can even out the uneven ones
+  const std::size_t target = 8 * this->pool.size();
+  SharedCount shared(limit);
+
+  this->reached = false;
+  this->counters = SearchStats();
+  this->levels = 0;
+  this->subtrees.assign(1, this->state);
+
+  //fill in everything that is forced before we start splitting
+  const std::size_t root = this->subtrees[0].checkpoint();
+  const bool consistent = this->subtrees[0].propagate();
+  this->counters.propagated(this->subtrees[0].checkpoint() - root);
+
+  if (!consistent)
+  {
+    return 0;
+  }
+
+  while (this->subtrees.size() < target && this->expand())
+  {
+  }
+
+  this->winner = this->subtrees.size();
+
+  for (std::size_t k = 0; k < this->subtrees.size(); k++)
+  {
+    this->pool.submit([this, k, &shared]() { this->search(k, shared); });
+  }
+
+  this->pool.wait();
+
+  //the caller expects the last coloring to be on its own state, just like after a serial search
+  if (this->winner < this->subtrees.size())
+  {
+    this->state = this->subtrees[this->winner];
+    this->reached = true;
+  }
+
+  this->subtrees.clear();
+  return shared.found;
+}
+
+template <typename State>
+ParallelSearch<State>::~ParallelSearch()
+{
+}
+
+#endif // PARALLEL_SEARCH_H
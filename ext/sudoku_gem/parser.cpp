@@ -0,0 +1,519 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "parser.h"
+
+#include <cstring>
+
+const char Parser::compact_digits[] =
+  ".123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+const std::size_t Parser::packed_header_size = 5;
+
+namespace
+{
+  //the largest value that has a character in the compact format
+  const int max_compact_value = int(sizeof(Parser::compact_digits)) - 2;
+}
+
+bool Parser::fail(Error& error, std::size_t line, std::size_t column, char const* message)
+{
+  error.line = line;
+  error.column = column;
+  error.message = message;
+  return false;
+}
+
+char const* Parser::find_line_end(char const* cur, char const* end)
+{
+  char const* newline = (char const*)std::memchr(cur, '\n', end - cur);
+  return (newline != 0) ? newline : end;
+}
+
+std::size_t Parser::count_cells(char const* text, std::size_t length)
+{
+  //ignore the carriage return of a windows line ending
+  if (length > 0 && text[length - 1] == '\r')
+  {
+    length--;
+  }
+
+  if (length == 0)
+  {
+    return 0;
+  }
+
+  //every space separates two cells, even if one of them is empty (which is then an error)
+  std::size_t cells = 1;
+
+  for (std::size_t k = 0; k < length; k++)
+  {
+    if (text[k] == ' ')
+    {
+      cells++;
+    }
+  }
+
+  return cells;
+}
+
+bool Parser::is_good_size(std::size_t n)
+{
+  //the masks have 64 bits, so that is as many colors as a board can have
+  for (std::size_t root = 1; root * root <= 64; root++)
+  {
+    if (root * root == n)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+int Parser::compact_value(char c)
+{
+  if (c == '.' || c == '0')
+  {
+    return 0;
+  }
+  else if (c >= '1' && c <= '9')
+  {
+    return c - '0';
+  }
+  else if (c >= 'A' && c <= 'Z')
+  {
+    return c - 'A' + 10;
+  }
+  else if (c >= 'a' && c <= 'z')
+  {
+    return c - 'a' + 36;
+  }
+  else
+  {
+    return -1;
+  }
+}
+
+char Parser::compact_digit(int value)
+{
+  return (value >= 0 && value <= max_compact_value) ? compact_digits[value] : '?';
+}
+
+std::size_t Parser::compact_size(std::size_t length)
+{
+  for (std::size_t n = 1; n * n <= length; n++)
+  {
+    if (n * n == length)
+    {
+      return (is_good_size(n) && int(n) <= max_compact_value) ? n : 0;
+    }
+  }
+
+  return 0;
+}
+
+std::size_t Parser::packed_bits(std::size_t n)
+{
+  std::size_t bits = 1;
+
+  while ((std::size_t(1) << bits) <= n)
+  {
+    bits++;
+  }
+
+  return bits;
+}
+
+std::size_t Parser::packed_size(std::size_t n)
+{
+  if (!is_good_size(n))
+  {
+    return 0;
+  }
+
+  return 1 + (n * n * packed_bits(n) + 7) / 8;
+}
+
+Parser::Format Parser::detect_format(char const* text, std::size_t length)
+{
+  //ignore the carriage return of a windows line ending
+  if (length > 0 && text[length - 1] == '\r')
+  {
+    length--;
+  }
+
+  //a single cell looks the same either way
+  if (length < 2 || compact_size(length) == 0 || std::memchr(text, ' ', length) != 0)
+  {
+    return FORMAT_TEXT;
+  }
+
+  return FORMAT_COMPACT;
+}
+
+char const* Parser::skip_blank_lines(char const* cur, char const* end, std::size_t& lines)
+{
+  lines = 0;
+
+  for (;;)
+  {
+    char const* line_end = find_line_end(cur, end);
+    char const* row_end = line_end;
+
+    //ignore the carriage return of a windows line ending
+    if (row_end > cur && row_end[-1] == '\r')
+    {
+      row_end--;
+    }
+
+    if (row_end != cur || line_end == end)
+    {
+      return cur;
+    }
+
+    cur = line_end + 1;
+    lines++;
+  }
+}
+
+std::size_t Parser::measure(char const* text, std::size_t length)
+{
+  char const* const end = text + length;
+  std::size_t skipped_lines;
+  char const* cur = skip_blank_lines(text, end, skipped_lines);
+  char const* line_end = find_line_end(cur, end);
+  std::size_t lines = 1;
+
+  //a board in the text format takes up n lines (unless n is bad, and then we only know the first)
+  if (detect_format(cur, line_end - cur) == FORMAT_TEXT)
+  {
+    const std::size_t n = count_cells(cur, line_end - cur);
+
+    if (is_good_size(n))
+    {
+      lines = n;
+    }
+  }
+
+  for (std::size_t k = 1; k < lines && line_end != end; k++)
+  {
+    cur = line_end + 1;
+    line_end = find_line_end(cur, end);
+  }
+
+  return (line_end == end) ? length : std::size_t(line_end + 1 - text);
+}
+
+bool Parser::parse(char const* text, std::size_t length, Grid& grid, Error& error,
+                   Format& format, std::size_t* consumed)
+{
+  char const* const end = text + length;
+  std::size_t skipped_lines;
+  char const* cur = skip_blank_lines(text, end, skipped_lines);
+  const std::size_t skipped = cur - text;
+  bool parsed;
+
+  format = detect_format(cur, find_line_end(cur, end) - cur);
+
+  if (format == FORMAT_COMPACT)
+  {
+    parsed = parse_compact(cur, length - skipped, grid, error);
+  }
+  else
+  {
+    parsed = parse_text(cur, length - skipped, grid, error);
+  }
+
+  //a bad board still takes up its lines, so the next one can be found
+  if (consumed != 0)
+  {
+    *consumed = measure(text, length);
+  }
+
+  if (!parsed)
+  {
+    //the positions should point into the whole text
+    error.line += skipped_lines;
+    return false;
+  }
+
+  return true;
+}
+
+bool Parser::parse_compact(char const* text, std::size_t length, Grid& grid, Error& error,
+                           std::size_t* consumed)
+{
+  char const* const end = text + length;
+  char const* const line_end = find_line_end(text, end);
+  std::size_t cell_count = line_end - text;
+
+  //ignore the carriage return of a windows line ending
+  if (cell_count > 0 && text[cell_count - 1] == '\r')
+  {
+    cell_count--;
+  }
+
+  const std::size_t n = compact_size(cell_count);
+
+  if (n == 0)
+  {
+    return fail(error, 1, 1, "the number of cells must be n*n, for a perfect square n up to 49");
+  }
+
+  grid.reset(n);
+  std::uint8_t* cells = grid.data();
+
+  for (std::size_t k = 0; k < cell_count; k++)
+  {
+    const int value = compact_value(text[k]);
+
+    if (value < 0)
+    {
+      return fail(error, 1, k + 1, "expected a digit, a letter, a '.' or a '0'");
+    }
+
+    if (value > int(n))
+    {
+      return fail(error, 1, k + 1, "the value is out of range");
+    }
+
+    cells[k] = std::uint8_t(value);
+  }
+
+  if (consumed != 0)
+  {
+    *consumed = (line_end == end) ? length : std::size_t(line_end + 1 - text);
+  }
+
+  error = Error();
+  return true;
+}
+
+bool Parser::parse_text(char const* text, std::size_t length, Grid& grid, Error& error,
+                        std::size_t* consumed)
+{
+  char const* cur = text;
+  char const* const end = text + length;
+
+  //the first row tells us how big the board is
+  char const* line_end = find_line_end(cur, end);
+  const std::size_t n = count_cells(cur, line_end - cur);
+
+  if (n == 0)
+  {
+    return fail(error, 1, 1, "the puzzle is empty");
+  }
+
+  if (!is_good_size(n))
+  {
+    return fail(error, 1, 1, "the number of cells in a row must be a perfect square, up to 64");
+  }
+
+  grid.reset(n);
+  std::uint8_t* cells = grid.data();
+
+  for (std::size_t y = 0; y < n; y++)
+  {
+    if (y > 0)
+    {
+      //skip past the newline of the last row
+      if (line_end == end)
+      {
+        return fail(error, y + 1, 1, "the puzzle has too few rows");
+      }
+
+      cur = line_end + 1;
+      line_end = find_line_end(cur, end);
+    }
+
+    char const* const line_start = cur;
+    char const* row_end = line_end;
+
+    //ignore the carriage return of a windows line ending
+    if (row_end > cur && row_end[-1] == '\r')
+    {
+      row_end--;
+    }
+
+    //an empty line (e.g., the end of the file) can't be one of the rows
+    if (row_end == cur)
+    {
+      return fail(error, y + 1, 1, "the puzzle has too few rows");
+    }
+
+    for (std::size_t x = 0; x < n; x++)
+    {
+      if (x > 0)
+      {
+        if (cur == row_end)
+        {
+          return fail(error, y + 1, cur - line_start + 1, "the row has too few cells");
+        }
+
+        //the last cell ended at a space, so skip it
+        cur++;
+      }
+
+      char const* const token = cur;
+
+      if (cur != row_end && *cur == '?')
+      {
+        //unknowns are question marks
+        cells[y * n + x] = 0;
+        cur++;
+      }
+      else
+      {
+        //every known value is an integer between 1 and n (anything past 64 is out of range
+        //already, so we can stop accumulating digits before they overflow)
+        std::size_t value = 0;
+
+        while (cur != row_end && *cur >= '0' && *cur <= '9')
+        {
+          if (value <= 64)
+          {
+            value = value * 10 + (*cur - '0');
+          }
+
+          cur++;
+        }
+
+        if (cur == token)
+        {
+          return fail(error, y + 1, cur - line_start + 1, "expected a number or a '?'");
+        }
+
+        if (value < 1 || value > n)
+        {
+          return fail(error, y + 1, token - line_start + 1, "the value is out of range");
+        }
+
+        cells[y * n + x] = std::uint8_t(value);
+      }
+
+      //a cell ends at a space or at the end of the row
+      if (cur != row_end && *cur != ' ')
+      {
+        return fail(error, y + 1, cur - line_start + 1, "expected a number or a '?'");
+      }
+    }
+
+    if (cur != row_end)
+    {
+      return fail(error, y + 1, cur - line_start + 1, "the row has too many cells");
+    }
+  }
+
+  if (consumed != 0)
+  {
+    *consumed = (line_end == end) ? length : std::size_t(line_end + 1 - text);
+  }
+
+  error = Error();
+  return true;
+}
+
+bool Parser::parse_packed(char const* text, std::size_t length, Grid& grid, Error& error,
+                          std::size_t* consumed)
+{
+  std::uint8_t const* const bytes = (std::uint8_t const*)text;
+
+  if (length == 0)
+  {
+    return fail(error, 1, 1, "the puzzle is empty");
+  }
+
+  const std::size_t n = bytes[0];
+  const std::size_t size = packed_size(n);
+
+  if (size == 0)
+  {
+    return fail(error, 1, 1, "the side length must be a perfect square, up to 64");
+  }
+
+  if (length < size)
+  {
+    return fail(error, 1, length + 1, "the puzzle is truncated");
+  }
+
+  grid.reset(n);
+  std::uint8_t* cells = grid.data();
+
+  const std::size_t bits = packed_bits(n);
+  const std::uint32_t mask = (std::uint32_t(1) << bits) - 1;
+  std::uint32_t pending = 0;
+  std::size_t pending_bits = 0;
+  std::size_t next = 1;
+
+  //a cell has at most 7 bits, so one more byte always covers the rest of it
+  for (std::size_t k = 0; k < n * n; k++)
+  {
+    if (pending_bits < bits)
+    {
+      pending |= std::uint32_t(bytes[next++]) << pending_bits;
+      pending_bits += 8;
+    }
+
+    const std::uint32_t value = pending & mask;
+    pending >>= bits;
+    pending_bits -= bits;
+
+    if (value > n)
+    {
+      return fail(error, 1, 2 + k * bits / 8, "the value is out of range");
+    }
+
+    cells[k] = std::uint8_t(value);
+  }
+
+  if (consumed != 0)
+  {
+    *consumed = size;
+  }
+
+  error = Error();
+  return true;
+}
+
+bool Parser::parse_packed_header(char const* text, std::size_t length, std::size_t& count,
+                                 Error& error, std::size_t* consumed)
+{
+  std::uint8_t const* const bytes = (std::uint8_t const*)text;
+
+  if (length == 0 || bytes[0] != 0)
+  {
+    return fail(error, 1, 1, "expected the header of a batch");
+  }
+
+  if (length < packed_header_size)
+  {
+    return fail(error, 1, length + 1, "the header of the batch is truncated");
+  }
+
+  count = std::size_t(bytes[1]) | (std::size_t(bytes[2]) << 8) | (std::size_t(bytes[3]) << 16) |
+          (std::size_t(bytes[4]) << 24);
+
+  if (consumed != 0)
+  {
+    *consumed = packed_header_size;
+  }
+
+  error = Error();
+  return true;
+}
@@ -0,0 +1,285 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <cstddef>
+
+#include "grid.h"
+
+/**
+ * @brief A class that reads Sudoku boards straight out of a buffer of text
+ *
+ * The Parser class scans the text in place, one character at a time: it never copies a line or a
+ * token, it never allocates (except when the grid has to grow past its inline buffer), and it
+ * never throws. When the text is not a valid board, it reports what went wrong along with the
+ * exact line and column, so that a bad puzzle in a big file is easy to find.
+ **/
+class Parser
+{
+public:
+  /**
+   * @brief The formats a board can be written in
+   **/
+  enum Format
+  {
+    /**
+     * @brief n rows of n space-separated cells (see parse_text()).
+     **/
+    FORMAT_TEXT,
+    /**
+     * @brief A single line of n*n characters (see parse_compact()).
+     **/
+    FORMAT_COMPACT,
+    /**
+     * @brief A header byte and n*n cells of a few bits each (see parse_packed()). This is binary,
+     *        so parse() never mistakes text for it.
+     **/
+    FORMAT_PACKED
+  };
+
+  /**
+   * @brief The reason a parse failed, and where
+   **/
+  struct Error
+  {
+    /**
+     * @brief Construct an error that says nothing went wrong.
+     **/
+    Error() : line(0), column(0), message(0) {}
+
+    /**
+     * @brief The line on which the parse failed, counting from 1 (or 0 if it is not about a
+     *        particular position, e.g., when the board breaks the rules of the game).
+     **/
+    std::size_t line;
+    /**
+     * @brief The column (in bytes) at which the parse failed, counting from 1 (or 0, just like
+     *        the line).
+     **/
+    std::size_t column;
+    /**
+     * @brief A description of the failure, or NULL if nothing went wrong.
+     **/
+    char const* message;
+  };
+
+  /**
+   * @brief Read a board in the text format: n rows separated by newlines, where every row has n
+   *        cells separated by single spaces, with integers [1-n] as the known values and '?' for
+   *        unknown values. A carriage return at the end of a row is ignored, and so is anything
+   *        after the last row.
+   *
+   * @param text The first character of the text.
+   * @param length The number of characters in the text.
+   * @param grid Overwritten with the board. If the parse fails, its contents are unspecified.
+   * @param error Overwritten with the reason the parse failed, if it does.
+   * @param consumed Overwritten with the number of characters that the board took up (including
+   *                 the newline after its last row), if this is not NULL. Defaults to NULL.
+   * @return bool Whether the parsing succeeded.
+   **/
+  static bool parse_text(char const* text, std::size_t length, Grid& grid, Error& error,
+                         std::size_t* consumed = 0);
+
+  /**
+   * @brief Read a board in the compact format: a single line of n*n characters, one per cell in
+   *        row-major order, with '.' or '0' for unknown values, and the digits 1-9 followed by the
+   *        letters A-Z and a-z for the known values (so 'A' is 10, and 'a' is 36). This covers
+   *        every board up to 49*49. A carriage return at the end of the line is ignored, and so is
+   *        anything after it.
+   *
+   * @param text The first character of the text.
+   * @param length The number of characters in the text.
+   * @param grid Overwritten with the board. If the parse fails, its contents are unspecified.
+   * @param error Overwritten with the reason the parse failed, if it does.
+   * @param consumed Overwritten with the number of characters that the board took up (including
+   *                 the newline after it), if this is not NULL. Defaults to NULL.
+   * @return bool Whether the parsing succeeded.
+   **/
+  static bool parse_compact(char const* text, std::size_t length, Grid& grid, Error& error,
+                            std::size_t* consumed = 0);
+  /**
+   * @brief Read a board in the packed format: a byte with the side length n, followed by the n*n
+   *        cells in row-major order, packed_bits() bits each (0 for unknown values), starting at
+   *        the lowest bit of every byte. The last byte is padded with zero bits, and anything after
+   *        it is ignored. A 9*9 board takes up 42 bytes, and a 64*64 board 3585.
+   *
+   * The positions of an error are line 1 and the byte (counting from 1) that the bad cell starts
+   * in, since the format has no lines.
+   *
+   * @param text The first byte of the board.
+   * @param length The number of bytes in the buffer.
+   * @param grid Overwritten with the board. If the parse fails, its contents are unspecified.
+   * @param error Overwritten with the reason the parse failed, if it does.
+   * @param consumed Overwritten with the number of bytes that the board took up (see
+   *                 packed_size()), if this is not NULL. Defaults to NULL.
+   * @return bool Whether the parsing succeeded.
+   **/
+  static bool parse_packed(char const* text, std::size_t length, Grid& grid, Error& error,
+                           std::size_t* consumed = 0);
+  /**
+   * @brief Read the header of a batch of boards in the packed format: a 0 byte (which no board
+   *        starts with) followed by the number of boards, as 4 bytes in little-endian order. The
+   *        boards follow right after it, one after another (see parse_packed()).
+   *
+   * @param text The first byte of the header.
+   * @param length The number of bytes in the buffer.
+   * @param count Overwritten with the number of boards in the batch.
+   * @param error Overwritten with the reason the parse failed, if it does.
+   * @param consumed Overwritten with the number of bytes that the header took up (i.e.,
+   *                 packed_header_size), if this is not NULL. Defaults to NULL.
+   * @return bool Whether the parsing succeeded.
+   **/
+  static bool parse_packed_header(char const* text, std::size_t length, std::size_t& count,
+                                  Error& error, std::size_t* consumed = 0);
+  /**
+   * @brief Read a board in whichever format it was written in (see detect_format()), skipping
+   *        any blank lines in front of it. This is the most convenient way to read many boards
+   *        from one buffer, one after another.
+   *
+   * @param text The first character of the text.
+   * @param length The number of characters in the text.
+   * @param grid Overwritten with the board. If the parse fails, its contents are unspecified.
+   * @param error Overwritten with the reason the parse failed, if it does.
+   * @param format Overwritten with the format of the board.
+   * @param consumed Overwritten with the number of characters that the board (and the blank lines
+   *                 in front of it) took up, if this is not NULL, even if the parse fails (see
+   *                 measure()). Defaults to NULL.
+   * @return bool Whether the parsing succeeded.
+   **/
+  static bool parse(char const* text, std::size_t length, Grid& grid, Error& error,
+                    Format& format, std::size_t* consumed = 0);
+  /**
+   * @brief Find out how many characters the next board takes up (including the blank lines in
+   *        front of it), without reading it: a board in the compact format takes up one line,
+   *        and a board in the text format takes up as many lines as its first row has cells. This
+   *        only looks for newlines, so it is a cheap way to split a big buffer into boards.
+   *
+   * @param text The first character of the text.
+   * @param length The number of characters in the text.
+   * @return std::size_t The number of characters.
+   **/
+  static std::size_t measure(char const* text, std::size_t length);
+
+  /**
+   * @brief Figure out which format a board is written in, by looking at its first line: a line
+   *        without any spaces whose length is the number of cells of a board is in the compact
+   *        format, and everything else is in the text format.
+   *
+   * @param text The first character of the first line.
+   * @param length The number of characters in the first line (not including the newline).
+   * @return Format The format.
+   **/
+  static Format detect_format(char const* text, std::size_t length);
+  /**
+   * @brief The side length of a board in the compact format, by looking at its line
+   *
+   * @param length The number of characters in the line (not including the newline or a carriage
+   *               return).
+   * @return std::size_t The side length, or 0 if no board has that many cells.
+   **/
+  static std::size_t compact_size(std::size_t length);
+  /**
+   * @brief The character used for a value in the compact format
+   *
+   * @param value The value, between 0 (for unknown) and 61.
+   * @return char The character.
+   **/
+  static char compact_digit(int value);
+  /**
+   * @brief The characters of the compact format, indexed by value (from 0 for unknown to 61).
+   **/
+  static const char compact_digits[];
+
+  /**
+   * @brief The number of bits that every cell takes up in the packed format: just enough for the
+   *        values 0 to n (so 4 bits for a 9*9 board, and 7 bits for a 64*64 board).
+   *
+   * @param n The side length.
+   * @return std::size_t The number of bits.
+   **/
+  static std::size_t packed_bits(std::size_t n);
+  /**
+   * @brief The number of bytes that a board takes up in the packed format, including its header
+   *
+   * @param n The side length.
+   * @return std::size_t The number of bytes, or 0 if no board has that side length.
+   **/
+  static std::size_t packed_size(std::size_t n);
+  /**
+   * @brief The number of bytes in the header of a batch in the packed format.
+   **/
+  static const std::size_t packed_header_size;
+
+  /**
+   * @brief Count the number of rows a board in the text format has, by looking at its first row
+   *
+   * @param text The first character of the first row.
+   * @param length The number of characters in the first row (not including the newline).
+   * @return std::size_t The number of cells in the first row, or 0 if the row is empty.
+   **/
+  static std::size_t count_cells(char const* text, std::size_t length);
+
+  /**
+   * @brief Tells you whether a board can have a certain side length (i.e., whether it is a
+   *        perfect square between 1 and 64).
+   *
+   * @param n The side length.
+   * @return bool Whether it is a valid side length.
+   **/
+  static bool is_good_size(std::size_t n);
+
+private:
+  /**
+   * @brief Helper method for recording a failure.
+   *
+   * @param error The error to overwrite.
+   * @param line The line on which the parse failed.
+   * @param column The column at which the parse failed.
+   * @param message A description of the failure.
+   * @return bool Always false, so that the parse can give up with a single statement.
+   **/
+  static bool fail(Error& error, std::size_t line, std::size_t column, char const* message);
+  /**
+   * @brief Helper method for finding the end of the current line.
+   *
+   * @param cur The first character of the line.
+   * @param end One past the last character of the text.
+   * @return char const* The newline at the end of the line, or end if there is none.
+   **/
+  static char const* find_line_end(char const* cur, char const* end);
+  /**
+   * @brief Helper method for skipping the blank lines in front of a board.
+   *
+   * @param cur The first character of the text.
+   * @param end One past the last character of the text.
+   * @param lines Overwritten with the number of lines that were skipped.
+   * @return char const* The first character of the first line that isn't blank (or end).
+   **/
+  static char const* skip_blank_lines(char const* cur, char const* end, std::size_t& lines);
+  /**
+   * @brief Helper method for turning a character of the compact format into a value.
+   *
+   * @param c The character.
+   * @return int The value (0 for unknown), or -1 if the character isn't a value.
+   **/
+  static int compact_value(char c);
+};
+
+#endif // PARSER_H
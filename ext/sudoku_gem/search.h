@@ -0,0 +1,567 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "budget.h"
+#include "search_state.h"
+#include "stats.h"
+
+/**
+ * @brief The settings that every kind of Search shares, regardless of the board it works on
+ **/
+class SearchBase
+{
+public:
+  /**
+   * @brief The ways in which the search can choose the next cell to color
+   **/
+  enum CellSelection
+  {
+    /**
+     * @brief Color the next unknown cell in row-major order.
+     **/
+    SELECT_NEXT_UNKNOWN,
+    /**
+     * @brief Color the unknown cell with the fewest colors left to choose from.
+     **/
+    SELECT_FEWEST_CANDIDATES
+  };
+
+  /**
+   * @brief The orders in which the search can try the colors of a cell
+   **/
+  enum ValueOrder
+  {
+    /**
+     * @brief Try the colors from smallest to largest.
+     **/
+    ORDER_LOWEST_FIRST,
+    /**
+     * @brief Try the color that rules out the fewest candidates of the cell's peers first (i.e.,
+     *        the "least constraining value" heuristic).
+     **/
+    ORDER_LEAST_CONSTRAINING
+  };
+
+  /**
+   * @brief The policies that a search should follow
+   **/
+  struct Options
+  {
+    /**
+     * @brief Construct the default options: choose the cell with the fewest candidates, try its
+     *        colors from smallest to largest, and search without any limits.
+     **/
+    Options() : selection(SELECT_FEWEST_CANDIDATES), order(ORDER_LOWEST_FIRST), budget(0) {}
+
+    /**
+     * @brief How the next cell to color should be chosen.
+     **/
+    CellSelection selection;
+    /**
+     * @brief The order in which the colors of a cell should be tried.
+     **/
+    ValueOrder order;
+    /**
+     * @brief The limits on the search, or NULL if it may run until it is done. If the budget runs
+     *        out, the search gives up as if it had explored the whole tree.
+     **/
+    SearchBudget* budget;
+  };
+
+  /**
+   * @brief The solution count that several searches of disjoint parts of the same search tree
+   *        share, so that they can stop together once enough solutions have been found between
+   *        them
+   **/
+  struct SharedCount
+  {
+    /**
+     * @brief Construct a shared count that has not found anything yet.
+     *
+     * @param limit The number of solutions after which every search should stop.
+     **/
+    explicit SharedCount(std::size_t limit) : limit(limit), found(0), stop(false) {}
+
+    /**
+     * @brief The number of solutions after which every search should stop.
+     **/
+    const std::size_t limit;
+    /**
+     * @brief The number of solutions that have been found so far (never more than limit).
+     **/
+    std::atomic<std::size_t> found;
+    /**
+     * @brief Set once the limit has been reached, so the searches that are still running give up.
+     **/
+    std::atomic<bool> stop;
+  };
+};
+
+/**
+ * @brief An iterative, depth-first search for the colorings of a Sudoku board
+ *
+ * The BasicSearch class walks the same search tree as the recursive colorability solver, but it
+ * keeps its frames on an explicit stack with one slot per cell of the board, which is sized when
+ * the search is run (so a search that is run again after its state has been reloaded reuses it).
+ * This means that the memory used by a search is bounded by the size of the board, and that even a
+ * 64*64 board cannot overflow the (possibly small) call stack of the thread that is solving it.
+ * The cells are colored in place through a search state, so every frame only needs to remember
+ * which cell it is coloring and which colors are left to try.
+ *
+ * Before the first guess, and again after every guess, the search fills in the naked and hidden
+ * singles (see BasicSearchState::propagate()). Easy puzzles are usually solved by that alone, and
+ * the cells it fills in are part of the guess that forced them, so backtracking undoes them as
+ * well.
+ *
+ * The search is templated on its state, so the same engine drives both the general SearchState
+ * and the BasicSearchState<N> kernels that are specialized for common board sizes. In the latter
+ * case, the stack is a fixed array as well, and the whole search runs without heap allocations.
+ **/
+template <typename State>
+class BasicSearch : public SearchBase
+{
+public:
+  /**
+   * @brief A function that is shown every coloring the search finds, while it is still on the
+   *        state. It returns whether the search should keep going.
+   **/
+  typedef std::function<bool (State const& state)> Visitor;
+
+  /**
+   * @brief Construct a search over a given state
+   *
+   * @param state The Sudoku game board, along with the colors it has used and the undo trail. It
+   *              must outlive the search.
+   * @param options The policies the search should follow. Defaults to Options().
+   **/
+  BasicSearch(State& state, Options const& options = Options());
+  virtual ~BasicSearch();
+
+  /**
+   * @brief Look for colorings of the board, stopping as soon as enough of them have been found
+   *
+   * If the limit is reached, then the last coloring that was found is left on the state, so
+   * run(1) solves the puzzle in place. Otherwise, the whole search tree has been explored (or the
+   * budget of the options ran out first), and every node that was colored by the search is
+   * uncolored again.
+   *
+   * The board must not have any repeated elements to begin with (see
+   * Validator::is_good_partial_board). From then on, every color is checked against the masks
+   * when it is placed, so reaching a completely colored board proves that it is a solution, and
+   * the board is never rescanned. Define SUDOKU_CHECK_SOLUTIONS to assert that anyway.
+   *
+   * @param limit The number of colorings after which the search should stop. Must be at least 1.
+   * @return std::size_t The number of colorings that were found (at most limit).
+   **/
+  std::size_t run(std::size_t limit);
+
+  /**
+   * @brief Count the solutions of this search in a count that is shared with other searches
+   *
+   * Every solution is then counted in the shared count as well, and the search stops as soon as
+   * the shared count reaches its limit, even if it was another search that got it there. If this
+   * search found the solution that reached the limit, then it is left on the state (see
+   * limit_reached()). Otherwise, every node that was colored by the search is uncolored again.
+   *
+   * @param shared The shared count, which must outlive the search. If this is NULL, the search
+   *               stops sharing.
+   **/
+  void share(SharedCount* shared);
+  /**
+   * @brief Show every coloring that is counted to a visitor
+   *
+   * If the visitor asks the search to stop, then the search (and every search it shares a count
+   * with) stops right away, and every node that was colored by the search is uncolored again.
+   *
+   * @param visitor The visitor. If this is empty, the search stops visiting.
+   **/
+  void visit(Visitor visitor);
+  /**
+   * @brief Change the policies that the next run() should follow
+   *
+   * @param options The policies.
+   **/
+  void set_options(Options const& options);
+  /**
+   * @brief Whether the last run() stopped because it found the solution that reached the limit
+   *        (in which case that solution is left on the state)
+   *
+   * @return bool Whether the limit was reached by this search.
+   **/
+  bool limit_reached() const;
+  /**
+   * @brief What the last run() did
+   *
+   * @return SearchStats const& The counts of the last run().
+   **/
+  SearchStats const& stats() const;
+
+private:
+  /**
+   * @brief The integer type used for sets of colors.
+   **/
+  typedef typename State::Mask Mask;
+
+  /**
+   * @brief The state of one level of the search tree
+   **/
+  struct Frame
+  {
+    /**
+     * @brief The x position of the cell that is being colored.
+     **/
+    std::size_t x;
+    /**
+     * @brief The y position of the cell that is being colored.
+     **/
+    std::size_t y;
+    /**
+     * @brief The trail checkpoint from before the cell was colored.
+     **/
+    std::size_t mark;
+    /**
+     * @brief The colors the cell may use, which have not been tried yet.
+     **/
+    Mask colors;
+  };
+
+  /**
+   * @brief Helper method for opening a new level of the search tree at the next unknown cell, as
+   *        chosen by the cell selection policy
+   *
+   * @param cur_x The last x position considered on the game board.
+   * @param cur_y The last y position considered on the game board.
+   * @return bool Whether there was an unknown cell left to color.
+   **/
+  bool push(std::size_t cur_x, std::size_t cur_y);
+  /**
+   * @brief Helper method for taking the next color to try out of a frame, as chosen by the value
+   *        ordering policy
+   *
+   * @param frame The frame. Must have at least one color left.
+   * @return int The color.
+   **/
+  int pop_color(Frame& frame);
+  /**
+   * @brief Helper method for counting a solution that is on the state, locally and in the shared
+   *        count (if there is one)
+   *
+   * @param found The number of solutions this search has found, which is incremented if the
+   *              solution counts.
+   * @param limit The number of solutions after which this search should stop.
+   * @return bool Whether the search should stop now. If the solution counted, it stays on the
+   *         state, and limit_reached() is set.
+   **/
+  bool count_solution(std::size_t& found, std::size_t limit);
+
+  /**
+   * @brief The board that is being searched.
+   **/
+  State& state;
+  /**
+   * @brief The policies the search follows.
+   **/
+  Options options;
+  /**
+   * @brief The explicit stack, with room for one frame per cell of the board.
+   **/
+  StateBuffer<Frame, State::size * State::size> stack;
+  /**
+   * @brief The number of frames that are currently in use.
+   **/
+  std::size_t depth;
+  /**
+   * @brief The count that this search shares with other searches, if any.
+   **/
+  SharedCount* shared;
+  /**
+   * @brief The visitor of the colorings, if any.
+   **/
+  Visitor visitor;
+  /**
+   * @brief Whether the last run() stopped on the solution that reached the limit.
+   **/
+  bool reached;
+  /**
+   * @brief The counts of the last run().
+   **/
+  SearchStats counters;
+};
+
+/**
+ * @brief The search for boards whose size is only known at runtime.
+ **/
+typedef BasicSearch<SearchState> Search;
+
+template <typename State>
+BasicSearch<State>::BasicSearch(State& state, Options const& options) : state(state),
+  options(options), depth(0), shared(0), reached(false)
+{
+}
+
+template <typename State>
+bool BasicSearch<State>::push(std::size_t cur_x, std::size_t cur_y)
+{
+  std::size_t unknown_x, unknown_y;
+  bool found;
+
+  if (this->options.selection == SELECT_FEWEST_CANDIDATES)
+  {
+    found = this->state.find_most_constrained(unknown_x, unknown_y);
+  }
+  else
+  {
+    found = this->state.find_unknown(cur_x, cur_y, unknown_x, unknown_y);
+  }
+
+  if (!found)
+  {
+    return false;
+  }
+
+  Frame& frame = this->stack[this->depth++];
+  frame.x = unknown_x;
+  frame.y = unknown_y;
+  frame.mark = this->state.checkpoint();
+  frame.colors = this->state.candidates(unknown_x, unknown_y);
+  this->counters.reached(this->depth);
+  return true;
+}
+
+template <typename State>
+int BasicSearch<State>::pop_color(Frame& frame)
+{
+  int i;
+
+  //a single color doesn't need any ordering
+  if (this->options.order == ORDER_LEAST_CONSTRAINING && (frame.colors & (frame.colors - 1)) != 0)
+  {
+    i = this->state.least_constraining_color(frame.x, frame.y, frame.colors);
+  }
+  else
+  {
+    i = lowest_color(frame.colors);
+  }
+
+  frame.colors &= Mask(~color_bit<Mask>(i));
+  return i;
+}
+
+template <typename State>
+void BasicSearch<State>::share(SharedCount* shared)
+{
+  this->shared = shared;
+}
+
+template <typename State>
+void BasicSearch<State>::visit(Visitor visitor)
+{
+  this->visitor = visitor;
+}
+
+template <typename State>
+void BasicSearch<State>::set_options(Options const& options)
+{
+  this->options = options;
+}
+
+template <typename State>
+bool BasicSearch<State>::limit_reached() const
+{
+  return this->reached;
+}
+
+template <typename State>
+SearchStats const& BasicSearch<State>::stats() const
+{
+  return this->counters;
+}
+
+template <typename State>
+bool BasicSearch<State>::count_solution(std::size_t& found, std::size_t limit)
+{
+  bool last;
+
+  if (this->shared == 0)
+  {
+    last = (++found >= limit);
+  }
+  else
+  {
+    std::size_t total = this->shared->found.load();
+
+    //only count the solution if the limit hasn't been reached yet, so the total never overshoots
+    for (;;)
+    {
+      if (total >= this->shared->limit)
+      {
+        //somebody else got there first
+        return true;
+      }
+
+      if (this->shared->found.compare_exchange_weak(total, total + 1))
+      {
+        break;
+      }
+    }
+
+    last = (++found >= limit || total + 1 >= this->shared->limit);
+  }
+
+  //a visitor that has seen enough stops the search just like the limit does, but doesn't keep
+  //the coloring
+  if (this->visitor && !this->visitor(this->state))
+  {
+    if (this->shared != 0)
+    {
+      this->shared->stop = true;
+    }
+
+    return true;
+  }
+
+  if (last)
+  {
+    if (this->shared != 0)
+    {
+      this->shared->stop = true;
+    }
+
+    this->reached = true;
+  }
+
+  return last;
+}
+
+template <typename State>
+std::size_t BasicSearch<State>::run(std::size_t limit)
+{
+  const std::size_t root = this->state.checkpoint();
+  std::size_t found = 0;
+
+  //the state may have been reloaded with a different board since the last run
+  const std::size_t cells = this->state.n() * this->state.n();
+  SearchBudget::Meter meter(this->options.budget, SearchBudget::interval_for(cells));
+
+  this->stack.resize(cells);
+  this->depth = 0;
+  this->reached = false;
+  this->counters = SearchStats();
+
+  //fill in everything that is forced before we start guessing
+  const bool consistent = this->state.propagate();
+  this->counters.propagated(this->state.checkpoint() - root);
+
+  if (!consistent)
+  {
+    this->state.rollback(root);
+    return 0;
+  }
+
+  //a board without any unknowns (and without any repeats) is already solved
+  if (!this->push(0, 0))
+  {
+#ifdef SUDOKU_CHECK_SOLUTIONS
+    assert(this->state.solved());
+#endif
+
+    //the only coloring is the one propagation made, so it stays only if it reached the limit
+    if (!this->count_solution(found, limit) || !this->reached)
+    {
+      this->state.rollback(root);
+    }
+
+    return found;
+  }
+
+  while (this->depth > 0)
+  {
+    //give up once the other searches have found enough, or once we're out of time
+    if ((this->shared != 0 && this->shared->stop.load(std::memory_order_relaxed)) || meter.tick())
+    {
+      break;
+    }
+
+    Frame& frame = this->stack[this->depth - 1];
+
+    //uncolor whatever this level tried last
+    this->state.rollback(frame.mark);
+
+    if (frame.colors == 0)
+    {
+      //we couldn't find a coloring for this branch, so backtrack
+      this->depth--;
+      this->counters.backtrack();
+      continue;
+    }
+
+    //color the node, and then fill in whatever that forces (if it's a dead end, try the next color)
+    this->state.assign(frame.x, frame.y, this->pop_color(frame));
+    this->counters.node();
+
+    const std::size_t guessed = this->state.checkpoint();
+    const bool propagated = this->state.propagate();
+    this->counters.propagated(this->state.checkpoint() - guessed);
+
+    if (!propagated)
+    {
+      continue;
+    }
+
+    //check if we can keep coloring nodes, or if we need to stop and assess the generated board
+    if (!this->push(frame.x, frame.y))
+    {
+      //every color came from the candidates of its cell, so a completely colored board is always
+      //a valid coloring
+#ifdef SUDOKU_CHECK_SOLUTIONS
+      assert(this->state.solved());
+#endif
+
+      if (this->count_solution(found, limit))
+      {
+        if (this->reached)
+        {
+          return found;
+        }
+
+        break;
+      }
+    }
+  }
+
+  //uncolor whatever was forced before the first guess (and whatever we were in the middle of)
+  this->state.rollback(root);
+  return found;
+}
+
+template <typename State>
+BasicSearch<State>::~BasicSearch()
+{
+}
+
+#endif // SEARCH_H
@@ -0,0 +1,862 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEARCH_STATE_H
+#define SEARCH_STATE_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "arena.h"
+#include "color_mask.h"
+#include "grid.h"
+
+/**
+ * @brief The side length of a block of a n*n board (i.e., the integer square root of n)
+ *
+ * @param n The side length of the board.
+ * @param r The candidate root to start from. Defaults to 0.
+ * @return std::size_t The side length of a block.
+ **/
+constexpr std::size_t block_side(std::size_t n, std::size_t r = 0)
+{
+  return ((r + 1) * (r + 1) > n) ? r : block_side(n, r + 1);
+}
+
+/**
+ * @brief Storage for the bookkeeping of a search: a fixed std::array when the size is known at
+ *        compile-time, and memory from an Arena or a std::vector when it is not (i.e., when Size
+ *        is 0). A copy always has a std::vector of its own, since the arena's memory belongs to
+ *        the search that it was handed out to.
+ **/
+template <typename T, std::size_t Size>
+struct StateBuffer
+{
+  bool resize(std::size_t, Arena* = 0) { return true; }
+  T& operator [](std::size_t i) { return this->items[i]; }
+  T const& operator [](std::size_t i) const { return this->items[i]; }
+
+  std::array<T, Size> items;
+};
+
+template <typename T>
+struct StateBuffer<T, 0>
+{
+  StateBuffer() : items(0), count(0) {}
+  StateBuffer(StateBuffer const& other) : owned(other.items, other.items + other.count),
+    items(owned.data()), count(other.count) {}
+
+  StateBuffer& operator=(StateBuffer const& other)
+  {
+    if (this != &other)
+    {
+      this->owned.assign(other.items, other.items + other.count);
+      this->items = this->owned.data();
+      this->count = other.count;
+    }
+
+    return *this;
+  }
+
+  //the contents are unspecified afterwards; this fails if the arena has run out of memory
+  bool resize(std::size_t size, Arena* arena = 0)
+  {
+    if (arena != 0)
+    {
+      T* memory = arena->allocate_array<T>(size);
+
+      if (memory == 0)
+      {
+        return false;
+      }
+
+      std::vector<T>().swap(this->owned);
+      this->items = memory;
+    }
+    else
+    {
+      this->owned.resize(size);
+      this->items = this->owned.data();
+    }
+
+    this->count = size;
+    return true;
+  }
+
+  T& operator [](std::size_t i) { return this->items[i]; }
+  T const& operator [](std::size_t i) const { return this->items[i]; }
+
+  std::vector<T> owned;
+  T* items;
+  std::size_t count;
+};
+
+/**
+ * @brief The incremental bookkeeping used by the solvers while they search for a solution
+ *
+ * The BasicSearchState class keeps its own copy of the cells of a Sudoku board (one byte per cell,
+ * with 0 for unknown cells), and it keeps track of which colors (numbers) have already been used
+ * by every row, every column and every sqrt(n)*sqrt(n) block. The masks are built once from a
+ * grid, and are then updated every time a solver places or removes a color, so finding the colors
+ * that a cell may use costs three ORs instead of a rescan of the row, the column and the block.
+ * The masks are encoded the same way as Validator::good_colors(): the least significant bit
+ * corresponds to the color 1, the next bit corresponds to the color 2, and so on.
+ *
+ * The state also owns the undo trail for in-place backtracking: assign() colors a cell directly
+ * and remembers it on a trail that is allocated once, up front, and rollback() uncolors
+ * everything that was assigned after a checkpoint. This way, the solvers never have to copy the
+ * board while they search. Once a solution is found, store() writes it back to a grid.
+ *
+ * When N is not 0, the state is specialized for N*N boards: the block size is a compile-time
+ * constant, everything is stored in fixed std::arrays (so there are no heap allocations), and the
+ * masks use the narrowest integer that fits N colors. SearchState is the general version, which
+ * works for every board size up to 64*64.
+ **/
+template <std::size_t N>
+class BasicSearchState
+{
+public:
+  /**
+   * @brief The integer type used for sets of colors.
+   **/
+  typedef typename ColorMask<N>::type Mask;
+
+  /**
+   * @brief The side length of the boards this state is specialized for (0 if it is not).
+   **/
+  static const std::size_t size = N;
+
+  /**
+   * @brief Construct an empty state (i.e., a state for a 0*0 grid, or an empty N*N grid)
+   **/
+  BasicSearchState();
+  /**
+   * @brief Construct the state for a given grid
+   *
+   * @param grid The grid whose values should be copied. If N is not 0, it must be a N*N grid.
+   **/
+  BasicSearchState(Grid const& grid);
+  virtual ~BasicSearchState();
+
+  /**
+   * @brief Throw away the current board, masks and trail, and rebuild them from a given grid
+   *
+   * @param grid The grid whose values should be copied. If N is not 0, it must be a N*N grid.
+   * @param arena Where the board, masks and trail of a state whose size is only known at runtime
+   *              (N = 0) should be kept, if this is not NULL, instead of on the heap. They are
+   *              then only valid until the arena is reset. Defaults to NULL.
+   * @return bool Whether the state was rebuilt, i.e., whether the arena had enough memory. If it
+   *         didn't, the state must be loaded again before it is used.
+   **/
+  bool load(Grid const& grid, Arena* arena = 0);
+  /**
+   * @brief Write the current state of the board to a grid (e.g., once a solution has been found)
+   *
+   * @param grid A grid of the same size as the one the state was loaded from.
+   **/
+  void store(Grid& grid) const;
+
+  /**
+   * @brief Tells you which colors a certain node may use (i.e., which numbers can I put in this
+   *        Sudoku cell?).
+   *
+   * @param x The x position of the cell.
+   * @param y The y position of the cell.
+   * @return Mask The colors that are unused by the row, column and block of the cell.
+   **/
+  Mask candidates(std::size_t x, std::size_t y) const;
+
+  /**
+   * @brief Find the next unknown (i.e., undetermined) cell of the board, in row-major order.
+   *
+   * @param cur_x The last x position considered on the game board.
+   * @param cur_y The last y position considered on the game board.
+   * @param x_out The x position of the next unknown cell.
+   * @param y_out The y position of the next unknown cell.
+   * @return bool Whether we were able to find an unknown cell.
+   **/
+  bool find_unknown(std::size_t cur_x, std::size_t cur_y, std::size_t& x_out,
+                    std::size_t& y_out) const;
+  /**
+   * @brief Find the unknown cell with the fewest colors left to choose from (i.e., the "minimum
+   *        remaining values" heuristic). Ties are broken arbitrarily.
+   *
+   * @param x_out The x position of the chosen cell.
+   * @param y_out The y position of the chosen cell.
+   * @return bool Whether there was an unknown cell left to choose.
+   **/
+  bool find_most_constrained(std::size_t& x_out, std::size_t& y_out) const;
+
+  /**
+   * @brief Find the color of a cell that rules out the fewest candidates of the cell's peers (the
+   *        unknown cells in the same row, column or block). Ties go to the smaller color.
+   *
+   * @param x The x position of the cell.
+   * @param y The y position of the cell.
+   * @param colors The colors to choose from. Must not be 0.
+   * @return int The least constraining color.
+   **/
+  int least_constraining_color(std::size_t x, std::size_t y, Mask colors) const;
+
+  /**
+   * @brief Color a cell of the board, update the masks, and remember the cell on the trail
+   *
+   * @param x The x position of the cell.
+   * @param y The y position of the cell.
+   * @param i The color to use (i.e., the number to assign the cell).
+   **/
+  void assign(std::size_t x, std::size_t y, int i);
+  /**
+   * @brief Fill in every cell whose color is forced, until no more cells are forced
+   *
+   * A cell is forced if it has only one color left to choose from (a "naked single"), or if it is
+   * the only cell of its row, column or block that may use a color which that unit still needs (a
+   * "hidden single"). The forced cells are colored with assign(), so they are on the trail and
+   * rollback() will uncolor them again.
+   *
+   * @return bool False if the board turned out to be unsolvable (i.e., some cell has no colors
+   *              left, or some unit has a color that no cell can use), and true otherwise.
+   **/
+  bool propagate();
+
+  /**
+   * @brief Get a marker for the current position of the trail, which can be passed to rollback()
+   *
+   * @return std::size_t The number of cells that are currently on the trail.
+   **/
+  std::size_t checkpoint() const;
+  /**
+   * @brief Uncolor every cell that was assigned after a given checkpoint, most recent first
+   *
+   * @param mark A value previously returned by checkpoint().
+   **/
+  void rollback(std::size_t mark);
+
+  /**
+   * @brief Tells you whether the board has been solved (i.e., every cell is colored, and every
+   *        row, column and block uses every color exactly once). This rescans the whole board, so
+   *        the search only uses it as a debugging assertion.
+   *
+   * @return bool Whether the board has been solved.
+   **/
+  bool solved() const;
+
+  /**
+   * @brief The side length of the board
+   *
+   * @return std::size_t The side-length.
+   **/
+  std::size_t n() const;
+
+private:
+  /**
+   * @brief The side length of a block
+   *
+   * @return std::size_t The side-length.
+   **/
+  std::size_t block_n() const;
+  /**
+   * @brief Helper method for finding the block that contains a given cell
+   *
+   * @param x The x position of the cell.
+   * @param y The y position of the cell.
+   * @return std::size_t The index of the block, counting left-to-right and then top-to-bottom.
+   **/
+  std::size_t block_index(std::size_t x, std::size_t y) const;
+  /**
+   * @brief Helper method for visiting the cells of a unit (i.e., a row, a column or a block)
+   *
+   * @param unit The index of the unit: rows are [0, n), columns are [n, 2n), and blocks are
+   *             [2n, 3n).
+   * @param k The index of the cell within the unit, in [0, n).
+   * @return std::size_t The cell, encoded as y * n + x.
+   **/
+  std::size_t unit_cell(std::size_t unit, std::size_t k) const;
+  /**
+   * @brief Helper method for recording that a cell has been colored in the masks
+   *
+   * @param x The x position of the cell.
+   * @param y The y position of the cell.
+   * @param i The color that was used.
+   **/
+  void place(std::size_t x, std::size_t y, int i);
+  /**
+   * @brief Helper method for forgetting that a cell has been colored (the inverse of place())
+   *
+   * @param x The x position of the cell.
+   * @param y The y position of the cell.
+   * @param i The color that was used.
+   **/
+  void undo(std::size_t x, std::size_t y, int i);
+  /**
+   * @brief Helper method for propagate(). Fill in every naked single.
+   *
+   * @param changed Set to true if any cell was filled in.
+   * @return bool False if some cell has no colors left, and true otherwise.
+   **/
+  bool fill_naked_singles(bool& changed);
+  /**
+   * @brief Helper method for propagate(). Fill in every hidden single of a unit.
+   *
+   * @param unit The index of the unit, as in unit_cell().
+   * @param changed Set to true if any cell was filled in.
+   * @return bool False if the unit has a color that no cell can use, and true otherwise.
+   **/
+  bool fill_hidden_singles(std::size_t unit, bool& changed);
+
+  /**
+   * @brief The color of every cell (encoded as y * n + x), or 0 if the cell is unknown.
+   **/
+  StateBuffer<std::uint8_t, N * N> cells;
+  /**
+   * @brief The cells that were assigned during the search, in order.
+   **/
+  StateBuffer<std::uint16_t, N * N> trail;
+  /**
+   * @brief The cells that are still unknown. Only the first unknown_count entries are
+   *        meaningful; assign() swaps its cell past the end, and rollback() swaps it back, so the
+   *        unknown cells can be visited without scanning the whole board.
+   **/
+  StateBuffer<std::uint16_t, N * N> unknowns;
+  /**
+   * @brief The index of every cell within BasicSearchState::unknowns.
+   **/
+  StateBuffer<std::uint16_t, N * N> unknown_index;
+  /**
+   * @brief The colors used by each row.
+   **/
+  StateBuffer<Mask, N> row_masks;
+  /**
+   * @brief The colors used by each column.
+   **/
+  StateBuffer<Mask, N> column_masks;
+  /**
+   * @brief The colors used by each block.
+   **/
+  StateBuffer<Mask, N> block_masks;
+  /**
+   * @brief Every color that may appear on the board (i.e., the lowest n bits).
+   **/
+  Mask full_mask;
+  /**
+   * @brief The number of cells that are currently on the trail.
+   **/
+  std::size_t trail_size;
+  /**
+   * @brief The number of cells that are still unknown.
+   **/
+  std::size_t unknown_count;
+  /**
+   * @brief The side length of the board, if N is 0.
+   **/
+  std::size_t dim;
+  /**
+   * @brief The side length of a block, if N is 0.
+   **/
+  std::size_t root;
+};
+
+/**
+ * @brief The search state for boards whose size is only known at runtime.
+ **/
+typedef BasicSearchState<0> SearchState;
+
+template <std::size_t N>
+const std::size_t BasicSearchState<N>::size;
+
+template <std::size_t N>
+BasicSearchState<N>::BasicSearchState() : full_mask(0), trail_size(0), unknown_count(0), dim(0),
+  root(0)
+{
+}
+
+template <std::size_t N>
+BasicSearchState<N>::BasicSearchState(Grid const& grid) : full_mask(0), trail_size(0),
+  unknown_count(0), dim(0), root(0)
+{
+  this->load(grid);
+}
+
+template <std::size_t N>
+bool BasicSearchState<N>::load(Grid const& grid, Arena* arena)
+{
+  const std::size_t n = grid.n();
+
+  this->dim = n;
+  this->root = block_side(n);
+  this->full_mask = all_colors<Mask>(n);
+
+  //every cell is assigned at most once per branch, so the trail never needs to grow
+  if (!this->cells.resize(n * n, arena) || !this->row_masks.resize(n, arena) ||
+      !this->column_masks.resize(n, arena) || !this->block_masks.resize(n, arena) ||
+      !this->trail.resize(n * n, arena) || !this->unknowns.resize(n * n, arena) ||
+      !this->unknown_index.resize(n * n, arena))
+  {
+    this->dim = 0;
+    this->trail_size = 0;
+    this->unknown_count = 0;
+    return false;
+  }
+
+  for (std::size_t k = 0; k < n; k++)
+  {
+    this->row_masks[k] = this->column_masks[k] = this->block_masks[k] = 0;
+  }
+
+  this->trail_size = 0;
+  this->unknown_count = 0;
+
+  std::uint8_t const* values = grid.data();
+
+  for (std::size_t y = 0; y < n; y++)
+  {
+    for (std::size_t x = 0; x < n; x++)
+    {
+      std::uint8_t a = values[y * n + x];
+
+      //record the known elements, and remember where the incomplete elements are
+      this->cells[y * n + x] = a;
+
+      if (a != 0)
+      {
+        this->place(x, y, a);
+      }
+      else
+      {
+        this->unknown_index[y * n + x] = std::uint16_t(this->unknown_count);
+        this->unknowns[this->unknown_count++] = std::uint16_t(y * n + x);
+      }
+    }
+  }
+
+  return true;
+}
+
+template <std::size_t N>
+void BasicSearchState<N>::store(Grid& grid) const
+{
+  const std::size_t n = this->n();
+  std::uint8_t* values = grid.data();
+
+  //both sides use 0 for unknown cells, so this is a straight copy
+  for (std::size_t k = 0; k < n * n; k++)
+  {
+    values[k] = this->cells[k];
+  }
+}
+
+template <std::size_t N>
+std::size_t BasicSearchState<N>::n() const
+{
+  return (N != 0) ? N : this->dim;
+}
+
+template <std::size_t N>
+std::size_t BasicSearchState<N>::block_n() const
+{
+  return (N != 0) ? block_side(N) : this->root;
+}
+
+template <std::size_t N>
+std::size_t BasicSearchState<N>::block_index(std::size_t x, std::size_t y) const
+{
+  return (y / this->block_n()) * this->block_n() + (x / this->block_n());
+}
+
+template <std::size_t N>
+std::size_t BasicSearchState<N>::unit_cell(std::size_t unit, std::size_t k) const
+{
+  const std::size_t n = this->n(), n_root = this->block_n();
+
+  if (unit < n)
+  {
+    //row
+    return unit * n + k;
+  }
+  else if (unit < 2 * n)
+  {
+    //column
+    return k * n + (unit - n);
+  }
+  else
+  {
+    //block
+    std::size_t block = unit - 2 * n;
+    std::size_t x = (block % n_root) * n_root + k % n_root,
+      y = (block / n_root) * n_root + k / n_root;
+    return y * n + x;
+  }
+}
+
+template <std::size_t N>
+typename BasicSearchState<N>::Mask BasicSearchState<N>::candidates(std::size_t x,
+                                                                   std::size_t y) const
+{
+  return Mask(~(this->row_masks[y] | this->column_masks[x] |
+                this->block_masks[this->block_index(x, y)]) & this->full_mask);
+}
+
+template <std::size_t N>
+void BasicSearchState<N>::place(std::size_t x, std::size_t y, int i)
+{
+  Mask bit = color_bit<Mask>(i);
+
+  this->row_masks[y] |= bit;
+  this->column_masks[x] |= bit;
+  this->block_masks[this->block_index(x, y)] |= bit;
+}
+
+template <std::size_t N>
+void BasicSearchState<N>::undo(std::size_t x, std::size_t y, int i)
+{
+  Mask bit = Mask(~color_bit<Mask>(i));
+
+  this->row_masks[y] &= bit;
+  this->column_masks[x] &= bit;
+  this->block_masks[this->block_index(x, y)] &= bit;
+}
+
+template <std::size_t N>
+bool BasicSearchState<N>::find_unknown(std::size_t cur_x, std::size_t cur_y, std::size_t& x_out,
+                                       std::size_t& y_out) const
+{
+  const std::size_t n = this->n();
+
+  //find the next unknown node from where we left off, so we don't need to re-examine any elements
+  for (std::size_t y = cur_y; y < n; y++, cur_x = 0)
+  {
+    for (std::size_t x = cur_x; x < n; x++)
+    {
+      if (this->cells[y * n + x] == 0)
+      {
+        x_out = x;
+        y_out = y;
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+template <std::size_t N>
+bool BasicSearchState<N>::find_most_constrained(std::size_t& x_out, std::size_t& y_out) const
+{
+  const std::size_t n = this->n();
+  std::size_t best = 0;
+  int best_count = 65;
+
+  for (std::size_t k = 0; k < this->unknown_count; k++)
+  {
+    std::size_t cell = this->unknowns[k];
+    int count = count_colors(this->candidates(cell % n, cell / n));
+
+    if (count < best_count)
+    {
+      best = cell;
+      best_count = count;
+
+      //nothing can beat a dead end or a forced move
+      if (count <= 1)
+      {
+        break;
+      }
+    }
+  }
+
+  if (best_count == 65)
+  {
+    return false;
+  }
+
+  x_out = best % n;
+  y_out = best / n;
+  return true;
+}
+
+template <std::size_t N>
+int BasicSearchState<N>::least_constraining_color(std::size_t x, std::size_t y,
+                                                  Mask colors) const
+{
+  const std::size_t n = this->n(), n_root = this->block_n();
+  const std::size_t block_x = (x / n_root) * n_root, block_y = (y / n_root) * n_root;
+  int counts[64] = { 0 };
+
+  //count how many peers would lose each color (a peer in both the block and the row or column is
+  //counted twice, which is fine for a heuristic)
+  for (std::size_t unit = 0; unit < 3; unit++)
+  {
+    for (std::size_t k = 0; k < n; k++)
+    {
+      std::size_t peer_x, peer_y;
+
+      if (unit == 0)
+      {
+        peer_x = k;
+        peer_y = y;
+      }
+      else if (unit == 1)
+      {
+        peer_x = x;
+        peer_y = k;
+      }
+      else
+      {
+        peer_x = block_x + k % n_root;
+        peer_y = block_y + k / n_root;
+      }
+
+      if (this->cells[peer_y * n + peer_x] == 0 && (peer_x != x || peer_y != y))
+      {
+        for (Mask shared = Mask(this->candidates(peer_x, peer_y) & colors); shared != 0;
+             shared &= Mask(shared - 1))
+        {
+          counts[lowest_color(shared) - 1]++;
+        }
+      }
+    }
+  }
+
+  int best = lowest_color(colors);
+
+  for (Mask rest = colors; rest != 0; rest &= Mask(rest - 1))
+  {
+    int i = lowest_color(rest);
+
+    if (counts[i - 1] < counts[best - 1])
+    {
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+template <std::size_t N>
+void BasicSearchState<N>::assign(std::size_t x, std::size_t y, int i)
+{
+  std::size_t cell = y * this->n() + x;
+
+  this->cells[cell] = std::uint8_t(i);
+  this->place(x, y, i);
+  this->trail[this->trail_size++] = std::uint16_t(cell);
+
+  //swap the cell with the last unknown, and then drop it off the end of the list
+  std::size_t index = this->unknown_index[cell], last = this->unknowns[--this->unknown_count];
+  this->unknowns[index] = std::uint16_t(last);
+  this->unknown_index[last] = std::uint16_t(index);
+  this->unknowns[this->unknown_count] = std::uint16_t(cell);
+}
+
+template <std::size_t N>
+bool BasicSearchState<N>::fill_naked_singles(bool& changed)
+{
+  const std::size_t n = this->n();
+  std::size_t k = 0;
+
+  while (k < this->unknown_count)
+  {
+    std::size_t cell = this->unknowns[k];
+    std::size_t x = cell % n, y = cell / n;
+    Mask colors = this->candidates(x, y);
+
+    if (colors == 0)
+    {
+      //this cell can't be colored at all
+      return false;
+    }
+    else if ((colors & (colors - 1)) == 0)
+    {
+      //there is only one color left, so use it (this moves another unknown into slot k)
+      this->assign(x, y, lowest_color(colors));
+      changed = true;
+    }
+    else
+    {
+      k++;
+    }
+  }
+
+  return true;
+}
+
+template <std::size_t N>
+bool BasicSearchState<N>::fill_hidden_singles(std::size_t unit, bool& changed)
+{
+  const std::size_t n = this->n();
+  Mask used, once = 0, twice = 0;
+
+  if (unit < n)
+  {
+    used = this->row_masks[unit];
+  }
+  else if (unit < 2 * n)
+  {
+    used = this->column_masks[unit - n];
+  }
+  else
+  {
+    used = this->block_masks[unit - 2 * n];
+  }
+
+  //figure out which colors can go in at least one, and at least two, of the unit's unknowns
+  for (std::size_t k = 0; k < n; k++)
+  {
+    std::size_t cell = this->unit_cell(unit, k);
+
+    if (this->cells[cell] == 0)
+    {
+      Mask colors = this->candidates(cell % n, cell / n);
+      twice |= once & colors;
+      once |= colors;
+    }
+  }
+
+  Mask missing = Mask(this->full_mask & ~used);
+
+  if ((missing & ~once) != 0)
+  {
+    //the unit needs a color that none of its cells can use
+    return false;
+  }
+
+  Mask singles = Mask(once & ~twice);
+
+  while (singles != 0)
+  {
+    int i = lowest_color(singles);
+    Mask bit = color_bit<Mask>(i);
+    bool placed = false;
+
+    singles &= Mask(~bit);
+
+    for (std::size_t k = 0; k < n && !placed; k++)
+    {
+      std::size_t cell = this->unit_cell(unit, k);
+
+      //an earlier single in this unit may have taken the only cell this color could use
+      if (this->cells[cell] == 0 && (this->candidates(cell % n, cell / n) & bit) != 0)
+      {
+        this->assign(cell % n, cell / n, i);
+        placed = true;
+      }
+    }
+
+    if (!placed)
+    {
+      return false;
+    }
+
+    changed = true;
+  }
+
+  return true;
+}
+
+template <std::size_t N>
+bool BasicSearchState<N>::propagate()
+{
+  bool changed = true;
+
+  while (changed)
+  {
+    changed = false;
+
+    if (!this->fill_naked_singles(changed))
+    {
+      return false;
+    }
+
+    for (std::size_t unit = 0; unit < 3 * this->n(); unit++)
+    {
+      if (!this->fill_hidden_singles(unit, changed))
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+template <std::size_t N>
+std::size_t BasicSearchState<N>::checkpoint() const
+{
+  return this->trail_size;
+}
+
+template <std::size_t N>
+void BasicSearchState<N>::rollback(std::size_t mark)
+{
+  const std::size_t n = this->n();
+
+  while (this->trail_size > mark)
+  {
+    std::size_t cell = this->trail[--this->trail_size];
+
+    this->undo(cell % n, cell / n, this->cells[cell]);
+    this->cells[cell] = 0;
+
+    //undo the swap from assign(), which still left the cell's old index behind
+    std::size_t index = this->unknown_index[cell], moved = this->unknowns[index];
+    this->unknowns[this->unknown_count] = std::uint16_t(moved);
+    this->unknown_index[moved] = std::uint16_t(this->unknown_count++);
+    this->unknowns[index] = std::uint16_t(cell);
+  }
+}
+
+template <std::size_t N>
+bool BasicSearchState<N>::solved() const
+{
+  const std::size_t n = this->n();
+
+  //every row, column and block must use every color exactly once
+  for (std::size_t unit = 0; unit < 3 * n; unit++)
+  {
+    Mask mask = 0;
+
+    for (std::size_t k = 0; k < n; k++)
+    {
+      std::uint8_t a = this->cells[this->unit_cell(unit, k)];
+
+      //reject units that are incomplete or have duplicates
+      if (a == 0 || (mask & color_bit<Mask>(a)) != 0)
+      {
+        return false;
+      }
+
+      mask |= color_bit<Mask>(a);
+    }
+
+    if (mask != this->full_mask)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template <std::size_t N>
+BasicSearchState<N>::~BasicSearchState()
+{
+}
+
+#endif // SEARCH_STATE_H
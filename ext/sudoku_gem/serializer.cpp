@@ -0,0 +1,187 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "serializer.h"
+
+namespace
+{
+  //the two decimal digits of every value a cell can have, so a value is written without dividing
+  const char digit_pairs[] =
+    "000102030405060708091011121314151617181920212223242526272829303132333435363738394041424344454647"
+    "4849505152535455565758596061626364";
+}
+
+std::size_t Serializer::text_capacity(std::size_t n)
+{
+  if (n == 0)
+  {
+    return 0;
+  }
+
+  //every cell is followed by a space or a newline, except for the last one
+  const std::size_t width = (n < 10) ? 1 : 2;
+  return n * n * (width + 1) - 1;
+}
+
+std::size_t Serializer::compact_capacity(std::size_t n)
+{
+  return (Parser::compact_size(n * n) == n) ? n * n : 0;
+}
+
+std::size_t Serializer::packed_capacity(std::size_t n)
+{
+  return Parser::packed_size(n);
+}
+
+std::size_t Serializer::capacity(std::size_t n, Parser::Format format)
+{
+  if (format == Parser::FORMAT_PACKED)
+  {
+    return packed_capacity(n);
+  }
+
+  if (format == Parser::FORMAT_COMPACT && compact_capacity(n) != 0)
+  {
+    return compact_capacity(n);
+  }
+
+  return text_capacity(n);
+}
+
+std::size_t Serializer::write_text(Grid const& grid, char* out)
+{
+  const std::size_t n = grid.n();
+  std::uint8_t const* cells = grid.data();
+  char* cur = out;
+
+  for (std::size_t y = 0; y < n; y++)
+  {
+    for (std::size_t x = 0; x < n; x++)
+    {
+      const std::size_t value = cells[y * n + x];
+
+      if (value == 0)
+      {
+        //unknowns are question marks
+        *cur++ = '?';
+      }
+      else if (value < 10)
+      {
+        *cur++ = char('0' + value);
+      }
+      else
+      {
+        *cur++ = digit_pairs[2 * value];
+        *cur++ = digit_pairs[2 * value + 1];
+      }
+
+      *cur++ = (x + 1 < n) ? ' ' : '\n';
+    }
+  }
+
+  //the last row doesn't get a newline
+  if (cur != out)
+  {
+    cur--;
+  }
+
+  return cur - out;
+}
+
+std::size_t Serializer::write_compact(Grid const& grid, char* out)
+{
+  const std::size_t cell_count = grid.n() * grid.n();
+  std::uint8_t const* cells = grid.data();
+
+  for (std::size_t k = 0; k < cell_count; k++)
+  {
+    out[k] = Parser::compact_digits[cells[k]];
+  }
+
+  return cell_count;
+}
+
+std::size_t Serializer::write_packed(Grid const& grid, char* out)
+{
+  const std::size_t n = grid.n();
+  const std::size_t bits = Parser::packed_bits(n);
+  std::uint8_t const* cells = grid.data();
+  std::uint8_t* cur = (std::uint8_t*)out;
+  std::uint32_t pending = 0;
+  std::size_t pending_bits = 0;
+
+  *cur++ = std::uint8_t(n);
+
+  for (std::size_t k = 0; k < n * n; k++)
+  {
+    pending |= std::uint32_t(cells[k]) << pending_bits;
+    pending_bits += bits;
+
+    if (pending_bits >= 8)
+    {
+      *cur++ = std::uint8_t(pending);
+      pending >>= 8;
+      pending_bits -= 8;
+    }
+  }
+
+  //the last byte is padded with zero bits
+  if (pending_bits > 0)
+  {
+    *cur++ = std::uint8_t(pending);
+  }
+
+  return (char*)cur - out;
+}
+
+std::size_t Serializer::write_packed_header(std::size_t count, char* out)
+{
+  std::uint8_t* bytes = (std::uint8_t*)out;
+
+  //a board never starts with a 0, so this is how a batch is told apart from a single board
+  bytes[0] = 0;
+  bytes[1] = std::uint8_t(count);
+  bytes[2] = std::uint8_t(count >> 8);
+  bytes[3] = std::uint8_t(count >> 16);
+  bytes[4] = std::uint8_t(count >> 24);
+
+  return Parser::packed_header_size;
+}
+
+std::size_t Serializer::write(Grid const& grid, Parser::Format format, char* out)
+{
+  if (format == Parser::FORMAT_PACKED)
+  {
+    return write_packed(grid, out);
+  }
+
+  if (format == Parser::FORMAT_COMPACT && compact_capacity(grid.n()) != 0)
+  {
+    return write_compact(grid, out);
+  }
+
+  return write_text(grid, out);
+}
+
+void Serializer::append(Grid const& grid, Parser::Format format, std::string& out)
+{
+  const std::size_t start = out.length();
+
+  out.resize(start + capacity(grid.n(), format));
+  out.resize(start + write(grid, format, &out[start]));
+}
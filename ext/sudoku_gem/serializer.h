@@ -0,0 +1,132 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SERIALIZER_H
+#define SERIALIZER_H
+
+#include <cstddef>
+#include <string>
+
+#include "grid.h"
+#include "parser.h"
+
+/**
+ * @brief A class that writes Sudoku boards straight into a buffer of text
+ *
+ * The Serializer class is the other half of the Parser: it writes a board in any of the
+ * formats that the Parser reads, one cell at a time, into a buffer that the caller provides. The
+ * numbers come out of a precomputed table instead of a stream, so writing a board costs one pass
+ * over its cells and no allocations at all. Use the capacity methods to find out how big the
+ * buffer has to be.
+ **/
+class Serializer
+{
+public:
+  /**
+   * @brief The most characters that write_text() can write for a board of a given size
+   *
+   * @param n The side length of the board.
+   * @return std::size_t The number of characters.
+   **/
+  static std::size_t text_capacity(std::size_t n);
+  /**
+   * @brief The number of characters that write_compact() writes for a board of a given size
+   *
+   * @param n The side length of the board.
+   * @return std::size_t The number of characters, or 0 if the compact format has no characters
+   *         for a board that size (i.e., if it is larger than 49*49).
+   **/
+  static std::size_t compact_capacity(std::size_t n);
+  /**
+   * @brief The number of bytes that write_packed() writes for a board of a given size (see
+   *        Parser::packed_size())
+   *
+   * @param n The side length of the board.
+   * @return std::size_t The number of bytes.
+   **/
+  static std::size_t packed_capacity(std::size_t n);
+  /**
+   * @brief The most characters that write() can write for a board of a given size
+   *
+   * @param n The side length of the board.
+   * @param format The format the board should be written in.
+   * @return std::size_t The number of characters.
+   **/
+  static std::size_t capacity(std::size_t n, Parser::Format format);
+
+  /**
+   * @brief Write a board in the text format (see Parser::parse_text()): n rows separated by
+   *        newlines, where every row has n cells separated by single spaces, with '?' for unknown
+   *        values. There is no newline after the last row.
+   *
+   * @param grid The board.
+   * @param out Where the text should go. It must have room for text_capacity() characters.
+   * @return std::size_t The number of characters that were written.
+   **/
+  static std::size_t write_text(Grid const& grid, char* out);
+  /**
+   * @brief Write a board in the compact format (see Parser::parse_compact()): a single line of
+   *        n*n characters, with '.' for unknown values. There is no newline after the line.
+   *
+   * @param grid The board, which must be 49*49 or smaller.
+   * @param out Where the text should go. It must have room for compact_capacity() characters.
+   * @return std::size_t The number of characters that were written.
+   **/
+  static std::size_t write_compact(Grid const& grid, char* out);
+  /**
+   * @brief Write a board in the packed format (see Parser::parse_packed()): a byte with the side
+   *        length, followed by the cells, Parser::packed_bits() bits each.
+   *
+   * @param grid The board.
+   * @param out Where the bytes should go. It must have room for packed_capacity() bytes.
+   * @return std::size_t The number of bytes that were written.
+   **/
+  static std::size_t write_packed(Grid const& grid, char* out);
+  /**
+   * @brief Write the header of a batch in the packed format (see Parser::parse_packed_header()).
+   *        The boards of the batch should be written right after it.
+   *
+   * @param count The number of boards in the batch, which must fit in 32 bits.
+   * @param out Where the bytes should go. It must have room for Parser::packed_header_size bytes.
+   * @return std::size_t The number of bytes that were written.
+   **/
+  static std::size_t write_packed_header(std::size_t count, char* out);
+  /**
+   * @brief Write a board in a given format. A board that is too large for the compact format is
+   *        written in the text format instead, so this always writes something that the Parser
+   *        can read back.
+   *
+   * @param grid The board.
+   * @param format The format the board should be written in.
+   * @param out Where the text should go. It must have room for capacity() characters.
+   * @return std::size_t The number of characters that were written.
+   **/
+  static std::size_t write(Grid const& grid, Parser::Format format, char* out);
+  /**
+   * @brief Write a board in a given format onto the end of a string (see write()). The string
+   *        only has to grow if its capacity is too small, so reusing one string for many boards
+   *        stops allocating.
+   *
+   * @param grid The board.
+   * @param format The format the board should be written in.
+   * @param out The string that the board should be appended to.
+   **/
+  static void append(Grid const& grid, Parser::Format format, std::string& out);
+};
+
+#endif // SERIALIZER_H
@@ -0,0 +1,208 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+/**
+ * @brief What a solver did while it was looking for solutions, and how long it took
+ *
+ * Every solver fills one of these in as it goes (see BasicSearch::stats(),
+ * ParallelSearch::stats() and DancingLinks::stats()), and Sudoku adds the time it spent reading
+ * and validating the puzzle (see Sudoku::get_stats()), so that the work behind a slow puzzle can
+ * be measured instead of guessed at. The counts are bumped through the inline methods below,
+ * which cost next to nothing; define SUDOKU_NO_STATS to compile them (and the timers) out
+ * entirely, in which case every count stays 0.
+ **/
+struct SearchStats
+{
+  /**
+   * @brief A stopwatch that adds the time between its construction and its destruction to one of
+   *        the times of a SearchStats
+   **/
+  class Timer
+  {
+  public:
+    /**
+     * @brief Start the stopwatch.
+     *
+     * @param seconds The time to add to, in seconds.
+     **/
+    explicit Timer(double& seconds) : seconds(seconds)
+#ifndef SUDOKU_NO_STATS
+      , start(std::chrono::steady_clock::now())
+#endif
+    {
+    }
+
+    /**
+     * @brief Stop the stopwatch, and add the time to SearchStats::Timer::seconds.
+     **/
+    ~Timer()
+    {
+#ifndef SUDOKU_NO_STATS
+      this->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                     this->start).count();
+#endif
+    }
+
+  private:
+    Timer(Timer const&);
+    Timer& operator=(Timer const&);
+
+    /**
+     * @brief The time to add to.
+     **/
+    double& seconds;
+#ifndef SUDOKU_NO_STATS
+    /**
+     * @brief When the stopwatch was started.
+     **/
+    std::chrono::steady_clock::time_point start;
+#endif
+  };
+
+  /**
+   * @brief Construct a set of counts that are all zero.
+   **/
+  SearchStats() : nodes(0), backtracks(0), propagations(0), max_depth(0), parse_time(0),
+    validate_time(0), search_time(0) {}
+
+  /**
+   * @brief Whether the counts are kept at all (i.e., whether SUDOKU_NO_STATS is not defined).
+   **/
+#ifdef SUDOKU_NO_STATS
+  static const bool enabled = false;
+#else
+  static const bool enabled = true;
+#endif
+
+  /**
+   * @brief Count a node of the search tree.
+   **/
+  void node()
+  {
+#ifndef SUDOKU_NO_STATS
+    this->nodes++;
+#endif
+  }
+  /**
+   * @brief Count a step back up the search tree.
+   **/
+  void backtrack()
+  {
+#ifndef SUDOKU_NO_STATS
+    this->backtracks++;
+#endif
+  }
+  /**
+   * @brief Count the cells that were filled in because they were forced.
+   *
+   * @param cells The number of cells.
+   **/
+  void propagated(std::size_t cells)
+  {
+#ifndef SUDOKU_NO_STATS
+    this->propagations += cells;
+#else
+    (void)cells;
+#endif
+  }
+  /**
+   * @brief Note how deep the search has gone.
+   *
+   * @param depth The number of guesses that are currently in effect.
+   **/
+  void reached(std::size_t depth)
+  {
+#ifndef SUDOKU_NO_STATS
+    this->max_depth = std::max(this->max_depth, depth);
+#else
+    (void)depth;
+#endif
+  }
+
+  /**
+   * @brief Add the counts and times of another solver to these (e.g., of a subtree that was
+   *        searched on another thread).
+   *
+   * @param other The other counts.
+   * @param depth How deep the other solver started in the search tree. Defaults to 0.
+   **/
+  void add(SearchStats const& other, std::size_t depth = 0)
+  {
+    this->nodes += other.nodes;
+    this->backtracks += other.backtracks;
+    this->propagations += other.propagations;
+    this->max_depth = std::max(this->max_depth, (other.max_depth != 0) ? depth + other.max_depth
+                                                                       : 0);
+    this->parse_time += other.parse_time;
+    this->validate_time += other.validate_time;
+    this->search_time += other.search_time;
+  }
+  /**
+   * @brief Zero everything that a solver fills in, but keep the times of reading the puzzle (so a
+   *        puzzle can be solved more than once, and the stats still describe the last time).
+   **/
+  void clear_search()
+  {
+    const double parse_time = this->parse_time, validate_time = this->validate_time;
+
+    *this = SearchStats();
+    this->parse_time = parse_time;
+    this->validate_time = validate_time;
+  }
+
+  /**
+   * @brief The number of nodes of the search tree that were visited, i.e., the number of times a
+   *        value was tried on a cell (or a row was chosen, for the exact cover solver).
+   **/
+  std::size_t nodes;
+  /**
+   * @brief The number of times the search ran out of values for a cell, and went back up the
+   *        search tree.
+   **/
+  std::size_t backtracks;
+  /**
+   * @brief The number of cells that were filled in because they were forced, rather than guessed
+   *        (see BasicSearchState::propagate()).
+   **/
+  std::size_t propagations;
+  /**
+   * @brief The largest number of guesses that were in effect at the same time.
+   **/
+  std::size_t max_depth;
+  /**
+   * @brief The time it took to read the puzzle, in seconds.
+   **/
+  double parse_time;
+  /**
+   * @brief The time it took to check the puzzle for repeated values, in seconds.
+   **/
+  double validate_time;
+  /**
+   * @brief The time the solver took, in seconds.
+   **/
+  double search_time;
+};
+
+#endif // STATS_H
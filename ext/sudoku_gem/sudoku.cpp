@@ -17,173 +17,257 @@
  */
 
 #include "sudoku.h"
+#include "bitboard.h"
+#include "dlx.h"
+#include "parallel_search.h"
+#include "parser.h"
+#include "serializer.h"
 #include "validator.h"
 
+#include <cassert>
+#include <cmath>
+#include <istream>
 #include <stdexcept>
-#include <sstream>
 #include <algorithm>
-#include <boost/algorithm/string.hpp>
+#include <mutex>
 
-Sudoku::Sudoku() : grid(0), status_ok(false)
+Sudoku::Sudoku() : grid(0), format(Parser::FORMAT_TEXT), status(STATUS_NOT_LOADED),
+  thread_pool(0), slow_solve_threshold(0), puzzle_buffer(0), cache(0), cache_buffer(0)
 {
 }
 
-bool Sudoku::insert_row(std::vector<std::string>& tokens, std::size_t y)
+bool Sudoku::parse_puzzle(std::istream& f)
 {
-  for (std::size_t x = 0; x < this->grid.n(); x++)
+  //reuse the buffers from the last puzzle, so a Sudoku that reads many puzzles stops allocating
+  std::string& text = this->text_buffer;
+  std::string& line = this->line_buffer;
+  std::size_t skipped_lines = 0;
+
+  //read the first line (skipping the blank lines between puzzles), to figure out the format and n
+  while (std::getline(f, line) && (line.empty() || line == "\r"))
   {
-    std::string const& token = tokens[x];
+    skipped_lines++;
+  }
 
-    try
-    {
-      int value = std::stoi(token);
+  text.assign(line);
 
-      //integer tokens must be between 1 and n, and unknowns should be question marks
-      if (value < 1 || value > (int)this->grid.n())
-      {
-        //invalid value in board
-        return false;
-      }
-      else
+  if (Parser::detect_format(line.data(), line.length()) == Parser::FORMAT_TEXT)
+  {
+    const std::size_t n = Parser::count_cells(line.data(), line.length());
+
+    //read n-1 more lines (unless n is bad, in which case the parser will complain about the first)
+    if (Parser::is_good_size(n))
+    {
+      for (std::size_t y = 1; y < n && std::getline(f, line); y++)
       {
-        this->grid.set(x, y, value);
+        text.push_back('\n');
+        text.append(line);
       }
     }
-    catch (std::invalid_argument &)
+  }
+
+  if (!this->parse_puzzle(text.data(), text.length()))
+  {
+    //the positions should count the lines we skipped
+    if (this->parse_error.line != 0)
     {
-      if (token == "?")
-      {
-        this->grid.set(x, y, -1);
-      }
-      else
-      {
-        //invalid character in board
-        return false;
-      }
+      this->parse_error.line += skipped_lines;
     }
+
+    return false;
   }
 
   return true;
 }
 
-bool Sudoku::parse_puzzle(std::istream& f)
+bool Sudoku::parse_puzzle(char const* text, std::size_t length, std::size_t* consumed)
 {
-  std::string line;
-  std::vector<std::string> tokens;
+  //a new puzzle starts a new set of stats
+  this->stats = SearchStats();
 
-  //read the first line, to figure out n
-  std::getline(f, line);
-  boost::split(tokens, line, boost::is_any_of(" "));
-  std::size_t n = tokens.size();
+  SearchStats::Timer timer(this->stats.parse_time);
+  return Parser::parse(text, length, this->grid, this->parse_error, this->format, consumed);
+}
 
-  if (n == 0 || line.empty())
+bool Sudoku::validate() const
+{
+  //whether this board is solvable
+  return Validator::is_good_partial_board(this->grid);
+}
+
+Sudoku::Status Sudoku::finish_reading(bool parsed)
+{
+  //a failed read replaces the last puzzle too, so it can't be solved by mistake
+  if (!parsed)
   {
-    //empty puzzle
-    return false;
+    this->status = STATUS_PARSE_ERROR;
   }
-
-  //make sure n is a perfect square
-  std::size_t n_sq = std::size_t(sqrt(n));
-
-  if (n_sq * n_sq != n && (n_sq + 1) * (n_sq + 1) != n)
+  else if (!this->timed_validate())
   {
-    //n is not a perfect square
-    return false;
+    this->parse_error.message = "a row, column or block has a repeated value";
+    this->status = STATUS_INVALID;
   }
-
-  //make sure n is not too big
-
-  if (n > 64)
+  else
   {
-    //the board cannot be solved with this program
-    return false;
+    this->status = STATUS_OK;
   }
 
-  //create the n*n grid
-  this->grid.reset(n);
+  return this->status;
+}
 
-  //put in the first row
-  if (!this->insert_row(tokens, 0))
+bool Sudoku::timed_validate()
+{
+  SearchStats::Timer timer(this->stats.validate_time);
+  return this->validate();
+}
+
+bool Sudoku::loaded() const
+{
+  return (this->status == STATUS_OK || this->status == STATUS_UNSOLVABLE ||
+          this->status == STATUS_TIMED_OUT || this->status == STATUS_OUT_OF_MEMORY);
+}
+
+Sudoku::Status Sudoku::search_status(bool solved) const
+{
+  if (solved)
   {
-    return false;
+    return STATUS_OK;
   }
 
-  //read n-1 lines
-  for (std::size_t y = 1; y < n; y++)
+  if (this->workspace.out_of_memory)
   {
-    std::getline(f, line);
-    boost::split(tokens, line, boost::is_any_of(" "));
+    return STATUS_OUT_OF_MEMORY;
+  }
 
-    //each line must have n tokens
-    if (tokens.size() != n)
-    {
-      //invalid board
-      return false;
-    }
+  SearchBudget const* budget = this->search_options.budget;
+  return (budget != 0 && budget->expired()) ? STATUS_TIMED_OUT : STATUS_UNSOLVABLE;
+}
 
-    //insert that row
-    if (!this->insert_row(tokens, y))
-    {
-      return false;
-    }
-  }
+bool Sudoku::read_puzzle_from_file(std::istream& f)
+{
+  return (this->finish_reading(this->parse_puzzle(f)) == STATUS_OK);
+}
 
-  return true;
+bool Sudoku::read_puzzle_from_string(std::string const& s)
+{
+  return (this->load(s.data(), s.length()) == STATUS_OK);
 }
 
-bool Sudoku::validate() const
+bool Sudoku::read_puzzle_from_buffer(char const* text, std::size_t length, std::size_t* consumed)
 {
-  //whether this board is solvable
-  return Validator::is_good_partial_board(this->grid);
+  return (this->load(text, length, consumed) == STATUS_OK);
 }
 
-bool Sudoku::read_puzzle_from_file(std::istream& f)
+bool Sudoku::read_puzzle_from_grid(Grid const& grid)
+{
+  return (this->load(grid) == STATUS_OK);
+}
+
+void Sudoku::reset()
+{
+  //keep the buffers of the grid, so the next puzzle doesn't have to allocate them again
+  this->grid.reset(0);
+  this->parse_error = Parser::Error();
+  this->format = Parser::FORMAT_TEXT;
+  this->status = STATUS_NOT_LOADED;
+  this->stats = SearchStats();
+}
+
+Sudoku::Status Sudoku::load(char const* text, std::size_t length, std::size_t* consumed)
+{
+  return this->finish_reading(this->parse_puzzle(text, length, consumed));
+}
+
+Sudoku::Status Sudoku::load(Grid const& grid)
 {
-  if (this->parse_puzzle(f))
+  const std::size_t n = grid.n();
+  std::uint8_t const* cells = grid.data();
+
+  //there is no text, so there are no positions to report
+  this->parse_error = Parser::Error();
+  this->format = Parser::FORMAT_TEXT;
+  this->stats = SearchStats();
+
+  bool parsed = true;
+
+  //checking and copying the cells takes the place of parsing them
   {
-    if (this->validate())
+    SearchStats::Timer timer(this->stats.parse_time);
+
+    if (!Parser::is_good_size(n))
+    {
+      this->parse_error.message = "the number of cells in a row must be a perfect square, "
+                                  "up to 64";
+      parsed = false;
+    }
+
+    for (std::size_t k = 0; parsed && k < n * n; k++)
+    {
+      if (cells[k] > n)
+      {
+        this->parse_error.message = "the value is out of range";
+        parsed = false;
+      }
+    }
+
+    if (parsed)
     {
-      this->status_ok = true;
-      return true;
+      this->grid = grid;
     }
   }
 
-  return false;
+  return this->finish_reading(parsed);
 }
 
-bool Sudoku::read_puzzle_from_string(std::string const& s)
+Sudoku::Status Sudoku::load_packed(char const* data, std::size_t length, std::size_t* consumed)
 {
-  std::stringstream iss(s);
+  this->format = Parser::FORMAT_PACKED;
+  this->stats = SearchStats();
+
+  bool parsed;
 
-  if (this->parse_puzzle(iss))
   {
-    if (this->validate())
-    {
-      this->status_ok = true;
-      return true;
-    }
+    SearchStats::Timer timer(this->stats.parse_time);
+    parsed = Parser::parse_packed(data, length, this->grid, this->parse_error, consumed);
   }
 
-  return false;
+  return this->finish_reading(parsed);
 }
 
 void Sudoku::print(std::ostream& out) const
 {
-  if (!this->status_ok)
+  if (!this->loaded())
   {
     throw std::logic_error("Puzzle has not been initialized");
   }
 
-  out << this->to_s() << std::endl;
+  out << this->to_s() << '\n';
 }
 
 std::string Sudoku::to_s() const
 {
-  std::string str = this->grid.to_s();
-  boost::replace_all(str, "-1", "?");
+  std::string str;
+  Serializer::append(this->grid, Parser::FORMAT_TEXT, str);
+  return str;
+}
+
+std::string Sudoku::to_compact_s() const
+{
+  std::string str;
+  Serializer::append(this->grid, Parser::FORMAT_COMPACT, str);
   return str;
 }
 
+std::size_t Sudoku::serialized_size(Parser::Format format) const
+{
+  return Serializer::capacity(this->grid.n(), format);
+}
+
+std::size_t Sudoku::serialize(char* out, Parser::Format format) const
+{
+  return Serializer::write(this->grid, format, out);
+}
+
 bool Sudoku::find_unknown(Grid& cur_grid, std::size_t cur_x, std::size_t cur_y,
   std::size_t& x_out, std::size_t& y_out)
 {
@@ -204,165 +288,450 @@ bool Sudoku::find_unknown(Grid& cur_grid, std::size_t cur_x, std::size_t cur_y,
   return false;
 }
 
-bool Sudoku::color_node(Grid& cur_grid, std::size_t cur_x, std::size_t cur_y)
+template <std::size_t N>
+std::size_t Sudoku::color_kernel(Grid const& cur_grid, std::size_t limit,
+                                 Search::Options const& options, ThreadPool* pool,
+                                 Grid* solution, SolutionCallback const* callback,
+                                 SearchStats* stats)
 {
-  std::size_t unknown_x, unknown_y;
+  typedef BasicSearchState<N> State;
 
-  //check if we can keep coloring nodes, or if we need to stop and assess the generated board
-  if (find_unknown(cur_grid, cur_x, cur_y, unknown_x, unknown_y))
-  {
-    std::uint_fast64_t colors = Validator::good_colors(cur_grid, unknown_x, unknown_y);
+  const std::size_t n = cur_grid.n();
+  State state(cur_grid);
+  typename BasicSearch<State>::Visitor visitor;
+  std::mutex callback_lock;
+  bool callback_done = false;
+  std::size_t found;
+  bool reached;
 
-    //clone the existing game board
-    Grid new_grid(cur_grid);
+  //a single worker can't do any better than the calling thread
+  const bool parallel = (pool != 0 && pool->size() > 1);
 
-    for (int i = 1; i <= (int)cur_grid.n(); i++)
+  if (callback != 0)
+  {
+    //show the callback a grid, one solution at a time (the workers might find them all at once)
+    visitor = [n, callback, parallel, &callback_lock, &callback_done](State const& colored)
     {
-      //can we use this color here?
-      if ((colors & (1 << (i - 1))) != 0)
+      Grid colored_grid(n);
+      colored.store(colored_grid);
+
+      if (parallel)
       {
-        //color the node
-        new_grid.set(unknown_x, unknown_y, i);
+        std::lock_guard<std::mutex> guard(callback_lock);
 
-        //if the coloring was successful, then return the colored graph indicate success
-        if (color_node(new_grid, unknown_x, unknown_y))
+        //the other workers may still be holding solutions after the callback has had enough
+        if (callback_done || !(*callback)(colored_grid))
         {
-          cur_grid = new_grid;
-          return true;
+          callback_done = true;
+          return false;
         }
+
+        return true;
       }
-    }
 
-    //we couldn't find a coloring :(
-    return false;
+      return (*callback)(colored_grid);
+    };
+  }
+
+  if (parallel)
+  {
+    ParallelSearch<State> search(state, *pool, options);
+    search.visit(visitor);
+    found = search.run(limit);
+    reached = search.limit_reached();
+
+    if (stats != 0)
+    {
+      stats->add(search.stats());
+    }
   }
   else
   {
-    //the board is completely colored, so we can't color any more nodes, but is it a valid coloring?
-    return Validator::is_good_board(cur_grid);
+    BasicSearch<State> search(state, options);
+    search.visit(visitor);
+    found = search.run(limit);
+    reached = search.limit_reached();
+
+    if (stats != 0)
+    {
+      stats->add(search.stats());
+    }
+  }
+
+  if (solution != 0 && reached)
+  {
+    state.store(*solution);
+  }
+
+  return found;
+}
+
+std::size_t Sudoku::workspace_kernel(Grid const& cur_grid, std::size_t limit,
+                                     Search::Options const& options, Workspace& workspace,
+                                     Grid* solution, SolutionCallback const* callback,
+                                     SearchStats* stats)
+{
+  //whatever the last puzzle left in the arena is taken back all at once
+  workspace.arena.reset();
+  workspace.out_of_memory = !workspace.state.load(cur_grid, &workspace.arena);
+
+  if (workspace.out_of_memory)
+  {
+    return 0;
+  }
+
+  workspace.search.set_options(options);
+
+  //show the callback a grid, one solution at a time (the search is serial, so there's no lock)
+  if (callback != 0)
+  {
+    const std::size_t n = cur_grid.n();
+
+    workspace.search.visit([n, callback](SearchState const& colored)
+    {
+      Grid colored_grid(n);
+      colored.store(colored_grid);
+      return (*callback)(colored_grid);
+    });
+  }
+
+  const std::size_t found = workspace.search.run(limit);
+
+  //the search outlives the callback, so it mustn't hold on to it
+  if (callback != 0)
+  {
+    workspace.search.visit(Search::Visitor());
+  }
+
+  if (stats != 0)
+  {
+    stats->add(workspace.search.stats());
+  }
+
+  if (solution != 0 && workspace.search.limit_reached())
+  {
+    workspace.state.store(*solution);
+  }
+
+  return found;
+}
+
+std::size_t Sudoku::count_colorings(Grid const& cur_grid, std::size_t limit,
+                                    Search::Options const& options, ThreadPool* pool,
+                                    Grid* solution, SolutionCallback const* callback,
+                                    Workspace* workspace, SearchStats* stats)
+{
+  switch (cur_grid.n())
+  {
+    case 4: { return color_kernel<4>(cur_grid, limit, options, pool, solution, callback, stats); }
+    case 9: { return color_kernel<9>(cur_grid, limit, options, pool, solution, callback, stats); }
+    case 16:
+    {
+      return color_kernel<16>(cur_grid, limit, options, pool, solution, callback, stats);
+    }
+    case 25:
+    {
+      return color_kernel<25>(cur_grid, limit, options, pool, solution, callback, stats);
+    }
+    default: { break; }
+  }
+
+  //a parallel search needs a state per subtree on the heap, so only the serial one reuses the
+  //buffers (and a memory limit keeps the search serial, since it can only cap the workspace)
+  if (workspace != 0 &&
+      (pool == 0 || pool->size() <= 1 || workspace->arena.get_limit() != 0))
+  {
+    return workspace_kernel(cur_grid, limit, options, *workspace, solution, callback, stats);
+  }
+
+  return color_kernel<0>(cur_grid, limit, options, pool, solution, callback, stats);
+}
+
+bool Sudoku::color_node(Grid& cur_grid, Search::Options const& options, ThreadPool* pool,
+                        Workspace* workspace, SearchStats* stats)
+{
+  return (count_colorings(cur_grid, 1, options, pool, &cur_grid, 0, workspace, stats) == 1);
+}
+
+Sudoku::Status Sudoku::solve()
+{
+  if (!this->loaded())
+  {
+    return this->status;
+  }
+
+  this->begin_search();
+
+  bool solved = false, cached = false;
+
+  {
+    SearchStats::Timer timer(this->stats.search_time);
+
+    //an equivalent puzzle may have been solved already, in which case its solution maps onto ours
+    if (this->cache != 0)
+    {
+      this->canonical.compute(this->grid);
+
+      if (this->cache->find(this->canonical.grid(), this->cache_buffer))
+      {
+        this->canonical.from_canonical(this->cache_buffer, this->grid);
+        solved = true;
+        cached = true;
+      }
+    }
+
+    if (!cached)
+    {
+      solved = color_node(this->grid, this->search_options, this->thread_pool, &this->workspace,
+                          &this->stats);
+
+      if (solved && this->cache != 0)
+      {
+        this->canonical.to_canonical(this->grid, this->cache_buffer);
+        this->cache->insert(this->canonical.grid(), this->cache_buffer);
+      }
+    }
   }
+
+  this->status = this->search_status(solved);
+  this->end_search();
+  return this->status;
+}
+
+Sudoku::Status Sudoku::get_status() const
+{
+  return this->status;
 }
 
 void Sudoku::solve_colorability_style()
 {
-  if (!this->status_ok)
+  if (!this->loaded())
   {
     throw std::logic_error("Puzzle has not been initialized");
   }
 
-  color_node(this->grid);
+  this->solve();
 }
 
-bool Sudoku::bruteforce_node(Grid& cur_grid, std::size_t cur_x, std::size_t cur_y)
+bool Sudoku::bruteforce_node(Grid& cur_grid, SearchStats& stats, SearchBudget::Meter& meter,
+                             std::size_t cur_x, std::size_t cur_y, std::size_t depth)
 {
   std::size_t unknown_x, unknown_y;
 
   //check if we can keep coloring nodes, or if we need to stop and assess the generated board
   if (find_unknown(cur_grid, cur_x, cur_y, unknown_x, unknown_y))
   {
-    //clone the existing game board
-    Grid new_grid(cur_grid);
-
     for (int i = 1; i <= (int)cur_grid.n(); i++)
     {
+      //give up once we're out of time (every level of the recursion sees this, and unwinds)
+      if (meter.tick())
+      {
+        return false;
+      }
+
+      //reject the value right away if it clashes with the row, column or block
+      if (!Validator::is_good_color(cur_grid, unknown_x, unknown_y, i))
+      {
+        continue;
+      }
+
       //color the cell value
-      new_grid.set(unknown_x, unknown_y, i);
+      cur_grid.set(unknown_x, unknown_y, i);
+      stats.node();
+      stats.reached(depth + 1);
 
-      //if the coloring was successful, then return the colored graph indicate success
-      if (bruteforce_node(new_grid, unknown_x, unknown_y))
+      //if the coloring was successful, then leave the colored graph alone and indicate success
+      if (bruteforce_node(cur_grid, stats, meter, unknown_x, unknown_y, depth + 1))
       {
-        cur_grid = new_grid;
         return true;
       }
+
+      cur_grid.set(unknown_x, unknown_y, -1);
     }
 
     //we couldn't find a solution :(
+    stats.backtrack();
     return false;
   }
   else
   {
-    //the board is completely colored, so we can't color any more nodes, but is it a valid coloring?
-    return Validator::is_good_board(cur_grid);
+    //every value was checked when it was placed, so a completely colored board is a valid coloring
+#ifdef SUDOKU_CHECK_SOLUTIONS
+    assert(Validator::is_good_board(cur_grid));
+#endif
+    return true;
   }
 }
 
 void Sudoku::solve_bruteforce_style()
 {
-  if (!this->status_ok)
+  if (!this->loaded())
   {
     throw std::logic_error("Puzzle has not been initialized");
   }
 
-  bruteforce_node(this->grid);
+  bool solved;
+
+  this->begin_search();
+
+  {
+    SearchStats::Timer timer(this->stats.search_time);
+    SearchBudget::Meter meter(this->search_options.budget);
+    solved = bruteforce_node(this->grid, this->stats, meter);
+  }
+
+  this->status = this->search_status(solved);
+  this->end_search();
 }
 
-int Sudoku::singular_decider(Grid& cur_grid, bool found_one, std::size_t cur_x, std::size_t cur_y)
+void Sudoku::solve_dlx_style()
 {
-  std::size_t unknown_x, unknown_y;
+  if (!this->loaded())
+  {
+    throw std::logic_error("Puzzle has not been initialized");
+  }
+
+  bool solved;
+
+  this->begin_search();
 
-  //check if we can keep coloring nodes, or if we need to stop and assess the generated board
-  if (find_unknown(cur_grid, cur_x, cur_y, unknown_x, unknown_y))
   {
-    std::uint_fast64_t colors = Validator::good_colors(cur_grid, unknown_x, unknown_y);
+    SearchStats::Timer timer(this->stats.search_time);
+    DancingLinks dlx(this->grid);
 
-    //clone the existing game board
-    Grid new_grid(cur_grid);
+    dlx.set_budget(this->search_options.budget);
+    solved = (dlx.solve(1) == 1);
 
-    for (int i = 1; i <= (int)cur_grid.n(); i++)
+    if (solved)
     {
-      //can we use this color here?
-      if ((colors & (1 << (i - 1))) != 0)
-      {
-        //color the node
-        new_grid.set(unknown_x, unknown_y, i);
-
-        //if the coloring was successful, then return the colored graph indicate success
-        switch (singular_decider(new_grid, found_one, unknown_x, unknown_y))
-        {
-          case 0: { break; } //that branch did not yield a solution, so keep going
-          case 1: { found_one = true; break; } //found one solution, so keep going
-          case 2: { return 2; } //confirmed multiple solutions, so stop
-        }
-      }
+      dlx.fill(this->grid);
     }
 
-    //we're done with this branch
-    return found_one ? 1 : 0;
+    this->stats.add(dlx.stats());
   }
-  else
+
+  this->status = this->search_status(solved);
+  this->end_search();
+}
+
+void Sudoku::solve_bitboard_style()
+{
+  if (!this->loaded())
   {
-    //the board is completely colored, so we can't color any more nodes, but is it a valid coloring?
-    if (Validator::is_good_board(cur_grid))
+    throw std::logic_error("Puzzle has not been initialized");
+  }
+
+  if (this->grid.n() != 9)
+  {
+    this->solve();
+    return;
+  }
+
+  bool solved;
+
+  this->begin_search();
+
+  {
+    SearchStats::Timer timer(this->stats.search_time);
+    BitboardSolver bitboard;
+
+    bitboard.load(this->grid);
+    bitboard.set_budget(this->search_options.budget);
+    solved = (bitboard.solve(1) == 1);
+
+    if (solved)
     {
-      if (found_one)
-      {
-        //oh no, we've got multiple solutions!
-        return 2;
-      }
-      else
-      {
-        //this is just the first solution
-        return 1;
-      }
+      bitboard.fill(this->grid);
     }
-    else
+
+    this->stats.add(bitboard.stats());
+  }
+
+  this->status = this->search_status(solved);
+  this->end_search();
+}
+
+bool Sudoku::singular()
+{
+  if (!this->loaded())
+  {
+    throw std::logic_error("Puzzle has not been initialized");
+  }
+
+  if (this->validate())
+  {
+    bool unique;
+
+    this->begin_search();
+
+    std::size_t found;
+
     {
-      //this branch did not yield a solution
-      return 0;
+      SearchStats::Timer timer(this->stats.search_time);
+      found = count_colorings(this->grid, 2, this->search_options, this->thread_pool, 0, 0,
+                              &this->workspace, &this->stats);
     }
+
+    //a second solution settles it, even if the budget ran out while we were looking for it
+    unique = (found == 1 && this->search_status(false) != STATUS_TIMED_OUT);
+    this->status = this->search_status(found == 2 || unique);
+    this->end_search();
+    return unique;
+  }
+  else
+  {
+    return false;
   }
 }
 
-bool Sudoku::singular()
+std::size_t Sudoku::count_solutions(std::size_t limit, SolutionCallback const& callback) const
 {
-  if (!this->status_ok)
+  if (!this->loaded())
+  {
+    throw std::logic_error("Puzzle has not been initialized");
+  }
+
+  this->workspace.out_of_memory = false;
+
+  //there is nothing to look for
+  if (limit == 0)
+  {
+    return 0;
+  }
+
+  return count_colorings(this->grid, limit, this->search_options, this->thread_pool, 0,
+                         callback ? &callback : 0, &this->workspace);
+}
+
+bool Sudoku::singular_dlx_style()
+{
+  if (!this->loaded())
   {
     throw std::logic_error("Puzzle has not been initialized");
   }
 
   if (this->validate())
   {
-    return (singular_decider(this->grid) == 1);
+    bool unique;
+
+    this->begin_search();
+
+    std::size_t found;
+
+    {
+      SearchStats::Timer timer(this->stats.search_time);
+      DancingLinks dlx(this->grid);
+
+      dlx.set_budget(this->search_options.budget);
+      found = dlx.solve(2);
+      this->stats.add(dlx.stats());
+    }
+
+    //a second solution settles it, even if the budget ran out while we were looking for it
+    unique = (found == 1 && this->search_status(false) != STATUS_TIMED_OUT);
+    this->status = this->search_status(found == 2 || unique);
+    this->end_search();
+    return unique;
   }
   else
   {
@@ -370,9 +739,140 @@ bool Sudoku::singular()
   }
 }
 
+void Sudoku::set_cell_selection(Search::CellSelection selection)
+{
+  this->search_options.selection = selection;
+}
+
+Search::CellSelection Sudoku::get_cell_selection() const
+{
+  return this->search_options.selection;
+}
+
+void Sudoku::set_value_order(Search::ValueOrder order)
+{
+  this->search_options.order = order;
+}
+
+Search::ValueOrder Sudoku::get_value_order() const
+{
+  return this->search_options.order;
+}
+
+void Sudoku::set_thread_pool(ThreadPool* pool)
+{
+  this->thread_pool = pool;
+}
+
+ThreadPool* Sudoku::get_thread_pool() const
+{
+  return this->thread_pool;
+}
+
+void Sudoku::set_budget(SearchBudget* budget)
+{
+  this->search_options.budget = budget;
+}
+
+SearchBudget* Sudoku::get_budget() const
+{
+  return this->search_options.budget;
+}
+
+void Sudoku::set_cache(SolutionCache* cache)
+{
+  this->cache = cache;
+}
+
+SolutionCache* Sudoku::get_cache() const
+{
+  return this->cache;
+}
+
+void Sudoku::set_memory_limit(std::size_t bytes)
+{
+  this->workspace.arena.set_limit(bytes);
+}
+
+std::size_t Sudoku::get_memory_limit() const
+{
+  return this->workspace.arena.get_limit();
+}
+
+bool Sudoku::ran_out_of_memory() const
+{
+  return this->workspace.out_of_memory;
+}
+
+Arena::Usage Sudoku::get_memory_usage() const
+{
+  return this->workspace.arena.usage();
+}
+
+void Sudoku::release_memory()
+{
+  this->workspace.arena.release();
+}
+
+std::size_t Sudoku::get_error_line() const
+{
+  return this->parse_error.line;
+}
+
+std::size_t Sudoku::get_error_column() const
+{
+  return this->parse_error.column;
+}
+
+char const* Sudoku::get_error_message() const
+{
+  return this->parse_error.message;
+}
+
+Parser::Format Sudoku::get_format() const
+{
+  return this->format;
+}
+
+Grid const& Sudoku::get_grid() const
+{
+  return this->grid;
+}
+
+SearchStats const& Sudoku::get_stats() const
+{
+  return this->stats;
+}
+
+void Sudoku::set_slow_solve_hook(double threshold, SlowSolveHook hook)
+{
+  this->slow_solve_threshold = threshold;
+  this->slow_solve_hook = hook;
+}
+
+void Sudoku::begin_search()
+{
+  this->stats.clear_search();
+  this->workspace.out_of_memory = false;
+
+  //the hook wants to see the puzzle, which the solver is about to overwrite
+  if (this->slow_solve_hook)
+  {
+    this->puzzle_buffer = this->grid;
+  }
+}
+
+void Sudoku::end_search()
+{
+  if (this->slow_solve_hook && this->stats.search_time >= this->slow_solve_threshold)
+  {
+    this->slow_solve_hook(this->puzzle_buffer, this->stats);
+  }
+}
+
 bool Sudoku::good() const
 {
-  return this->status_ok;
+  return this->loaded();
 }
 
 bool Sudoku::bad() const
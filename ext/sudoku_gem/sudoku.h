@@ -20,11 +20,21 @@
 #define SUDOKU_H
 
 #include <cstddef>
+#include <functional>
 #include <streambuf>
 #include <string>
 #include <vector>
 
+#include "arena.h"
+#include "budget.h"
+#include "cache.h"
+#include "canonical.h"
 #include "grid.h"
+#include "parser.h"
+#include "search.h"
+#include "search_state.h"
+#include "stats.h"
+#include "thread_pool.h"
 
 /**
  * @brief This is a class designed to quickly and easily solve puzzles for the popular game Sudoku.
@@ -34,20 +44,76 @@
  * either read_puzzle_from_file() or read_puzzle_from_string(). Once you do that, you should check
  * to make sure the puzzle was read in correctly by calling good(). Now that the class knows what it
  * is dealing with, it can start solving the puzzle: just call one of the solver methods. These
- * methods include: solve_colorability_style() and solve_bruteforce_style(). Once you call one of
- * those methods, the solution to the puzzle will be saved in the object.
+ * methods include: solve_colorability_style(), solve_bruteforce_style(), solve_dlx_style() and
+ * solve_bitboard_style(). Once you call one of those methods, the solution to the puzzle will be
+ * saved in the object.
+ *
+ * A Sudoku object can also be used as a reusable solver context, without any exceptions: load()
+ * a puzzle, solve() it, and check the Status that each of them returns. Loading a puzzle replaces
+ * the last one completely, and the object keeps its buffers from one puzzle to the next, so
+ * solving a stream of puzzles with a single object does not allocate once it has warmed up.
  * 
  * Please note that due to memory constraints, this class can only ever hope to solve puzzles up to
  * size 64*64. The actual Sudoku grid validations are performed by using bit hacks on 64-bit
- * unsigned integers, so anything over 64 would cause an overflow. However, it is certainly not
- * realistic to expect a solution for such a large board: if even a quarter of the cells in a 64*64
- * board were unknown, there would be over 1000 unknowns, which means there would be over 1000
- * recursive function calls, each one taking up a portion of the stack and each one attempting to
- * allocate memory on the heap. This could lead to a stack or heap overflow (memory exhaustion).
+ * unsigned integers, so anything over 64 would cause an overflow. The colorability solver and the
+ * uniqueness check search iteratively, with an explicit stack that has one small frame per cell,
+ * so their memory use is bounded by the size of the board. However, it is certainly not realistic
+ * to expect a solution for every large board: if even a quarter of the cells in a 64*64 board were
+ * unknown, there would be over 1000 unknowns, and the search tree could be astronomically large.
+ * Note that the brute force solver is still recursive, so it could overflow the stack.
  **/
 class Sudoku
 {
 public:
+  /**
+   * @brief A function that is shown every solution that count_solutions() finds. It returns
+   *        whether the count should keep going.
+   **/
+  typedef std::function<bool (Grid const& solution)> SolutionCallback;
+  /**
+   * @brief A function that is shown every puzzle that took a solver longer than a threshold (see
+   *        set_slow_solve_hook()), along with what the solver did. It is called on the thread
+   *        that ran the solver, before the solver returns.
+   **/
+  typedef std::function<void (Grid const& puzzle, SearchStats const& stats)> SlowSolveHook;
+
+  /**
+   * @brief The result of loading or solving a puzzle
+   **/
+  enum Status
+  {
+    /**
+     * @brief The puzzle was loaded (or solved, after solve()).
+     **/
+    STATUS_OK,
+    /**
+     * @brief No puzzle has been loaded yet, or the object was reset().
+     **/
+    STATUS_NOT_LOADED,
+    /**
+     * @brief The puzzle could not be read (see get_error_message()).
+     **/
+    STATUS_PARSE_ERROR,
+    /**
+     * @brief The puzzle was read, but a row, column or block has a repeated value.
+     **/
+    STATUS_INVALID,
+    /**
+     * @brief The puzzle was loaded, but it has no solution.
+     **/
+    STATUS_UNSOLVABLE,
+    /**
+     * @brief The puzzle was loaded, but the solver ran out of budget (see set_budget()) before it
+     *        finished. The board is left as it was, so the puzzle can be solved again.
+     **/
+    STATUS_TIMED_OUT,
+    /**
+     * @brief The puzzle was loaded, but the solver needed more memory than the limit allows (see
+     *        set_memory_limit()). The board is left as it was.
+     **/
+    STATUS_OUT_OF_MEMORY
+  };
+
   /**
    * @brief Constructor for a Sudoku instance.
    **/
@@ -55,12 +121,16 @@ public:
   virtual ~Sudoku();
 
   /**
-   * @brief Read in the puzzle from a given FILE* (this defaults to standard input) and store it in
-   *        memory.
+   * @brief Read in the next puzzle from a given input stream and store it in memory. Only the
+   *        lines of that puzzle are read, so calling this over and over again streams through a
+   *        file of puzzles, one at a time, without ever holding more than one of them in memory.
+   *        Blank lines between the puzzles are skipped.
    *
-   * @param f The file from which we should read the n*n Sudoku board, with rows separated by
-   *          newlines, columns separated by spaces, integers [1-n] as the known values, and '?' for
-   *          unknown values.
+   * @param f The file from which we should read the n*n Sudoku board. This is either in the text
+   *          format, with rows separated by newlines, columns separated by spaces, integers [1-n]
+   *          as the known values, and '?' for unknown values, or in the compact format, with all
+   *          n*n cells on one line and '.' or '0' for unknown values (see Parser::parse_compact()).
+   *          The format is detected from the first line.
    * @return bool Whether the parsing succeeded.
    **/
   bool read_puzzle_from_file(std::istream& f);
@@ -68,12 +138,140 @@ public:
    * @brief Read in the puzzle from a given string representing the Sudoku board, and then store it
    *        in memory.
    *
-   * @param s A string containing a n*n Sudoku board, with rows separated by newlines, columns
-   *          separated by spaces, integers [1-n] as the known values, and '?' for unknown values.
-   *                  unknown values.
+   * @param s A string containing a n*n Sudoku board, in either of the formats that
+   *          read_puzzle_from_file() understands.
    * @return bool Whether the parsing succeeded.
    **/
   bool read_puzzle_from_string(std::string const& s);
+  /**
+   * @brief Read in the puzzle from a buffer of text representing the Sudoku board, and then store
+   *        it in memory. The text is scanned in place, so this is the fastest way to read a
+   *        puzzle.
+   *
+   * @param text The first character of a n*n Sudoku board, in the same format as
+   *             read_puzzle_from_string().
+   * @param length The number of characters in the text.
+   * @param consumed Overwritten with the number of characters the puzzle took up, if this is not
+   *                 NULL, even if the parsing fails (see Parser::parse()). This is where the next
+   *                 puzzle in the buffer starts. Defaults to NULL.
+   * @return bool Whether the parsing succeeded.
+   **/
+  bool read_puzzle_from_buffer(char const* text, std::size_t length, std::size_t* consumed = 0);
+  /**
+   * @brief Read in the puzzle from a board that has already been filled in, and then store it in
+   *        memory. This skips the text entirely, for callers that already have the cells.
+   *
+   * @param grid The n*n Sudoku board, with 0 for unknown values.
+   * @return bool Whether the board is a valid puzzle.
+   **/
+  bool read_puzzle_from_grid(Grid const& grid);
+
+  /**
+   * @brief Forget the current puzzle, so that the object is in the same state as a new one
+   *        (except for its policies, its thread pool and its buffers, which are kept).
+   **/
+  void reset();
+  /**
+   * @brief Load the next puzzle from a buffer of text, replacing the current one. This is
+   *        read_puzzle_from_buffer(), with a status instead of a bool.
+   *
+   * @param text The first character of a n*n Sudoku board, in the same format as
+   *             read_puzzle_from_string().
+   * @param length The number of characters in the text.
+   * @param consumed Overwritten with the number of characters the puzzle took up, if this is not
+   *                 NULL, even if the loading fails. Defaults to NULL.
+   * @return Status STATUS_OK, STATUS_PARSE_ERROR or STATUS_INVALID.
+   **/
+  Status load(char const* text, std::size_t length, std::size_t* consumed = 0);
+  /**
+   * @brief Load the next puzzle from a board that has already been filled in, replacing the
+   *        current one. This is read_puzzle_from_grid(), with a status instead of a bool.
+   *
+   * @param grid The n*n Sudoku board, with 0 for unknown values.
+   * @return Status STATUS_OK, STATUS_PARSE_ERROR or STATUS_INVALID.
+   **/
+  Status load(Grid const& grid);
+  /**
+   * @brief Load the next puzzle from a buffer in the packed format (see Parser::parse_packed()),
+   *        replacing the current one. The cells are unpacked straight out of the buffer, so
+   *        nothing is copied in between.
+   *
+   * @param data The first byte of the packed board.
+   * @param length The number of bytes in the buffer.
+   * @param consumed Overwritten with the number of bytes the puzzle took up, if this is not NULL
+   *                 and the puzzle could be read. Defaults to NULL.
+   * @return Status STATUS_OK, STATUS_PARSE_ERROR or STATUS_INVALID.
+   **/
+  Status load_packed(char const* data, std::size_t length, std::size_t* consumed = 0);
+  /**
+   * @brief Solve the loaded puzzle using the graph 9-coloring technique (like
+   *        solve_colorability_style()), but report problems instead of throwing them. If there
+   *        is a cache (see set_cache()), the solution is looked up there first, and a solution
+   *        that has to be searched for is added to it.
+   *
+   * @return Status STATUS_OK if the solution is now on the board, STATUS_UNSOLVABLE if there is
+   *         none or STATUS_TIMED_OUT if the budget ran out first (and in both cases the board is
+   *         left as it was), or the status of the last load if no puzzle is loaded.
+   **/
+  Status solve();
+  /**
+   * @brief Accessor for Sudoku::status
+   *
+   * @return Status The result of the last load() or solve() (or of the last read).
+   **/
+  Status get_status() const;
+
+  /**
+   * @brief Accessor for the line of Sudoku::parse_error
+   *
+   * @return std::size_t The line (counting from 1) at which the last read failed, or 0 if it
+   *         didn't fail at a particular position.
+   **/
+  std::size_t get_error_line() const;
+  /**
+   * @brief Accessor for the column of Sudoku::parse_error
+   *
+   * @return std::size_t The column (counting from 1) at which the last read failed, or 0 if it
+   *         didn't fail at a particular position.
+   **/
+  std::size_t get_error_column() const;
+  /**
+   * @brief Accessor for the message of Sudoku::parse_error
+   *
+   * @return char const* Why the last read failed, or NULL if it didn't.
+   **/
+  char const* get_error_message() const;
+  /**
+   * @brief Accessor for Sudoku::format
+   *
+   * @return Parser::Format The format that the last puzzle was read in.
+   **/
+  Parser::Format get_format() const;
+  /**
+   * @brief Accessor for Sudoku::grid
+   *
+   * @return Grid const& The current state of the board.
+   **/
+  Grid const& get_grid() const;
+  /**
+   * @brief Accessor for Sudoku::stats
+   *
+   * @return SearchStats const& What the last solver (or uniqueness check) did, and how long it
+   *         took to read the puzzle. Reading a puzzle starts the stats over, and count_solutions()
+   *         leaves them alone. Every count is 0 if SUDOKU_NO_STATS was defined.
+   **/
+  SearchStats const& get_stats() const;
+  /**
+   * @brief Have every solver (and uniqueness check) that takes at least a given time show the
+   *        puzzle and its stats to a hook, so that the slow puzzles of a big run can be sampled.
+   *        If SUDOKU_NO_STATS was defined, nothing is timed, so only a threshold of 0 calls the
+   *        hook (for every puzzle). By default, there is no hook.
+   *
+   * @param threshold The shortest search (see SearchStats::search_time) that the hook is shown,
+   *                  in seconds.
+   * @param hook The hook, or an empty function to remove it.
+   **/
+  void set_slow_solve_hook(double threshold, SlowSolveHook hook);
 
   /**
    * @brief Print the current state of the board to some output stream.
@@ -87,14 +285,68 @@ public:
    * @return std::string The human-readable representation of the board.
    **/
   std::string to_s() const;
+  /**
+   * @brief Return the current state of the board as a single line, in the compact format (see
+   *        Parser::parse_compact()). Boards larger than 49*49 cannot be written this way, so they
+   *        are returned in the same format as to_s() instead.
+   *
+   * @return std::string The compact representation of the board.
+   **/
+  std::string to_compact_s() const;
+  /**
+   * @brief Find out how big a buffer serialize() needs for the current state of the board.
+   *
+   * @param format The format the board should be written in. Defaults to Parser::FORMAT_TEXT.
+   * @return std::size_t The most characters that serialize() can write.
+   **/
+  std::size_t serialized_size(Parser::Format format = Parser::FORMAT_TEXT) const;
+  /**
+   * @brief Write the current state of the board into a buffer, without allocating anything (see
+   *        Serializer::write()). This is the fastest way to get the board out as text.
+   *
+   * @param out Where the text should go. It must have room for serialized_size() characters.
+   * @param format The format the board should be written in. A board that is too large for the
+   *               compact format is written in the text format instead, and Parser::FORMAT_PACKED
+   *               writes bytes rather than text. Defaults to Parser::FORMAT_TEXT.
+   * @return std::size_t The number of characters that were written.
+   **/
+  std::size_t serialize(char* out, Parser::Format format = Parser::FORMAT_TEXT) const;
 
   /**
    * @brief Determine whether the puzzle has only a single solution by using the graph 9-coloring
    *        technique. If there are no solutions or multiple solutions, the method will return true.
+   *        If the budget runs out before the answer is known, the method returns false and sets the
+   *        status to STATUS_TIMED_OUT (or STATUS_OUT_OF_MEMORY, if the search would have needed
+   *        more memory than the limit, see set_memory_limit()).
    *
    * @return bool Whether the Sudoku board has only 1 solution.
    **/
   bool singular();
+  /**
+   * @brief Determine whether the puzzle has only a single solution by using the exact cover
+   *        (dancing links) technique. This gives the same answer as singular(), and it runs out
+   *        of budget the same way.
+   *
+   * @return bool Whether the Sudoku board has only 1 solution.
+   **/
+  bool singular_dlx_style();
+  /**
+   * @brief Count the solutions of the puzzle by using the graph 9-coloring technique, stopping
+   *        as soon as a given number of them have been found. Unlike the solvers, this leaves the
+   *        puzzle as it is. If a thread pool was set (see set_thread_pool()), the subtrees of the
+   *        search are counted in parallel (unless a memory limit keeps it serial, see
+   *        set_memory_limit()).
+   *
+   * @param limit The number of solutions after which the count should stop.
+   * @param callback Shown every solution that is counted, if it is not empty. If it returns false,
+   *                 the count stops right away (and it is not called again). If a thread pool
+   *                 was set, the callback is called from its workers, but never from two of them
+   *                 at once, and the count may include a few solutions that other workers found
+   *                 in the meantime. Defaults to none.
+   * @return std::size_t The number of solutions that were found (at most limit).
+   **/
+  std::size_t count_solutions(std::size_t limit,
+                              SolutionCallback const& callback = SolutionCallback()) const;
 
   /**
    * @brief Attempt to solve the puzzle using the graph 9-coloring technique. If the puzzle was
@@ -108,30 +360,199 @@ public:
    *        the solution will be saved to memory (overwriting the existing grid) and the method will
    *        return true. If the puzzle could not be solved for whatever reason, then this method
    *        will return false. Note that this approach will take a very, very long time. However, it
-   *        will EVENTUALLY find a solution.
+   *        will EVENTUALLY find a solution, unless a budget stops it first (see set_budget()).
+   *        Like solve(), this sets the status to tell whether it succeeded.
    **/
   void solve_bruteforce_style();
+  /**
+   * @brief Attempt to solve the puzzle by reducing it to an exact cover problem, and solving that
+   *        with Knuth's dancing links (Algorithm X). If the puzzle was successfully solved, then
+   *        the solution will be saved to memory (overwriting the existing grid). Like solve(), this
+   *        sets the status to tell whether it succeeded.
+   **/
+  void solve_dlx_style();
+  /**
+   * @brief Attempt to solve the puzzle with a solver that only knows 9*9 boards, and keeps one
+   *        bitboard of candidates per digit (see BitboardSolver). This is the fastest solver for
+   *        9*9 boards, but it ignores the cell selection, the value order, the thread pool and the
+   *        cache; it does stay within the budget. Any other size is solved with
+   *        solve_colorability_style() instead. Like solve(), this sets the status to tell whether
+   *        it succeeded.
+   **/
+  void solve_bitboard_style();
 
   /**
-   * @brief Accessor for Sudoku::status_ok
+   * @brief Choose how the colorability solver and the uniqueness check pick the next cell to
+   *        color. By default, they pick the unknown cell with the fewest candidates.
+   *
+   * @param selection The cell selection policy.
+   **/
+  void set_cell_selection(Search::CellSelection selection);
+  /**
+   * @brief Accessor for the cell selection policy of Sudoku::search_options
+   *
+   * @return Search::CellSelection The cell selection policy.
+   **/
+  Search::CellSelection get_cell_selection() const;
+  /**
+   * @brief Choose the order in which the colorability solver and the uniqueness check try the
+   *        colors of a cell. By default, they try the smallest color first.
+   *
+   * @param order The value ordering policy.
+   **/
+  void set_value_order(Search::ValueOrder order);
+  /**
+   * @brief Accessor for the value ordering policy of Sudoku::search_options
+   *
+   * @return Search::ValueOrder The value ordering policy.
+   **/
+  Search::ValueOrder get_value_order() const;
+  /**
+   * @brief Let the colorability solver and the uniqueness check split their search tree across
+   *        the workers of a thread pool (see ParallelSearch). This is only worth it for hard
+   *        puzzles: easy ones are solved faster than the subtrees can be handed out. Boards
+   *        without a specialized kernel stay on the calling thread while there is a memory limit
+   *        (see set_memory_limit()). By default, they search on the calling thread.
+   *
+   * @param pool The workers, or NULL to search on the calling thread. It must outlive its use by
+   *             this object, and this object must not be solved by one of its workers.
+   **/
+  void set_thread_pool(ThreadPool* pool);
+  /**
+   * @brief Accessor for Sudoku::thread_pool
+   *
+   * @return ThreadPool* The workers that the searches run on, or NULL.
+   **/
+  ThreadPool* get_thread_pool() const;
+  /**
+   * @brief Limit every solver and uniqueness check (and count_solutions()) to a deadline and/or a
+   *        number of nodes, or let them be cancelled from another thread (see SearchBudget). A
+   *        solver that runs out of budget leaves the board as it was, and sets the status to
+   *        STATUS_TIMED_OUT; count_solutions() just returns what it has counted so far, so check
+   *        SearchBudget::expired() after it. The budget is not reset between solves. By default,
+   *        there is no budget.
+   *
+   * @param budget The budget, or NULL for no limits. It must outlive its use by this object.
+   **/
+  void set_budget(SearchBudget* budget);
+  /**
+   * @brief Accessor for the budget of Sudoku::search_options
+   *
+   * @return SearchBudget* The limits on the searches, or NULL.
+   **/
+  SearchBudget* get_budget() const;
+  /**
+   * @brief Share a cache of solutions with other solvers (see SolutionCache). Only solve() (and
+   *        so solve_colorability_style()) uses it: the other solvers are there to run a
+   *        particular algorithm, so they always search. By default, there is no cache.
+   *
+   * @param cache The cache, or NULL to always search. It must outlive its use by this object.
+   **/
+  void set_cache(SolutionCache* cache);
+  /**
+   * @brief Accessor for Sudoku::cache
+   *
+   * @return SolutionCache* The cache of solutions, or NULL.
+   **/
+  SolutionCache* get_cache() const;
+  /**
+   * @brief Cap the memory that the colorability solver keeps its board, masks and trail in, for
+   *        the boards that don't have a specialized kernel (i.e., anything but 4*4, 9*9, 16*16 and
+   *        25*25; those kernels keep everything in the object itself). The memory comes from an
+   *        Arena that is reset before every puzzle, so it is allocated once and then reused.
+   *
+   * The cap covers solve() (and so solve_colorability_style()), singular() and count_solutions().
+   * A parallel search keeps a copy of the state for every subtree on the heap, so while there is
+   * a limit, these boards are searched on the calling thread even if a thread pool was set. A
+   * solve or uniqueness check that would need more than the limit sets the status to
+   * STATUS_OUT_OF_MEMORY instead; count_solutions() returns 0, so check ran_out_of_memory() after
+   * it. The other solvers (bruteforce, dancing links and bitboard) don't use the arena, so they
+   * aren't capped. By default, there is no limit.
+   *
+   * @param bytes The most bytes the solver may hold, or 0 for no limit.
+   **/
+  void set_memory_limit(std::size_t bytes);
+  /**
+   * @brief Accessor for the memory limit
+   *
+   * @return std::size_t The most bytes the solver may hold, or 0 for no limit.
+   **/
+  std::size_t get_memory_limit() const;
+  /**
+   * @brief How much memory the solver is holding for the boards without a specialized kernel, and
+   *        how much of it the last puzzle used (see set_memory_limit())
+   *
+   * @return Arena::Usage The usage.
+   **/
+  Arena::Usage get_memory_usage() const;
+  /**
+   * @brief Whether the last solve, uniqueness check or count_solutions() gave up because it would
+   *        have needed more memory than the limit (see set_memory_limit())
+   *
+   * @return bool Whether the last search ran out of memory.
+   **/
+  bool ran_out_of_memory() const;
+  /**
+   * @brief Give the memory that the solver is holding for the boards without a specialized kernel
+   *        back to the heap (e.g., after a big puzzle that isn't likely to come again). It is
+   *        allocated again by the next puzzle that needs it.
+   **/
+  void release_memory();
+
+  /**
+   * @brief Whether a puzzle is loaded (see Sudoku::status)
    *
    * @return bool Whether the Sudoku board is ready to solve
    **/
   bool good() const;
   /**
-   * @brief Inverse accessor for Sudoku::status_ok
+   * @brief Inverse of good()
    *
    * @return bool Whether the Sudoku board is NOT ready to solve
    **/
   bool bad() const;
   /**
-   * @brief Implicit accessor for Sudoku::status_ok
+   * @brief Implicit version of good()
    *
    * @return bool Whether the Sudoku board is ready to solve
    **/
   operator bool() const;
 
 private:
+  /**
+   * @brief The bookkeeping of the colorability search for boards that don't have a specialized
+   *        kernel, kept around between puzzles so that its buffers can be reused (the kernels
+   *        for the common sizes don't allocate at all).
+   **/
+  struct Workspace
+  {
+    Workspace() : out_of_memory(false), search(state) {}
+    //a copy starts out empty, since its search has to point at its own state (but it has the
+    //same memory limit)
+    Workspace(Workspace const& other) : arena(other.arena.get_limit()), out_of_memory(false),
+      search(state) {}
+    Workspace& operator=(Workspace const&) { return *this; }
+
+    /**
+     * @brief The memory that the state keeps its board, masks and trail in, which is reset for
+     *        every puzzle.
+     **/
+    Arena arena;
+    /**
+     * @brief Whether the last puzzle could not be searched, because the arena hit its limit.
+     **/
+    bool out_of_memory;
+
+    /**
+     * @brief The state, which is reloaded for every puzzle.
+     **/
+    SearchState state;
+    /**
+     * @brief The search over the state, whose stack is reused for every puzzle.
+     **/
+    Search search;
+  };
+
   /**
    * @brief Helper method for parsing a puzzle from a file
    *
@@ -140,18 +561,59 @@ private:
    **/
   bool parse_puzzle(std::istream& f);
   /**
-   * @brief Helper method for parsing a single, tokenized row of a Sudoku grid
+   * @brief Helper method for parsing a puzzle from a buffer of text (see Parser::parse())
    *
-   * @param tokens The row elements.
-   * @param y The index of the row.
+   * @param text The first character of the text.
+   * @param length The number of characters in the text.
+   * @param consumed Overwritten with the number of characters the puzzle took up, if this is not
+   *                 NULL. Defaults to NULL.
    * @return bool Whether the parsing succeeded.
    **/
-  bool insert_row(std::vector<std::string>& tokens, std::size_t y);
+  bool parse_puzzle(char const* text, std::size_t length, std::size_t* consumed = 0);
+  /**
+   * @brief Helper method for validating a puzzle that was just parsed, and marking the object
+   *        as ready to solve if it is valid
+   *
+   * @param parsed Whether the parsing succeeded.
+   * @return Status STATUS_OK if the puzzle is ready to solve, STATUS_PARSE_ERROR or
+   *         STATUS_INVALID otherwise.
+   **/
+  Status finish_reading(bool parsed);
+  /**
+   * @brief Helper method for checking whether a puzzle is loaded, i.e., whether the methods that
+   *        need one can be called
+   *
+   * @return bool Whether a puzzle is loaded.
+   **/
+  bool loaded() const;
+  /**
+   * @brief Helper method for the status of a search that has finished
+   *
+   * @param solved Whether the search found what it was looking for.
+   * @return Status STATUS_OK if it did, STATUS_TIMED_OUT if it didn't because the budget ran out,
+   *         and STATUS_UNSOLVABLE otherwise.
+   **/
+  Status search_status(bool solved) const;
   /**
    * @brief Helper method for checking whether the given puzzle is solvable
    * @return bool Whether the validation succeeded
    **/
   bool validate() const;
+  /**
+   * @brief Helper method for validate(), which adds the time it takes to the stats
+   * @return bool Whether the validation succeeded
+   **/
+  bool timed_validate();
+  /**
+   * @brief Helper method that every solver calls before it searches: it starts over the counts of
+   *        the stats, and keeps a copy of the puzzle if there is a slow solve hook.
+   **/
+  void begin_search();
+  /**
+   * @brief Helper method that every solver calls after it searches: it shows the puzzle to the
+   *        slow solve hook, if there is one and the search took long enough.
+   **/
+  void end_search();
 
   /**
    * @brief Helper method for finding the next unknown (i.e., undetermined) Sudoku cell.
@@ -169,28 +631,97 @@ private:
   /**
    * @brief Helper method for solving an instance of a Sudoku puzzle using the graph 9-colorability
    *        solution method. If a 9-coloring is found, the method will return true and overwrite
-   *        cur_board with the solution (which corresponds with the graph coloring).
+   *        cur_board with the solution (which corresponds with the graph coloring). Otherwise,
+   *        cur_board is left as it was found.
    *
-   * @param cur_board The Sudoku game board.
-   * @param cur_x The last x position considered on the game board. Defaults to 0.
-   * @param cur_y The last y position considered on the game board. Defaults to 0.
+   * @param cur_grid The Sudoku game board.
+   * @param options The policies the search should follow.
+   * @param pool The workers to search on, or NULL to search on the calling thread.
+   * @param workspace The buffers to search boards without a specialized kernel in, or NULL to
+   *                  use new ones. Defaults to NULL.
+   * @param stats The counts that the search should add to, or NULL. Defaults to NULL.
    * @return bool Whether we were able to find a 9-coloring for the Sudoku board.
    **/
-  static bool color_node(Grid& cur_grid, std::size_t cur_x = 0, std::size_t cur_y = 0);
+  static bool color_node(Grid& cur_grid, Search::Options const& options, ThreadPool* pool,
+                         Workspace* workspace = 0, SearchStats* stats = 0);
   /**
    * @brief Helper method for solving an instance of a Sudoku puzzle using the bruteforce solution
-   *        method. If a solution is found, the method will return true and overwrite cur_board with
-   *        the solution.
+   *        method. The cells are filled in place. If a solution is found, the method will return
+   *        true and leave the solution on cur_grid. Otherwise, every cell that was filled by this
+   *        method is cleared again.
    *
-   * @param cur_grid ...
-   * @param cur_x ... Defaults to 0.
-   * @param cur_y ... Defaults to 0.
-   * @return bool
+   * @param cur_grid The Sudoku game board.
+   * @param stats The counts that the search should add to.
+   * @param meter The budget that the search should spend its nodes on. If it runs out, the search
+   *              gives up as if there were no solution.
+   * @param cur_x The last x position considered on the game board. Defaults to 0.
+   * @param cur_y The last y position considered on the game board. Defaults to 0.
+   * @param depth The number of cells this method has already filled in. Defaults to 0.
+   * @return bool Whether we were able to find a solution for the Sudoku board.
    **/
-  static bool bruteforce_node(Grid& cur_grid, std::size_t cur_x = 0, std::size_t cur_y = 0);
+  static bool bruteforce_node(Grid& cur_grid, SearchStats& stats, SearchBudget::Meter& meter,
+                              std::size_t cur_x = 0, std::size_t cur_y = 0,
+                              std::size_t depth = 0);
 
-  static int singular_decider(Grid& cur_grid, bool found_one = false, std::size_t cur_x = 0,
-                               std::size_t cur_y = 0);
+  /**
+   * @brief Helper method for running the colorability search on a board. Boards of size 4*4,
+   *        9*9, 16*16 and 25*25 are dispatched to search kernels that are specialized for that
+   *        size (see BasicSearchState), and every other size uses the general SearchState.
+   *
+   * @param cur_grid The Sudoku game board, which is left as it is.
+   * @param limit The number of colorings after which the search should stop.
+   * @param options The policies the search should follow.
+   * @param pool The workers to search on, or NULL to search on the calling thread.
+   * @param solution Overwritten with the last coloring, if the limit was reached and this is not
+   *                 NULL. It may be cur_grid itself.
+   * @param callback Shown every coloring that is counted, if this is not NULL (see
+   *                 count_solutions()).
+   * @param workspace The buffers to search boards without a specialized kernel in, if this is not
+   *                  NULL (and the search is serial, or the workspace has a memory limit, in
+   *                  which case it is made serial). Defaults to NULL.
+   * @param stats The counts that the search should add to, or NULL. Defaults to NULL.
+   * @return std::size_t The number of colorings that were found (at most limit).
+   **/
+  static std::size_t count_colorings(Grid const& cur_grid, std::size_t limit,
+                                     Search::Options const& options, ThreadPool* pool,
+                                     Grid* solution, SolutionCallback const* callback,
+                                     Workspace* workspace = 0, SearchStats* stats = 0);
+  /**
+   * @brief Helper method for count_colorings(), which runs the serial search of a board without a
+   *        specialized kernel in a workspace that is reused from one puzzle to the next.
+   *
+   * @param cur_grid The Sudoku game board.
+   * @param limit The number of colorings after which the search should stop.
+   * @param options The policies the search should follow.
+   * @param workspace The state and search to reuse.
+   * @param solution Overwritten with the last coloring, if the limit was reached and this is not
+   *                 NULL.
+   * @param callback Shown every coloring that is counted, if this is not NULL.
+   * @param stats The counts that the search should add to, or NULL.
+   * @return std::size_t The number of colorings that were found (at most limit).
+   **/
+  static std::size_t workspace_kernel(Grid const& cur_grid, std::size_t limit,
+                                      Search::Options const& options, Workspace& workspace,
+                                      Grid* solution, SolutionCallback const* callback,
+                                      SearchStats* stats);
+  /**
+   * @brief Helper method for count_colorings(), which runs the search with a BasicSearchState<N>.
+   *
+   * @param cur_grid The Sudoku game board. If N is not 0, it must be a N*N board.
+   * @param limit The number of colorings after which the search should stop.
+   * @param options The policies the search should follow.
+   * @param pool The workers to search on, or NULL to search on the calling thread.
+   * @param solution Overwritten with the last coloring, if the limit was reached and this is not
+   *                 NULL.
+   * @param callback Shown every coloring that is counted, if this is not NULL.
+   * @param stats The counts that the search should add to, or NULL.
+   * @return std::size_t The number of colorings that were found (at most limit).
+   **/
+  template <std::size_t N>
+  static std::size_t color_kernel(Grid const& cur_grid, std::size_t limit,
+                                  Search::Options const& options, ThreadPool* pool,
+                                  Grid* solution, SolutionCallback const* callback,
+                                  SearchStats* stats);
 
   /**
    * @brief The Sudoku board, which we are saving in memory.
@@ -198,9 +729,72 @@ private:
   Grid grid;
 
   /**
-   * @brief Whether the board is initialized (i.e., can we operate on this object?)
+   * @brief The line that parse_puzzle() is reading, kept around so its buffer can be reused.
+   **/
+  std::string line_buffer;
+  /**
+   * @brief The lines that parse_puzzle() has read so far, kept around so their buffer can be
+   *        reused.
+   **/
+  std::string text_buffer;
+  /**
+   * @brief Why the last read failed, and where.
+   **/
+  Parser::Error parse_error;
+  /**
+   * @brief The format that the last puzzle was read in.
+   **/
+  Parser::Format format;
+
+  /**
+   * @brief The result of the last load or solve (i.e., can we operate on this object?)
+   **/
+  Status status;
+
+  /**
+   * @brief The policies of the colorability solver and the uniqueness check.
+   **/
+  Search::Options search_options;
+  /**
+   * @brief The workers that the colorability solver and the uniqueness check run on, if any.
+   **/
+  ThreadPool* thread_pool;
+  /**
+   * @brief The buffers of the colorability solver, which are reused for every puzzle (including
+   *        by count_solutions(), which otherwise leaves the object as it is).
+   **/
+  mutable Workspace workspace;
+  /**
+   * @brief What the last solver (or uniqueness check) did, and how long it took to read the
+   *        puzzle.
+   **/
+  SearchStats stats;
+  /**
+   * @brief The shortest search that is shown to Sudoku::slow_solve_hook, in seconds.
+   **/
+  double slow_solve_threshold;
+  /**
+   * @brief The hook that is shown the slow puzzles, if any.
+   **/
+  SlowSolveHook slow_solve_hook;
+  /**
+   * @brief A copy of the puzzle that is being solved, for the slow solve hook (it is only made if
+   *        there is a hook, and its buffer is reused).
+   **/
+  Grid puzzle_buffer;
+  /**
+   * @brief The cache that solve() looks the solutions up in, if any.
+   **/
+  SolutionCache* cache;
+  /**
+   * @brief The canonical form of the puzzle that solve() is looking up.
+   **/
+  CanonicalForm canonical;
+  /**
+   * @brief The solution of the canonical form, on its way into or out of the cache (its buffer
+   *        is reused).
    **/
-  bool status_ok;
+  Grid cache_buffer;
 };
 
 #endif // SUDOKU_H
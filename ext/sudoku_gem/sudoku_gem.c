@@ -1,30 +1,1093 @@
 #include <ruby.h>
+#include <ruby/thread.h>
+#include <algorithm>
 #include <string>
+#include <vector>
+#include "batch.h"
+#include "generator.h"
+#include "serializer.h"
 #include "sudoku.h"
 
 typedef VALUE (* ruby_method)(...);
 
+//raised when a puzzle runs out of its time or node limit
+VALUE sudoku_gem_timeout_error = Qnil;
+
+//the solutions that every solve in the process shares, which is off until it is given a capacity
+SolutionCache* sudoku_gem_cache = NULL;
+
+//the most memory that the solver of every puzzle may hold (0 for no limit)
+std::size_t sudoku_gem_memory_limit = 0;
+
+//the limits that the timeout: and max_nodes: keywords put on a single solve (0 for none)
+struct sudoku_gem_limits
+{
+  double time_limit;
+  std::size_t node_limit;
+};
+
+//everything a batch needs once the GVL has been released, since it can't touch ruby objects
+struct sudoku_gem_batch
+{
+  std::vector<std::string> const* puzzles;
+  std::vector<std::string>* solutions;
+  std::size_t threads;
+  Parser::Format format;
+  Parser::Format input;
+  sudoku_gem_limits limits;
+  SearchBudget* overall;
+  SolutionCache* cache;
+  std::size_t memory_limit;
+};
+
+extern "C"
+void* sudoku_gem_batch_without_gvl(void* data)
+{
+  sudoku_gem_batch* batch = (sudoku_gem_batch*)data;
+  const double time_limit = batch->limits.time_limit;
+  const std::size_t node_limit = batch->limits.node_limit;
+
+  //a single thread doesn't need a pool
+  if (batch->threads <= 1 || batch->puzzles->size() <= 1)
+  {
+    BatchSolver solver(batch->format);
+    solver.set_limits(time_limit, node_limit, batch->overall);
+    solver.set_cache(batch->cache);
+    solver.set_memory_limit(batch->memory_limit);
+    solver.set_input_format(batch->input);
+    solver.solve_batch(batch->puzzles->data(), batch->puzzles->size(), *batch->solutions);
+  }
+  else
+  {
+    ThreadPool pool(batch->threads);
+    ParallelBatchSolver solver(pool, batch->format);
+    solver.set_limits(time_limit, node_limit, batch->overall);
+    solver.set_cache(batch->cache);
+    solver.set_memory_limit(batch->memory_limit);
+    solver.set_input_format(batch->input);
+    solver.solve_batch(batch->puzzles->data(), batch->puzzles->size(), *batch->solutions);
+  }
+
+  return NULL;
+}
+
+//everything a solve needs once the GVL has been released
+struct sudoku_gem_single_solve
+{
+  Sudoku* sudoku;
+  std::size_t threads;
+};
+
 extern "C"
-VALUE sudoku_gem_solve(VALUE self, VALUE rb_puzzle)
+void* sudoku_gem_single_solve_without_gvl(void* data)
 {
+  sudoku_gem_single_solve* single = (sudoku_gem_single_solve*)data;
+
+  if (single->threads <= 1)
+  {
+    single->sudoku->solve();
+    return NULL;
+  }
+
+  ThreadPool pool(single->threads);
+
+  //split the search tree of the one puzzle across every worker
+  single->sudoku->set_thread_pool(&pool);
+  single->sudoku->solve();
+  single->sudoku->set_thread_pool(NULL);
+
+  return NULL;
+}
+
+//everything a count needs once the GVL has been released
+struct sudoku_gem_single_count
+{
+  Sudoku* sudoku;
+  std::size_t threads;
+  std::size_t limit;
+  std::size_t found;
+};
+
+extern "C"
+void* sudoku_gem_single_count_without_gvl(void* data)
+{
+  sudoku_gem_single_count* single = (sudoku_gem_single_count*)data;
+
+  if (single->threads <= 1)
+  {
+    single->found = single->sudoku->count_solutions(single->limit);
+    return NULL;
+  }
+
+  ThreadPool pool(single->threads);
+
+  //count the subtrees of the one puzzle on every worker
+  single->sudoku->set_thread_pool(&pool);
+  single->found = single->sudoku->count_solutions(single->limit);
+  single->sudoku->set_thread_pool(NULL);
+
+  return NULL;
+}
+
+//everything a generator needs once the GVL has been released
+struct sudoku_gem_generate
+{
+  std::size_t n;
+  std::size_t target_clues;
+  std::uint64_t seed;
+  std::size_t count;
+  std::size_t threads;
+  SearchBudget* budget;
+  std::vector<Generator::Puzzle>* puzzles;
+  std::size_t made;
+};
+
+extern "C"
+void* sudoku_gem_generate_without_gvl(void* data)
+{
+  sudoku_gem_generate* batch = (sudoku_gem_generate*)data;
+
+  //a single thread doesn't need a pool
+  if (batch->threads <= 1 || batch->count <= 1)
+  {
+    Generator generator;
+    generator.set_budget(batch->budget);
+    batch->made = generator.generate_batch(batch->n, batch->target_clues, batch->seed,
+                                           batch->count, *batch->puzzles);
+  }
+  else
+  {
+    ThreadPool pool(batch->threads);
+    ParallelGenerator generator(pool);
+    generator.set_budget(batch->budget);
+    batch->made = generator.generate_batch(batch->n, batch->target_clues, batch->seed,
+                                           batch->count, *batch->puzzles);
+  }
+
+  return NULL;
+}
+
+//the unblocking function: ruby wants the thread back (e.g., for an interrupt), so stop searching
+extern "C"
+void sudoku_gem_cancel(void* data)
+{
+  ((SearchBudget*)data)->cancel();
+}
+
+//the cache that the solves should use, if it has been turned on
+SolutionCache* sudoku_gem_active_cache()
+{
+  return (sudoku_gem_cache->get_capacity() > 0) ? sudoku_gem_cache : NULL;
+}
+
+std::size_t sudoku_gem_thread_count(VALUE rb_threads, std::size_t fallback)
+{
+  if (NIL_P(rb_threads))
+  {
+    return fallback;
+  }
+
+  long requested = NUM2LONG(rb_threads);
+
+  if (requested < 1)
+  {
+    rb_raise(rb_eArgError, "thread count must be at least 1");
+  }
+
+  return (std::size_t)requested;
+}
+
+//read the timeout: (in seconds) and max_nodes: keywords, if there are any
+sudoku_gem_limits sudoku_gem_read_limits(VALUE rb_options)
+{
+  sudoku_gem_limits limits = { 0, 0 };
+
+  if (NIL_P(rb_options))
+  {
+    return limits;
+  }
+
+  ID keys[2] = { rb_intern("timeout"), rb_intern("max_nodes") };
+  VALUE values[2];
+  rb_get_kwargs(rb_options, keys, 0, 2, values);
+
+  if (values[0] != Qundef && !NIL_P(values[0]))
+  {
+    limits.time_limit = NUM2DBL(values[0]);
+
+    if (!(limits.time_limit > 0))
+    {
+      rb_raise(rb_eArgError, "timeout must be positive");
+    }
+  }
+
+  if (values[1] != Qundef && !NIL_P(values[1]))
+  {
+    long nodes = NUM2LONG(values[1]);
+
+    if (nodes < 1)
+    {
+      rb_raise(rb_eArgError, "max_nodes must be at least 1");
+    }
+
+    limits.node_limit = (std::size_t)nodes;
+  }
+
+  return limits;
+}
+
+//raise whatever interrupted the solve, or a timeout if it ran out of budget (this is called after
+//the solver is gone, since raising skips the destructors of everything on the stack)
+void sudoku_gem_check_status(Sudoku::Status status)
+{
+  rb_thread_check_ints();
+
+  if (status == Sudoku::STATUS_TIMED_OUT)
+  {
+    rb_raise(sudoku_gem_timeout_error, "the puzzle ran out of time or nodes");
+  }
+
+  if (status == Sudoku::STATUS_OUT_OF_MEMORY)
+  {
+    rb_raise(rb_eNoMemError, "the puzzle needs more memory than the memory limit allows");
+  }
+}
+
+Parser::Format sudoku_gem_format(VALUE rb_compact)
+{
+  return RTEST(rb_compact) ? Parser::FORMAT_COMPACT : Parser::FORMAT_TEXT;
+}
+
+VALUE sudoku_gem_solution_string(Sudoku const& sudoku, Parser::Format format)
+{
+  //write the solution straight into the ruby string, instead of copying it out of a std::string
+  VALUE rb_solution = rb_str_buf_new(sudoku.serialized_size(format));
+  rb_str_set_len(rb_solution, sudoku.serialize(RSTRING_PTR(rb_solution), format));
+  return rb_solution;
+}
+
+Sudoku::Status sudoku_gem_solve_puzzle(Sudoku& sudoku, std::size_t threads,
+                                       sudoku_gem_limits const& limits)
+{
+  //even a puzzle without limits can be interrupted, so it always gets a budget
+  SearchBudget budget;
+  budget.set_time_limit(limits.time_limit);
+  budget.set_node_limit(limits.node_limit);
+  sudoku.set_budget(&budget);
+  sudoku.set_cache(sudoku_gem_active_cache());
+  sudoku.set_memory_limit(sudoku_gem_memory_limit);
+
+  //let other ruby threads run while we are searching
+  sudoku_gem_single_solve single = { &sudoku, threads };
+  rb_thread_call_without_gvl(&sudoku_gem_single_solve_without_gvl, &single, &sudoku_gem_cancel,
+                             &budget);
+
+  sudoku.set_budget(NULL);
+  sudoku.set_cache(NULL);
+  return sudoku.get_status();
+}
+
+//turn a ruby cell into the value of a cell (nil and 0 are unknown), or -1 if it can't be one
+//(this raises if the cell isn't an integer, so it must run before any c++ object is alive)
+int sudoku_gem_cell_value(VALUE rb_cell)
+{
+  if (NIL_P(rb_cell))
+  {
+    return 0;
+  }
+
+  if (!RB_INTEGER_TYPE_P(rb_cell))
+  {
+    rb_raise(rb_eTypeError, "cells must be integers or nil");
+  }
+
+  //a bignum is out of range anyway, and converting it could raise
+  if (!FIXNUM_P(rb_cell))
+  {
+    return -1;
+  }
+
+  long value = FIX2LONG(rb_cell);
+  return (value < 0 || value > 64) ? -1 : (int)value;
+}
+
+//the cell of an array of n rows of n cells, or of a flat array of n*n cells
+VALUE sudoku_gem_array_cell(VALUE rb_puzzle, bool nested, long n, long x, long y)
+{
+  return nested ? rb_ary_entry(rb_ary_entry(rb_puzzle, y), x) : rb_ary_entry(rb_puzzle, y * n + x);
+}
+
+//check every row and cell of an array before anything is copied out of it, since raising skips the
+//destructors of everything on the stack (this returns the side length, or 0 if it isn't a board)
+long sudoku_gem_check_array(VALUE rb_puzzle, bool& nested)
+{
+  long length = RARRAY_LEN(rb_puzzle);
+  long n = 0;
+
+  nested = (length > 0 && RB_TYPE_P(rb_ary_entry(rb_puzzle, 0), T_ARRAY));
+
+  if (nested)
+  {
+    n = length;
+  }
+  else
+  {
+    while (n * n < length)
+    {
+      n++;
+    }
+  }
+
+  //check the size before looking at the cells, so a bogus array can't keep us busy for long
+  if ((!nested && n * n != length) || !Parser::is_good_size((std::size_t)n))
+  {
+    return 0;
+  }
+
+  bool good = true;
+
+  for (long y = 0; y < n; y++)
+  {
+    if (nested)
+    {
+      VALUE rb_row = rb_ary_entry(rb_puzzle, y);
+      Check_Type(rb_row, T_ARRAY);
+
+      if (RARRAY_LEN(rb_row) != n)
+      {
+        return 0;
+      }
+    }
+
+    //every cell is looked at even after a bad one, so a cell of the wrong type always raises
+    for (long x = 0; x < n; x++)
+    {
+      if (sudoku_gem_cell_value(sudoku_gem_array_cell(rb_puzzle, nested, n, x, y)) < 0)
+      {
+        good = false;
+      }
+    }
+  }
+
+  return good ? n : 0;
+}
+
+//fill in a grid from an array that sudoku_gem_check_array() has already accepted (nothing here
+//can raise)
+void sudoku_gem_read_array(VALUE rb_puzzle, bool nested, long n, Grid& grid)
+{
+  grid.reset((std::size_t)n);
+  std::uint8_t* cells = grid.data();
+
+  for (long y = 0; y < n; y++)
+  {
+    for (long x = 0; x < n; x++)
+    {
+      VALUE rb_cell = sudoku_gem_array_cell(rb_puzzle, nested, n, x, y);
+      cells[y * n + x] = NIL_P(rb_cell) ? 0 : (std::uint8_t)FIX2LONG(rb_cell);
+    }
+  }
+}
+
+//build n arrays of n integers straight from the cells, with 0 for the unknowns
+VALUE sudoku_gem_solution_array(Grid const& grid)
+{
+  std::size_t n = grid.n();
+  std::uint8_t const* cells = grid.data();
+  VALUE rb_rows = rb_ary_new2(n);
+
+  for (std::size_t y = 0; y < n; y++)
+  {
+    VALUE rb_row = rb_ary_new2(n);
+
+    for (std::size_t x = 0; x < n; x++)
+    {
+      rb_ary_push(rb_row, INT2FIX(cells[y * n + x]));
+    }
+
+    rb_ary_push(rb_rows, rb_row);
+  }
+
+  return rb_rows;
+}
+
+//describe what a solver did, with the times in seconds
+VALUE sudoku_gem_stats_hash(SearchStats const& stats)
+{
+  VALUE rb_stats = rb_hash_new();
+  rb_hash_aset(rb_stats, ID2SYM(rb_intern("nodes")), SIZET2NUM(stats.nodes));
+  rb_hash_aset(rb_stats, ID2SYM(rb_intern("backtracks")), SIZET2NUM(stats.backtracks));
+  rb_hash_aset(rb_stats, ID2SYM(rb_intern("propagations")), SIZET2NUM(stats.propagations));
+  rb_hash_aset(rb_stats, ID2SYM(rb_intern("max_depth")), SIZET2NUM(stats.max_depth));
+  rb_hash_aset(rb_stats, ID2SYM(rb_intern("parse_time")), DBL2NUM(stats.parse_time));
+  rb_hash_aset(rb_stats, ID2SYM(rb_intern("validate_time")), DBL2NUM(stats.validate_time));
+  rb_hash_aset(rb_stats, ID2SYM(rb_intern("search_time")), DBL2NUM(stats.search_time));
+  return rb_stats;
+}
+
+extern "C"
+VALUE sudoku_gem_solve(int argc, VALUE* argv, VALUE self)
+{
+  VALUE rb_puzzle, rb_threads, rb_compact, rb_options;
+  rb_scan_args(argc, argv, "12:", &rb_puzzle, &rb_threads, &rb_compact, &rb_options);
+
+  //a single puzzle is solved on the calling thread unless we were told otherwise
+  std::size_t threads = sudoku_gem_thread_count(rb_threads, 1);
+  sudoku_gem_limits limits = sudoku_gem_read_limits(rb_options);
+  StringValue(rb_puzzle);
+
+  VALUE rb_solution = Qnil;
+  Sudoku::Status status;
+
+  {
+    Sudoku sudoku;
+
+    if (!sudoku.read_puzzle_from_buffer(RSTRING_PTR(rb_puzzle), RSTRING_LEN(rb_puzzle)))
+    {
+      return Qnil;
+    }
+
+    status = sudoku_gem_solve_puzzle(sudoku, threads, limits);
+
+    //a puzzle that has no solution is nil, like it is for every other way of solving it
+    if (status == Sudoku::STATUS_OK)
+    {
+      rb_solution = sudoku_gem_solution_string(sudoku, sudoku_gem_format(rb_compact));
+    }
+  }
+
+  sudoku_gem_check_status(status);
+  return rb_solution;
+}
+
+extern "C"
+VALUE sudoku_gem_solve_with_stats(int argc, VALUE* argv, VALUE self)
+{
+  VALUE rb_puzzle, rb_threads, rb_compact, rb_options;
+  rb_scan_args(argc, argv, "12:", &rb_puzzle, &rb_threads, &rb_compact, &rb_options);
+
+  //a single puzzle is solved on the calling thread unless we were told otherwise
+  std::size_t threads = sudoku_gem_thread_count(rb_threads, 1);
+  sudoku_gem_limits limits = sudoku_gem_read_limits(rb_options);
+  StringValue(rb_puzzle);
+
+  VALUE rb_solution = Qnil, rb_stats;
+
+  {
+    Sudoku sudoku;
+
+    if (!sudoku.read_puzzle_from_buffer(RSTRING_PTR(rb_puzzle), RSTRING_LEN(rb_puzzle)))
+    {
+      return Qnil;
+    }
+
+    Sudoku::Status status = sudoku_gem_solve_puzzle(sudoku, threads, limits);
+
+    //an unsolved puzzle still has stats, which are the interesting part (so a timeout isn't raised)
+    if (status == Sudoku::STATUS_OK)
+    {
+      rb_solution = sudoku_gem_solution_string(sudoku, sudoku_gem_format(rb_compact));
+    }
+
+    rb_stats = sudoku_gem_stats_hash(sudoku.get_stats());
+    rb_hash_aset(rb_stats, ID2SYM(rb_intern("timed_out")),
+                 (status == Sudoku::STATUS_TIMED_OUT) ? Qtrue : Qfalse);
+    rb_hash_aset(rb_stats, ID2SYM(rb_intern("out_of_memory")),
+                 (status == Sudoku::STATUS_OUT_OF_MEMORY) ? Qtrue : Qfalse);
+    rb_hash_aset(rb_stats, ID2SYM(rb_intern("memory_used")),
+                 SIZET2NUM(sudoku.get_memory_usage().used));
+  }
+
+  sudoku_gem_check_status(Sudoku::STATUS_OK);
+  return rb_assoc_new(rb_solution, rb_stats);
+}
+
+extern "C"
+VALUE sudoku_gem_solve_grid(int argc, VALUE* argv, VALUE self)
+{
+  VALUE rb_puzzle, rb_threads, rb_options;
+  rb_scan_args(argc, argv, "11:", &rb_puzzle, &rb_threads, &rb_options);
+
+  //a single puzzle is solved on the calling thread unless we were told otherwise
+  std::size_t threads = sudoku_gem_thread_count(rb_threads, 1);
+  sudoku_gem_limits limits = sudoku_gem_read_limits(rb_options);
+
+  //every type check has to happen up here, while nothing on the stack owns any memory
+  bool nested = false;
+  long n = 0;
+
+  if (RB_TYPE_P(rb_puzzle, T_ARRAY))
+  {
+    n = sudoku_gem_check_array(rb_puzzle, nested);
+
+    if (n == 0)
+    {
+      return Qnil;
+    }
+  }
+  else
+  {
+    StringValue(rb_puzzle);
+  }
+
+  VALUE rb_solution = Qnil;
+  Sudoku::Status status;
+
+  {
+    Sudoku sudoku;
+
+    if (RB_TYPE_P(rb_puzzle, T_ARRAY))
+    {
+      Grid grid(0);
+      sudoku_gem_read_array(rb_puzzle, nested, n, grid);
+
+      if (!sudoku.read_puzzle_from_grid(grid))
+      {
+        return Qnil;
+      }
+    }
+    else if (!sudoku.read_puzzle_from_buffer(RSTRING_PTR(rb_puzzle), RSTRING_LEN(rb_puzzle)))
+    {
+      return Qnil;
+    }
+
+    status = sudoku_gem_solve_puzzle(sudoku, threads, limits);
+
+    //a puzzle that has no solution is nil, rather than the board it was left as
+    if (status == Sudoku::STATUS_OK)
+    {
+      rb_solution = sudoku_gem_solution_array(sudoku.get_grid());
+    }
+  }
+
+  sudoku_gem_check_status(status);
+  return rb_solution;
+}
+
+extern "C"
+VALUE sudoku_gem_count_solutions(int argc, VALUE* argv, VALUE self)
+{
+  VALUE rb_puzzle, rb_limit, rb_threads, rb_options;
+  rb_scan_args(argc, argv, "21:", &rb_puzzle, &rb_limit, &rb_threads, &rb_options);
+
+  long limit = NUM2LONG(rb_limit);
+
+  if (limit < 0)
+  {
+    rb_raise(rb_eArgError, "limit must not be negative");
+  }
+
+  //a single puzzle is counted on the calling thread unless we were told otherwise
+  std::size_t threads = sudoku_gem_thread_count(rb_threads, 1);
+  sudoku_gem_limits limits = sudoku_gem_read_limits(rb_options);
+  StringValue(rb_puzzle);
+
+  std::size_t found;
+  Sudoku::Status status = Sudoku::STATUS_OK;
+
+  {
+    Sudoku sudoku;
+
+    if (!sudoku.read_puzzle_from_buffer(RSTRING_PTR(rb_puzzle), RSTRING_LEN(rb_puzzle)))
+    {
+      return Qnil;
+    }
+
+    //even a count without limits can be interrupted, so it always gets a budget
+    SearchBudget budget;
+    budget.set_time_limit(limits.time_limit);
+    budget.set_node_limit(limits.node_limit);
+    sudoku.set_budget(&budget);
+    sudoku.set_memory_limit(sudoku_gem_memory_limit);
+
+    //let other ruby threads run while we are counting
+    sudoku_gem_single_count single = { &sudoku, threads, (std::size_t)limit, 0 };
+    rb_thread_call_without_gvl(&sudoku_gem_single_count_without_gvl, &single, &sudoku_gem_cancel,
+                               &budget);
+    found = single.found;
+
+    //a count that reached the limit is exact, even if the budget ran out right after
+    if (found < (std::size_t)limit && budget.expired())
+    {
+      status = Sudoku::STATUS_TIMED_OUT;
+    }
+    else if (sudoku.ran_out_of_memory())
+    {
+      status = Sudoku::STATUS_OUT_OF_MEMORY;
+    }
+  }
+
+  sudoku_gem_check_status(status);
+  return SIZET2NUM(found);
+}
+
+//solve an array of puzzles in one native call, into their solutions in the given format (or, if
+//grids is set, into the arrays that solve_grid would make of them)
+VALUE sudoku_gem_batch_solutions(VALUE rb_puzzles, VALUE rb_threads, VALUE rb_options,
+                                 Parser::Format format, bool grids)
+{
+  Check_Type(rb_puzzles, T_ARRAY);
+
+  //use every core unless we were told otherwise
+  std::size_t threads = sudoku_gem_thread_count(rb_threads, ThreadPool::default_size());
+  sudoku_gem_limits limits = sudoku_gem_read_limits(rb_options);
+
+  //convert every puzzle before we start copying, so nothing is raised while we own the copies (the
+  //strings go into a copy of the array, which a to_str can't shrink out from under us)
+  rb_puzzles = rb_ary_dup(rb_puzzles);
+  long count = RARRAY_LEN(rb_puzzles);
+
+  for (long k = 0; k < count; k++)
+  {
+    VALUE rb_puzzle = rb_ary_entry(rb_puzzles, k);
+    rb_ary_store(rb_puzzles, k, StringValue(rb_puzzle));
+  }
+
+  VALUE rb_solutions = rb_ary_new2(count);
+
+  {
+    //copy all of the puzzles out of ruby first, so the solver never has to call back into ruby
+    std::vector<std::string> cpp_puzzles(count);
+
+    for (long k = 0; k < count; k++)
+    {
+      VALUE rb_puzzle = rb_ary_entry(rb_puzzles, k);
+      cpp_puzzles[k].assign(RSTRING_PTR(rb_puzzle), RSTRING_LEN(rb_puzzle));
+    }
+
+    //let other ruby threads run while we are solving (an interrupt cancels the whole batch)
+    std::vector<std::string> cpp_solutions;
+    SearchBudget overall;
+    //grids are built from packed solutions, which take next to nothing to read back in
+    sudoku_gem_batch batch = { &cpp_puzzles, &cpp_solutions, threads,
+                               grids ? Parser::FORMAT_PACKED : format, Parser::FORMAT_TEXT, limits,
+                               &overall, sudoku_gem_active_cache(), sudoku_gem_memory_limit };
+    rb_thread_call_without_gvl(&sudoku_gem_batch_without_gvl, &batch, &sudoku_gem_cancel,
+                               &overall);
+
+    //a puzzle that has no solution (or ran out of time) is nil, just like one that couldn't be read
+    Grid grid(0);
+    Parser::Error error;
+
+    for (long k = 0; k < count; k++)
+    {
+      std::string const& cpp_solution = cpp_solutions[k];
+
+      if (cpp_solution.empty())
+      {
+        rb_ary_push(rb_solutions, Qnil);
+      }
+      else if (grids)
+      {
+        Parser::parse_packed(cpp_solution.data(), cpp_solution.length(), grid, error);
+        rb_ary_push(rb_solutions, sudoku_gem_solution_array(grid));
+      }
+      else
+      {
+        rb_ary_push(rb_solutions, rb_str_new(cpp_solution.c_str(), cpp_solution.length()));
+      }
+    }
+  }
+
+  sudoku_gem_check_status(Sudoku::STATUS_OK);
+  return rb_solutions;
+}
+
+extern "C"
+VALUE sudoku_gem_solve_batch(int argc, VALUE* argv, VALUE self)
+{
+  VALUE rb_puzzles, rb_threads, rb_compact, rb_options;
+  rb_scan_args(argc, argv, "12:", &rb_puzzles, &rb_threads, &rb_compact, &rb_options);
+
+  return sudoku_gem_batch_solutions(rb_puzzles, rb_threads, rb_options,
+                                    sudoku_gem_format(rb_compact), false);
+}
+
+//solve an array of puzzles into arrays of integers, like solve_grid does for a single one
+extern "C"
+VALUE sudoku_gem_solve_grid_batch(int argc, VALUE* argv, VALUE self)
+{
+  VALUE rb_puzzles, rb_threads, rb_options;
+  rb_scan_args(argc, argv, "11:", &rb_puzzles, &rb_threads, &rb_options);
+
+  return sudoku_gem_batch_solutions(rb_puzzles, rb_threads, rb_options, Parser::FORMAT_TEXT, true);
+}
+
+//the number of bytes that a board of a packed batch takes up, by looking at its header (a 0 byte
+//is what a batch of solutions has in place of a puzzle that couldn't be solved), or 0 if it's bad
+std::size_t sudoku_gem_packed_entry_size(char header)
+{
+  return (header == 0) ? 1 : Parser::packed_size((std::uint8_t)header);
+}
+
+//solve a packed board into a packed solution, or a packed batch into a packed batch
+extern "C"
+VALUE sudoku_gem_solve_packed(int argc, VALUE* argv, VALUE self)
+{
+  VALUE rb_data, rb_threads, rb_options;
+  rb_scan_args(argc, argv, "11:", &rb_data, &rb_threads, &rb_options);
+
+  sudoku_gem_limits limits = sudoku_gem_read_limits(rb_options);
+  StringValue(rb_data);
+
+  char const* data = RSTRING_PTR(rb_data);
+  const std::size_t length = RSTRING_LEN(rb_data);
+  //a single board is read straight out of the ruby string, and solved on the calling thread
+  if (length == 0 || data[0] != 0)
+  {
+    std::size_t threads = sudoku_gem_thread_count(rb_threads, 1);
+    VALUE rb_solution = Qnil;
+    Sudoku::Status status;
+
+    {
+      Sudoku sudoku;
+
+      if (sudoku.load_packed(data, length) != Sudoku::STATUS_OK)
+      {
+        return Qnil;
+      }
+
+      status = sudoku_gem_solve_puzzle(sudoku, threads, limits);
+
+      //a board that has no solution is nil, since packing it would make it look like one
+      if (status == Sudoku::STATUS_OK)
+      {
+        rb_solution = sudoku_gem_solution_string(sudoku, Parser::FORMAT_PACKED);
+      }
+    }
+
+    sudoku_gem_check_status(status);
+    return rb_solution;
+  }
+
+  //a batch uses every core unless we were told otherwise
+  std::size_t threads = sudoku_gem_thread_count(rb_threads, ThreadPool::default_size());
+  Parser::Error error;
+  std::size_t count, offset;
+
+  if (!Parser::parse_packed_header(data, length, count, error, &offset))
+  {
+    rb_raise(rb_eArgError, "%s", error.message);
+  }
+
+  //find every board before we start copying, so nothing is raised while we own the copies
+  for (std::size_t k = 0, start = offset; k < count; k++)
+  {
+    if (start >= length)
+    {
+      rb_raise(rb_eArgError, "the batch is truncated");
+    }
+
+    const std::size_t size = sudoku_gem_packed_entry_size(data[start]);
+
+    if (size == 0)
+    {
+      rb_raise(rb_eArgError, "board %lu of the batch has a bad side length", (unsigned long)k);
+    }
+
+    if (size > length - start)
+    {
+      rb_raise(rb_eArgError, "the batch is truncated");
+    }
+
+    start += size;
+  }
+
+  VALUE rb_solutions;
+
+  {
+    std::vector<std::string> cpp_puzzles(count);
+
+    for (std::size_t k = 0, start = offset; k < count; k++)
+    {
+      const std::size_t size = sudoku_gem_packed_entry_size(data[start]);
+      cpp_puzzles[k].assign(data + start, size);
+      start += size;
+    }
+
+    //let other ruby threads run while we are solving (an interrupt cancels the whole batch)
+    std::vector<std::string> cpp_solutions;
+    SearchBudget overall;
+    sudoku_gem_batch batch = { &cpp_puzzles, &cpp_solutions, threads, Parser::FORMAT_PACKED,
+                               Parser::FORMAT_PACKED, limits, &overall, sudoku_gem_active_cache(),
+                               sudoku_gem_memory_limit };
+    rb_thread_call_without_gvl(&sudoku_gem_batch_without_gvl, &batch, &sudoku_gem_cancel,
+                               &overall);
+
+    //a puzzle that couldn't be read or solved (or ran out of time) is a single 0 byte in the batch
+    std::size_t total = Parser::packed_header_size;
+
+    for (std::size_t k = 0; k < count; k++)
+    {
+      total += cpp_solutions[k].empty() ? 1 : cpp_solutions[k].length();
+    }
+
+    rb_solutions = rb_str_buf_new(total);
+    char* out = RSTRING_PTR(rb_solutions);
+    char* cur = out + Serializer::write_packed_header(count, out);
+
+    for (std::size_t k = 0; k < count; k++)
+    {
+      std::string const& cpp_solution = cpp_solutions[k];
+
+      if (cpp_solution.empty())
+      {
+        *cur++ = 0;
+      }
+      else
+      {
+        cur = std::copy(cpp_solution.begin(), cpp_solution.end(), cur);
+      }
+    }
+
+    rb_str_set_len(rb_solutions, cur - out);
+  }
+
+  sudoku_gem_check_status(Sudoku::STATUS_OK);
+  return rb_solutions;
+}
+
+//write a puzzle in the text or compact format as a packed board
+extern "C"
+VALUE sudoku_gem_pack(VALUE self, VALUE rb_puzzle)
+{
+  StringValue(rb_puzzle);
+  Sudoku sudoku;
+
+  if (sudoku.load(RSTRING_PTR(rb_puzzle), RSTRING_LEN(rb_puzzle)) != Sudoku::STATUS_OK)
+  {
+    return Qnil;
+  }
+
+  return sudoku_gem_solution_string(sudoku, Parser::FORMAT_PACKED);
+}
+
+//write a packed board in the text format (or the compact format, if we were asked to)
+extern "C"
+VALUE sudoku_gem_unpack(int argc, VALUE* argv, VALUE self)
+{
+  VALUE rb_data, rb_compact;
+  rb_scan_args(argc, argv, "11", &rb_data, &rb_compact);
+  StringValue(rb_data);
   Sudoku sudoku;
-  std::string cpp_puzzle = StringValueCStr(rb_puzzle);
 
-  if (!sudoku.read_puzzle_from_string(cpp_puzzle))
+  if (sudoku.load_packed(RSTRING_PTR(rb_data), RSTRING_LEN(rb_data)) != Sudoku::STATUS_OK)
   {
     return Qnil;
   }
 
-  sudoku.solve_colorability_style();
+  return sudoku_gem_solution_string(sudoku, sudoku_gem_format(rb_compact));
+}
+
+//describe a generated puzzle, with the boards written in the given format
+VALUE sudoku_gem_puzzle_hash(Generator::Puzzle const& puzzle, Parser::Format format)
+{
+  static char const* const difficulties[] = { "easy", "medium", "hard", "expert" };
+  std::string text;
+  VALUE rb_puzzle = rb_hash_new();
+
+  Serializer::append(puzzle.puzzle, format, text);
+  rb_hash_aset(rb_puzzle, ID2SYM(rb_intern("puzzle")), rb_str_new(text.data(), text.length()));
+  text.clear();
+  Serializer::append(puzzle.solution, format, text);
+  rb_hash_aset(rb_puzzle, ID2SYM(rb_intern("solution")), rb_str_new(text.data(), text.length()));
+  rb_hash_aset(rb_puzzle, ID2SYM(rb_intern("clues")), SIZET2NUM(puzzle.clues));
+  rb_hash_aset(rb_puzzle, ID2SYM(rb_intern("difficulty")),
+               ID2SYM(rb_intern(difficulties[puzzle.difficulty])));
+  rb_hash_aset(rb_puzzle, ID2SYM(rb_intern("score")), DBL2NUM(puzzle.score));
+  rb_hash_aset(rb_puzzle, ID2SYM(rb_intern("stats")), sudoku_gem_stats_hash(puzzle.stats));
+  return rb_puzzle;
+}
+
+extern "C"
+VALUE sudoku_gem_generate_puzzles(int argc, VALUE* argv, VALUE self)
+{
+  VALUE rb_size, rb_count, rb_threads, rb_options;
+  rb_scan_args(argc, argv, "03:", &rb_size, &rb_count, &rb_threads, &rb_options);
+
+  long n = NIL_P(rb_size) ? 9 : NUM2LONG(rb_size);
+  long count = NIL_P(rb_count) ? 1 : NUM2LONG(rb_count);
+
+  if (n < 1 || !Parser::is_good_size((std::size_t)n))
+  {
+    rb_raise(rb_eArgError, "size must be a perfect square, up to 64");
+  }
+
+  if (count < 0)
+  {
+    rb_raise(rb_eArgError, "count must not be negative");
+  }
+
+  //a batch uses every core unless we were told otherwise
+  std::size_t threads = sudoku_gem_thread_count(rb_threads, ThreadPool::default_size());
+
+  //read the clues:, seed:, compact: and timeout: (in seconds, for the whole batch) keywords
+  std::size_t target_clues = 0;
+  std::uint64_t seed = std::random_device()();
+  Parser::Format format = Parser::FORMAT_TEXT;
+  double time_limit = 0;
+
+  if (!NIL_P(rb_options))
+  {
+    ID keys[4] = { rb_intern("clues"), rb_intern("seed"), rb_intern("compact"),
+                   rb_intern("timeout") };
+    VALUE values[4];
+    rb_get_kwargs(rb_options, keys, 0, 4, values);
+
+    if (values[0] != Qundef && !NIL_P(values[0]))
+    {
+      long clues = NUM2LONG(values[0]);
+
+      if (clues < 0)
+      {
+        rb_raise(rb_eArgError, "clues must not be negative");
+      }
+
+      target_clues = (std::size_t)clues;
+    }
+
+    if (values[1] != Qundef && !NIL_P(values[1]))
+    {
+      seed = NUM2ULL(values[1]);
+    }
+
+    if (values[2] != Qundef)
+    {
+      format = sudoku_gem_format(values[2]);
+    }
+
+    if (values[3] != Qundef && !NIL_P(values[3]))
+    {
+      time_limit = NUM2DBL(values[3]);
+
+      if (!(time_limit > 0))
+      {
+        rb_raise(rb_eArgError, "timeout must be positive");
+      }
+    }
+  }
+
+  VALUE rb_puzzles = rb_ary_new2(count);
+  Sudoku::Status status = Sudoku::STATUS_OK;
+
+  {
+    std::vector<Generator::Puzzle> puzzles;
+    SearchBudget budget;
+    budget.set_time_limit(time_limit);
+
+    //let other ruby threads run while we are generating (an interrupt cancels the whole batch)
+    sudoku_gem_generate batch = { (std::size_t)n, target_clues, seed, (std::size_t)count,
+                                  threads, &budget, &puzzles, 0 };
+    rb_thread_call_without_gvl(&sudoku_gem_generate_without_gvl, &batch, &sudoku_gem_cancel,
+                               &budget);
+
+    //a batch that was cut short has no use, since its puzzles might not be unique
+    if (batch.made < puzzles.size())
+    {
+      status = Sudoku::STATUS_TIMED_OUT;
+    }
+    else
+    {
+      for (long k = 0; k < count; k++)
+      {
+        rb_ary_push(rb_puzzles, sudoku_gem_puzzle_hash(puzzles[k], format));
+      }
+    }
+  }
+
+  sudoku_gem_check_status(status);
+  return NIL_P(rb_count) ? rb_ary_entry(rb_puzzles, 0) : rb_puzzles;
+}
+
+extern "C"
+VALUE sudoku_gem_set_cache_capacity(VALUE self, VALUE rb_capacity)
+{
+  long capacity = NUM2LONG(rb_capacity);
+
+  if (capacity < 0)
+  {
+    rb_raise(rb_eArgError, "cache capacity must not be negative");
+  }
+
+  sudoku_gem_cache->set_capacity((std::size_t)capacity);
+  return rb_capacity;
+}
+
+extern "C"
+VALUE sudoku_gem_cache_capacity(VALUE self)
+{
+  return SIZET2NUM(sudoku_gem_cache->get_capacity());
+}
 
-  std::string cpp_solution = sudoku.to_s();
+extern "C"
+VALUE sudoku_gem_cache_stats(VALUE self)
+{
+  SolutionCache::Usage usage = sudoku_gem_cache->usage();
+  VALUE rb_stats = rb_hash_new();
+  rb_hash_aset(rb_stats, ID2SYM(rb_intern("hits")), SIZET2NUM(usage.hits));
+  rb_hash_aset(rb_stats, ID2SYM(rb_intern("misses")), SIZET2NUM(usage.misses));
+  rb_hash_aset(rb_stats, ID2SYM(rb_intern("entries")), SIZET2NUM(usage.entries));
+  rb_hash_aset(rb_stats, ID2SYM(rb_intern("bytes")), SIZET2NUM(usage.bytes));
+  return rb_stats;
+}
 
-  return rb_str_new(cpp_solution.c_str(), cpp_solution.length());
+extern "C"
+VALUE sudoku_gem_clear_cache(VALUE self)
+{
+  sudoku_gem_cache->clear();
+  return Qnil;
+}
+
+//cap the memory of every solve, count and batch (see Sudoku::set_memory_limit(): only boards
+//without a specialized kernel use it, and they are searched on a single thread while it is set)
+extern "C"
+VALUE sudoku_gem_set_memory_limit(VALUE self, VALUE rb_limit)
+{
+  long limit = NIL_P(rb_limit) ? 0 : NUM2LONG(rb_limit);
+
+  if (limit < 0)
+  {
+    rb_raise(rb_eArgError, "memory limit must not be negative");
+  }
+
+  sudoku_gem_memory_limit = (std::size_t)limit;
+  return rb_limit;
+}
+
+extern "C"
+VALUE sudoku_gem_memory_limit_value(VALUE self)
+{
+  return SIZET2NUM(sudoku_gem_memory_limit);
 }
 
 extern "C"
 void Init_sudoku_gem()
 {
   VALUE klass = rb_define_class("SudokuGem", rb_cObject);
-  rb_define_singleton_method(klass, "solve", (ruby_method)&sudoku_gem_solve, 1);
+  sudoku_gem_timeout_error = rb_define_class_under(klass, "TimeoutError", rb_eStandardError);
+  rb_define_singleton_method(klass, "solve", (ruby_method)&sudoku_gem_solve, -1);
+  rb_define_singleton_method(klass, "solve_grid", (ruby_method)&sudoku_gem_solve_grid, -1);
+  rb_define_singleton_method(klass, "solve_with_stats",
+                             (ruby_method)&sudoku_gem_solve_with_stats, -1);
+  rb_define_singleton_method(klass, "solve_batch", (ruby_method)&sudoku_gem_solve_batch, -1);
+  rb_define_singleton_method(klass, "solve_grid_batch",
+                             (ruby_method)&sudoku_gem_solve_grid_batch, -1);
+  rb_define_singleton_method(klass, "solve_packed", (ruby_method)&sudoku_gem_solve_packed, -1);
+  rb_define_singleton_method(klass, "pack", (ruby_method)&sudoku_gem_pack, 1);
+  rb_define_singleton_method(klass, "unpack", (ruby_method)&sudoku_gem_unpack, -1);
+  rb_define_singleton_method(klass, "count_solutions",
+                             (ruby_method)&sudoku_gem_count_solutions, -1);
+  rb_define_singleton_method(klass, "generate", (ruby_method)&sudoku_gem_generate_puzzles, -1);
+
+  sudoku_gem_cache = new SolutionCache(0);
+  rb_define_singleton_method(klass, "cache_capacity=",
+                             (ruby_method)&sudoku_gem_set_cache_capacity, 1);
+  rb_define_singleton_method(klass, "cache_capacity", (ruby_method)&sudoku_gem_cache_capacity, 0);
+  rb_define_singleton_method(klass, "cache_stats", (ruby_method)&sudoku_gem_cache_stats, 0);
+  rb_define_singleton_method(klass, "clear_cache", (ruby_method)&sudoku_gem_clear_cache, 0);
+
+  rb_define_singleton_method(klass, "memory_limit=",
+                             (ruby_method)&sudoku_gem_set_memory_limit, 1);
+  rb_define_singleton_method(klass, "memory_limit",
+                             (ruby_method)&sudoku_gem_memory_limit_value, 0);
 }
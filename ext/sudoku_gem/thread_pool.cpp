@@ -0,0 +1,193 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "thread_pool.h"
+
+namespace
+{
+  //the pool and index of the worker that the current thread is, if any
+  thread_local ThreadPool const* worker_pool = 0;
+  thread_local std::size_t worker_index = std::size_t(-1);
+}
+
+ThreadPool::ThreadPool(std::size_t threads) : queued(0), pending(0), next_queue(0),
+  stopping(false)
+{
+  if (threads == 0)
+  {
+    threads = default_size();
+  }
+
+  for (std::size_t k = 0; k < threads; k++)
+  {
+    this->queues.push_back(std::unique_ptr<Queue>(new Queue()));
+  }
+
+  //the deques must all exist before any worker starts looking through them
+  for (std::size_t k = 0; k < threads; k++)
+  {
+    this->threads.push_back(std::thread(&ThreadPool::work, this, k));
+  }
+}
+
+void ThreadPool::submit(Task task)
+{
+  std::size_t index;
+
+  //a worker keeps the tasks it spawns to itself, until somebody steals them
+  if (worker_pool == this)
+  {
+    index = worker_index;
+  }
+  else
+  {
+    index = this->next_queue++ % this->queues.size();
+  }
+
+  this->pending++;
+
+  //bump the count under the lock, so a worker that is about to sleep can't miss it (and before
+  //the task is visible, so a worker that takes it right away can't make the count wrap around)
+  {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->queued++;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(this->queues[index]->lock);
+    this->queues[index]->tasks.push_back(std::move(task));
+  }
+
+  this->wake.notify_one();
+}
+
+void ThreadPool::wait()
+{
+  std::unique_lock<std::mutex> guard(this->lock);
+
+  while (this->pending != 0)
+  {
+    this->idle.wait(guard);
+  }
+}
+
+bool ThreadPool::take(std::size_t index, Task& task)
+{
+  const std::size_t count = this->queues.size();
+
+  //our own newest task first, since it's the most likely to still be in the cache
+  {
+    Queue& own = *this->queues[index];
+    std::lock_guard<std::mutex> guard(own.lock);
+
+    if (!own.tasks.empty())
+    {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  //then the oldest task of everybody else, since it's the most likely to be a big one
+  for (std::size_t k = 1; k < count; k++)
+  {
+    Queue& other = *this->queues[(index + k) % count];
+    std::lock_guard<std::mutex> guard(other.lock);
+
+    if (!other.tasks.empty())
+    {
+      task = std::move(other.tasks.front());
+      other.tasks.pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::work(std::size_t index)
+{
+  worker_pool = this;
+  worker_index = index;
+
+  for (;;)
+  {
+    Task task;
+
+    if (this->take(index, task))
+    {
+      this->queued--;
+      task();
+
+      //the last task to finish lets wait() return
+      if (--this->pending == 0)
+      {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->idle.notify_all();
+      }
+
+      continue;
+    }
+
+    std::unique_lock<std::mutex> guard(this->lock);
+
+    //sleep until there is something to take (it might already be gone by the time we look)
+    while (!this->stopping && this->queued == 0)
+    {
+      this->wake.wait(guard);
+    }
+
+    if (this->stopping && this->queued == 0)
+    {
+      return;
+    }
+  }
+}
+
+std::size_t ThreadPool::size() const
+{
+  return this->threads.size();
+}
+
+std::size_t ThreadPool::current_worker()
+{
+  return worker_index;
+}
+
+std::size_t ThreadPool::default_size()
+{
+  std::size_t threads = std::thread::hardware_concurrency();
+  return (threads == 0) ? 1 : threads;
+}
+
+ThreadPool::~ThreadPool()
+{
+  this->wait();
+
+  {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->stopping = true;
+  }
+
+  this->wake.notify_all();
+
+  for (std::size_t k = 0; k < this->threads.size(); k++)
+  {
+    this->threads[k].join();
+  }
+}
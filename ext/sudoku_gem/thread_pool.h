@@ -0,0 +1,171 @@
+/*
+ *  Sudoku Base - a library for solving Sudoku puzzles
+ *  Copyright (C) 2013  Neal Patel <nealp9084@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A fixed set of worker threads that run tasks, with work stealing
+ *
+ * Every worker has its own deque of tasks. A worker runs the newest task of its own deque first,
+ * and when its deque is empty, it steals the oldest task of another worker's deque. Tasks that are
+ * submitted by a worker go to the back of that worker's deque, and tasks that are submitted from
+ * any other thread are dealt out to the workers in turn, so a batch of uneven tasks ends up spread
+ * over every worker, no matter which ones finish early.
+ *
+ * A task must not throw, and it must not call wait() on the pool that is running it.
+ **/
+class ThreadPool
+{
+public:
+  /**
+   * @brief A unit of work for the pool.
+   **/
+  typedef std::function<void()> Task;
+
+  /**
+   * @brief Constructor for a ThreadPool instance, which starts the workers
+   *
+   * @param threads The number of workers. If this is 0, then there is one worker per hardware
+   *                thread (see default_size()).
+   **/
+  explicit ThreadPool(std::size_t threads = 0);
+  /**
+   * @brief Destructor for a ThreadPool instance, which waits for every task that was submitted and
+   *        then stops the workers.
+   **/
+  virtual ~ThreadPool();
+
+  /**
+   * @brief Queue up a task to be run by one of the workers.
+   *
+   * @param task The task.
+   **/
+  void submit(Task task);
+  /**
+   * @brief Block until every task that was submitted (including the tasks submitted by those
+   *        tasks) has finished.
+   **/
+  void wait();
+
+  /**
+   * @brief Accessor for the number of workers
+   *
+   * @return std::size_t The number of workers.
+   **/
+  std::size_t size() const;
+  /**
+   * @brief Find out which worker of its pool the current thread is
+   *
+   * @return std::size_t The index of the worker (between 0 and size() - 1), or size_t(-1) if the
+   *         current thread is not a worker.
+   **/
+  static std::size_t current_worker();
+  /**
+   * @brief The number of workers a pool has by default
+   *
+   * @return std::size_t The number of hardware threads, or 1 if that is not known.
+   **/
+  static std::size_t default_size();
+
+private:
+  /**
+   * @brief The tasks of a single worker
+   **/
+  struct Queue
+  {
+    /**
+     * @brief The lock that protects the deque.
+     **/
+    std::mutex lock;
+    /**
+     * @brief The tasks, with the newest task at the back.
+     **/
+    std::deque<Task> tasks;
+  };
+
+  ThreadPool(ThreadPool const&);
+  ThreadPool& operator=(ThreadPool const&);
+
+  /**
+   * @brief Helper method that every worker runs until the pool is stopped.
+   *
+   * @param index The index of the worker.
+   **/
+  void work(std::size_t index);
+  /**
+   * @brief Helper method for taking a task, either from the back of the worker's own deque or
+   *        from the front of another worker's deque.
+   *
+   * @param index The index of the worker that is looking for a task.
+   * @param task Overwritten with the task, if one was found.
+   * @return bool Whether a task was found.
+   **/
+  bool take(std::size_t index, Task& task);
+
+  /**
+   * @brief The deques of the workers, one per worker.
+   **/
+  std::vector<std::unique_ptr<Queue> > queues;
+  /**
+   * @brief The workers.
+   **/
+  std::vector<std::thread> threads;
+
+  /**
+   * @brief The lock that the sleeping workers and wait() use.
+   **/
+  std::mutex lock;
+  /**
+   * @brief Signalled when a task is queued up, or when the pool is stopped.
+   **/
+  std::condition_variable wake;
+  /**
+   * @brief Signalled when the last unfinished task finishes.
+   **/
+  std::condition_variable idle;
+
+  /**
+   * @brief The number of tasks that are sitting in the deques.
+   **/
+  std::atomic<std::size_t> queued;
+  /**
+   * @brief The number of tasks that have been submitted, but have not finished yet.
+   **/
+  std::atomic<std::size_t> pending;
+  /**
+   * @brief The worker that the next task from outside the pool goes to.
+   **/
+  std::atomic<std::size_t> next_queue;
+  /**
+   * @brief Whether the workers should stop.
+   **/
+  bool stopping;
+};
+
+#endif // THREAD_POOL_H
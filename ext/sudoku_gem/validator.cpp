@@ -15,128 +15,42 @@
  *  You should have received a copy of the GNU General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
-
 #include "validator.h"
 
-bool Validator::is_good_row(Grid const& cur_grid, std::size_t y)
-{
-  const std::size_t n = cur_grid.n();
-  std::uint_fast64_t mask = 0, valid_mask = (1 << n) - 1;
-
-  for (std::size_t x = 0; x < n; x++)
-  {
-    int a = cur_grid.get(x, y);
+#include <cmath>
+#include <cstring>
 
-    //reject rows that are incomplete or have duplicates
-    if ((a == -1) || ((mask & (1 << (a - 1))) != 0))
-    {
-      return false;
-    }
-    else
-    {
-      mask |= (1 << (a - 1));
-    }
-  }
+#if !defined(SUDOKU_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SUDOKU_AVX2 1
+#include <immintrin.h>
+#endif
 
-  return (mask == valid_mask);
-}
-
-bool Validator::is_good_column(Grid const& cur_grid, std::size_t x)
+namespace
 {
-  const std::size_t n = cur_grid.n();
-  std::uint_fast64_t mask = 0, valid_mask = (1 << n) - 1;
-
-  for (std::size_t y = 0; y < n; y++)
+  //whether the processor has AVX2 (it is only asked once)
+  bool have_avx2()
   {
-    int a = cur_grid.get(x, y);
-
-    //reject cols that are incomplete or have duplicates
-    if ((a == -1) || ((mask & (1 << (a - 1))) != 0))
-    {
-      return false;
-    }
-    else
-    {
-      mask |= (1 << (a - 1));
-    }
+#ifdef SUDOKU_AVX2
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
   }
-
-  return (mask == valid_mask);
-}
-
-bool Validator::is_good_block(Grid const& cur_grid, std::size_t x, std::size_t y)
-{
-  const std::size_t n = cur_grid.n(), n_root = std::size_t(sqrt(n) + 0.5);
-  std::uint_fast64_t mask = 0, valid_mask = (1 << n) - 1;
-
-  for (std::size_t y_off = 0; y_off < n_root; y_off++)
-  {
-    for (std::size_t x_off = 0; x_off < n_root; x_off++)
-    {
-      int a = cur_grid.get(x + x_off, y + y_off);
-
-      //reject blocks that are incomplete or have duplicates
-      if ((a == -1) || ((mask & (1 << (a - 1))) != 0))
-      {
-        return false;
-      }
-      else
-      {
-        mask |= (1 << (a - 1));
-      }
-    }
-  }
-
-  return (mask == valid_mask);
-}
-
-bool Validator::is_good_board(Grid const& cur_grid)
-{
-  const std::size_t n = cur_grid.n(), n_root = std::size_t(sqrt(n) + 0.5);
-
-  for (std::size_t y = 0; y < n; y++)
-  {
-    if (!is_good_row(cur_grid, y))
-    {
-      return false;
-    }
-  }
-
-  for (std::size_t x = 0; x < n; x++)
-  {
-    if (!is_good_column(cur_grid, x))
-    {
-      return false;
-    }
-  }
-
-  for (std::size_t x = 0; x < n_root; x++)
-  {
-    for (std::size_t y = 0; y < n_root; y++)
-    {
-      if (!is_good_block(cur_grid, x * n_root, y * n_root))
-      {
-        return false;
-      }
-    }
-  }
-
-  return true;
 }
 
 std::uint_fast64_t Validator::row_colors(Grid const& cur_grid, std::size_t y)
 {
   const std::size_t n = cur_grid.n();
+  std::uint8_t const* row = cur_grid.data() + y * n;
   std::uint_fast64_t mask = 0;
 
   for (std::size_t x = 0; x < n; x++)
   {
-    int a = cur_grid.get(x, y);
-
     //ignore incomplete elements
-    if (a != -1)
+    if (row[x] != 0)
     {
-      mask |= (1 << (a - 1));
+      mask |= color_bit<std::uint_fast64_t>(row[x]);
     }
   }
 
@@ -146,16 +60,15 @@ std::uint_fast64_t Validator::row_colors(Grid const& cur_grid, std::size_t y)
 std::uint_fast64_t Validator::column_colors(Grid const& cur_grid, std::size_t x)
 {
   const std::size_t n = cur_grid.n();
+  std::uint8_t const* column = cur_grid.data() + x;
   std::uint_fast64_t mask = 0;
 
   for (std::size_t y = 0; y < n; y++)
   {
-    int a = cur_grid.get(x, y);
-
     //ignore incomplete elements
-    if (a != -1)
+    if (column[y * n] != 0)
     {
-      mask |= (1 << (a - 1));
+      mask |= color_bit<std::uint_fast64_t>(column[y * n]);
     }
   }
 
@@ -169,14 +82,14 @@ std::uint_fast64_t Validator::block_colors(Grid const& cur_grid, std::size_t x,
 
   for (std::size_t y_off = 0; y_off < n_root; y_off++)
   {
+    std::uint8_t const* row = cur_grid.data() + (y + y_off) * n + x;
+
     for (std::size_t x_off = 0; x_off < n_root; x_off++)
     {
-      int a = cur_grid.get(x + x_off, y + y_off);
-
       //ignore incomplete elements
-      if (a != -1)
+      if (row[x_off] != 0)
       {
-        mask |= (1 << (a - 1));
+        mask |= color_bit<std::uint_fast64_t>(row[x_off]);
       }
     }
   }
@@ -188,7 +101,7 @@ bool Validator::is_good_color(Grid const& cur_grid, std::size_t x, std::size_t y
 {
   const std::size_t n = cur_grid.n(), n_root = std::size_t(sqrt(n) + 0.5);
 
-  int bit = (1 << (i - 1));
+  std::uint_fast64_t bit = color_bit<std::uint_fast64_t>(i);
   std::uint_fast64_t row_mask = row_colors(cur_grid, y),
     col_mask = column_colors(cur_grid, x),
     block_mask = block_colors(cur_grid, (x / n_root) * n_root, (y / n_root) * n_root);
@@ -204,123 +117,268 @@ std::uint_fast64_t Validator::good_colors(Grid const& cur_grid, std::size_t x, s
     col_mask = column_colors(cur_grid, x),
     block_mask = block_colors(cur_grid, (x / n_root) * n_root, (y / n_root) * n_root);
 
-  return (~(row_mask | col_mask | block_mask)) & ((1 << n) - 1);
+  return (~(row_mask | col_mask | block_mask)) & all_colors<std::uint_fast64_t>(n);
 }
 
-bool Validator::is_good_partial_row(Grid const& cur_grid, std::size_t y)
+bool Validator::scan_scalar(Grid const& cur_grid, std::uint64_t* rows, std::uint64_t* columns,
+                            std::uint64_t* blocks, std::size_t& known)
 {
-  const std::size_t n = cur_grid.n();
-  std::uint_fast64_t mask = 0;
+  const std::size_t n = cur_grid.n(), n_root = std::size_t(sqrt(n) + 0.5);
+  std::uint8_t const* cells = cur_grid.data();
 
-  for (std::size_t x = 0; x < n; x++)
+  std::memset(rows, 0, n * sizeof(std::uint64_t));
+  std::memset(columns, 0, n * sizeof(std::uint64_t));
+  std::memset(blocks, 0, n * sizeof(std::uint64_t));
+  known = 0;
+
+  for (std::size_t y = 0; y < n; y++)
   {
-    int a = cur_grid.get(x, y);
+    std::uint64_t* band = blocks + (y / n_root) * n_root;
 
-    //ignore incomplete elements
-    if (a != -1)
+    for (std::size_t x = 0; x < n; x++)
     {
-      //reject rows that have duplicates
-      if ((mask & (1 << (a - 1))) != 0)
+      const std::uint8_t a = cells[y * n + x];
+
+      //ignore incomplete elements
+      if (a == 0)
       {
-        return false;
+        continue;
       }
-      else
+
+      const std::uint64_t bit = color_bit<std::uint64_t>(a);
+      std::uint64_t& block = band[x / n_root];
+
+      //reject boards that have duplicates
+      if (((rows[y] | columns[x] | block) & bit) != 0)
       {
-        mask |= (1 << (a - 1));
+        return false;
       }
+
+      rows[y] |= bit;
+      columns[x] |= bit;
+      block |= bit;
+      known++;
     }
   }
 
   return true;
 }
 
-bool Validator::is_good_partial_column(Grid const& cur_grid, std::size_t x)
+#ifdef SUDOKU_AVX2
+
+namespace
 {
-  const std::size_t n = cur_grid.n();
-  std::uint_fast64_t mask = 0;
+  //the colors of all eight 32-bit lanes of a vector, or'ed together
+  __attribute__((target("avx2"))) inline std::uint32_t or_lanes(__m256i bits)
+  {
+    __m128i half = _mm_or_si128(_mm256_castsi256_si128(bits), _mm256_extracti128_si256(bits, 1));
+    half = _mm_or_si128(half, _mm_shuffle_epi32(half, 0x4e));
+    half = _mm_or_si128(half, _mm_shuffle_epi32(half, 0xb1));
+    return std::uint32_t(_mm_cvtsi128_si32(half));
+  }
 
-  for (std::size_t y = 0; y < n; y++)
+  //check that the lanes of a band (or of the whole board) have no more known cells than colors,
+  //n_root lanes at a time, and write out their masks
+  template <std::size_t Chunks>
+  __attribute__((target("avx2")))
+  inline bool fold_lanes(__m256i const* bits, __m256i const* counts, std::size_t n,
+                         std::size_t group, std::uint64_t* masks)
   {
-    int a = cur_grid.get(x, y);
+    alignas(32) std::uint32_t lane_bits[8 * Chunks];
+    alignas(32) std::uint32_t lane_counts[8 * Chunks];
 
-    //ignore incomplete elements
-    if (a != -1)
+    for (std::size_t c = 0; c < Chunks; c++)
+    {
+      _mm256_store_si256((__m256i*)(lane_bits + 8 * c), bits[c]);
+      _mm256_store_si256((__m256i*)(lane_counts + 8 * c), counts[c]);
+    }
+
+    for (std::size_t first = 0; first < n; first += group)
     {
-      //reject cols that have duplicates
-      if ((mask & (1 << (a - 1))) != 0)
+      std::uint32_t mask = 0, count = 0;
+
+      for (std::size_t x = first; x < first + group; x++)
       {
-        return false;
+        mask |= lane_bits[x];
+        count += lane_counts[x];
       }
-      else
+
+      if (std::uint32_t(count_colors(mask)) != count)
       {
-        mask |= (1 << (a - 1));
+        return false;
       }
+
+      *masks++ = mask;
     }
+
+    return true;
   }
 
-  return true;
-}
+  //the scan of a board whose rows fit in the given number of 8-lane vectors, which is a template
+  //so that the vectors stay in registers instead of in arrays on the stack
+  template <std::size_t Chunks>
+  __attribute__((target("avx2")))
+  bool scan_lanes(std::uint8_t const* cells, std::size_t n, std::size_t n_root,
+                  std::uint64_t* rows, std::uint64_t* columns, std::uint64_t* blocks,
+                  std::size_t& known)
+  {
+    //every row is read as 32 cells, and the ones past its end are masked off (the last few rows
+    //would be read past the end of the board, so they are copied into a buffer first)
+    alignas(32) std::uint8_t tail[32] = { 0 };
 
-bool Validator::is_good_partial_block(Grid const& cur_grid, std::size_t x, std::size_t y)
-{
-  const std::size_t n = cur_grid.n(), n_root = std::size_t(sqrt(n) + 0.5);
-  std::uint_fast64_t mask = 0;
+    const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi32(1);
+    const std::uint32_t row_lanes = (n >= 32) ? ~std::uint32_t(0) : ((std::uint32_t(1) << n) - 1);
+    __m256i column_bits[Chunks], column_counts[Chunks], band_bits[Chunks], band_counts[Chunks];
+    __m256i in_row[Chunks];
 
-  for (std::size_t y_off = 0; y_off < n_root; y_off++)
-  {
-    for (std::size_t x_off = 0; x_off < n_root; x_off++)
+    for (std::size_t c = 0; c < Chunks; c++)
     {
-      int a = cur_grid.get(x + x_off, y + y_off);
+      column_bits[c] = column_counts[c] = band_bits[c] = band_counts[c] = zero;
+      in_row[c] = _mm256_cmpgt_epi32(_mm256_set1_epi32(int(n)),
+                                     _mm256_add_epi32(_mm256_set1_epi32(int(8 * c)),
+                                                      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+    }
 
-      //ignore incomplete elements
-      if (a != -1)
+    known = 0;
+
+    for (std::size_t y = 0, band_row = 1; y < n; y++, band_row++)
+    {
+      std::uint8_t const* row = cells + y * n;
+
+      if (y * n + 32 > n * n)
       {
-        //reject blocks that have duplicates
-        if ((mask & (1 << (a - 1))) != 0)
+        for (std::size_t x = 0; x < n; x++)
+        {
+          tail[x] = row[x];
+        }
+
+        row = tail;
+      }
+
+      __m256i row_bits = zero;
+
+      for (std::size_t c = 0; c < Chunks; c++)
+      {
+        //a shift by 32 or more gives 0, so an unknown cell (whose shift wraps around) has no color
+        const __m256i values = _mm256_and_si256(
+          _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const*)(row + 8 * c))), in_row[c]);
+        const __m256i bits = _mm256_sllv_epi32(one, _mm256_sub_epi32(values, one));
+        const __m256i is_known = _mm256_cmpgt_epi32(values, zero);
+
+        row_bits = _mm256_or_si256(row_bits, bits);
+        column_bits[c] = _mm256_or_si256(column_bits[c], bits);
+        band_bits[c] = _mm256_or_si256(band_bits[c], bits);
+
+        //the comparison gives -1 for a known cell, so subtracting it counts the cell
+        column_counts[c] = _mm256_sub_epi32(column_counts[c], is_known);
+        band_counts[c] = _mm256_sub_epi32(band_counts[c], is_known);
+      }
+
+      const std::uint32_t unknown = std::uint32_t(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const*)row), zero)));
+      const int row_count = count_colors(~unknown & row_lanes);
+      const std::uint32_t row_mask = or_lanes(row_bits);
+
+      //a unit with more known cells than colors has a repeated value
+      if (count_colors(row_mask) != row_count)
+      {
+        return false;
+      }
+
+      rows[y] = row_mask;
+      known += row_count;
+
+      //at the end of a band, its columns are folded into its blocks
+      if (band_row == n_root)
+      {
+        if (!fold_lanes<Chunks>(band_bits, band_counts, n, n_root, blocks + (y / n_root) * n_root))
         {
           return false;
         }
-        else
+
+        for (std::size_t c = 0; c < Chunks; c++)
         {
-          mask |= (1 << (a - 1));
+          band_bits[c] = band_counts[c] = zero;
         }
+
+        band_row = 0;
       }
     }
-  }
 
-  return true;
+    return fold_lanes<Chunks>(column_bits, column_counts, n, 1, columns);
+  }
 }
 
-bool Validator::is_good_partial_board(Grid const& cur_grid)
+bool Validator::scan_avx2(Grid const& cur_grid, std::uint64_t* rows, std::uint64_t* columns,
+                          std::uint64_t* blocks, std::size_t& known)
 {
   const std::size_t n = cur_grid.n(), n_root = std::size_t(sqrt(n) + 0.5);
 
-  for (std::size_t y = 0; y < n; y++)
+  //the only sizes between 8 and 32 are 9*9, 16*16 and 25*25
+  if (n <= 16)
   {
-    if (!is_good_partial_row(cur_grid, y))
-    {
-      return false;
-    }
+    return scan_lanes<2>(cur_grid.data(), n, n_root, rows, columns, blocks, known);
   }
+  else
+  {
+    return scan_lanes<4>(cur_grid.data(), n, n_root, rows, columns, blocks, known);
+  }
+}
 
-  for (std::size_t x = 0; x < n; x++)
+#else
+
+bool Validator::scan_avx2(Grid const& cur_grid, std::uint64_t* rows, std::uint64_t* columns,
+                          std::uint64_t* blocks, std::size_t& known)
+{
+  return scan_scalar(cur_grid, rows, columns, blocks, known);
+}
+
+#endif
+
+bool Validator::board_masks(Grid const& cur_grid, std::uint64_t* rows, std::uint64_t* columns,
+                            std::uint64_t* blocks, std::size_t* known)
+{
+  std::size_t count;
+
+  //an 8-lane scan only pays off once a row fills most of a vector
+  const bool vectorized = (cur_grid.n() >= 8 && cur_grid.n() <= 32 && have_avx2());
+  const bool good = vectorized ? scan_avx2(cur_grid, rows, columns, blocks, count)
+                               : scan_scalar(cur_grid, rows, columns, blocks, count);
+
+  if (known != 0)
   {
-    if (!is_good_partial_column(cur_grid, x))
-    {
-      return false;
-    }
+    *known = count;
+  }
+
+  return good;
+}
+
+bool Validator::is_good_board(Grid const& cur_grid)
+{
+  const std::size_t n = cur_grid.n();
+  std::uint64_t rows[64], columns[64], blocks[64];
+  std::size_t known;
+
+  if (!board_masks(cur_grid, rows, columns, blocks, &known) || known != n * n)
+  {
+    return false;
   }
 
-  for (std::size_t x = 0; x < n_root; x++)
+  //with no repeats, a full row has n different values, so it only has to be checked for values
+  //past n (and then so do the columns and blocks)
+  for (std::size_t y = 0; y < n; y++)
   {
-    for (std::size_t y = 0; y < n_root; y++)
+    if (rows[y] != all_colors<std::uint64_t>(n))
     {
-      if (!is_good_partial_block(cur_grid, x * n_root, y * n_root))
-      {
-        return false;
-      }
+      return false;
     }
   }
 
   return true;
 }
+
+bool Validator::is_good_partial_board(Grid const& cur_grid)
+{
+  std::uint64_t rows[64], columns[64], blocks[64];
+  return board_masks(cur_grid, rows, columns, blocks);
+}
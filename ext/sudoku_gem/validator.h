@@ -22,8 +22,20 @@
 #include <cstdint>
 #include <cstddef>
 
+#include "color_mask.h"
 #include "grid.h"
 
+/**
+ * @brief A set of checks on Sudoku boards
+ *
+ * The whole-board checks (is_good_board(), is_good_partial_board() and board_masks()) make a
+ * single pass over the cells, building the masks of every row, column and block as they go. A
+ * unit has a repeated value exactly when it has more known values than its mask has colors, so
+ * the checks only need the masks and a count of the known values per unit. On x86 processors
+ * with AVX2, boards up to 32*32 are scanned eight cells at a time (the processor is asked once,
+ * at runtime, so the library itself doesn't need to be built for AVX2); everything else uses the
+ * scalar scan. Define SUDOKU_NO_SIMD to compile the AVX2 scan out.
+ **/
 class Validator
 {
 public:
@@ -39,34 +51,7 @@ public:
    * @return bool Whether that puzzle has been solved.
    **/
   static bool is_good_board(Grid const& cur_grid);
-private:
-  /**
-   * @brief Helper function for the above task.
-   *
-   * @param cur_board A Sudoku puzzle board.
-   * @param y The index for a particular row.
-   * @return bool Whether the 1*n row contains no repeated or undetermined elements.
-   **/
-  static bool is_good_row(Grid const& cur_grid, std::size_t y);
-  /**
-   * @brief Helper function for the above task.
-   *
-   * @param cur_board A Sudoku puzzle board.
-   * @param x The index for a particular column.
-   * @return bool Whether the n*1 column contains no repeated or undetermined elements.
-   **/
-  static bool is_good_column(Grid const& cur_grid, std::size_t x);
-  /**
-   * @brief Helper function for the above task.
-   *
-   * @param cur_board A Sudoku puzzle board.
-   * @param x The index for a particular starting row. Must be a multiple of 3.
-   * @param y The index for a particular starting column.  Must be a multiple of 3.
-   * @return bool Whether the sqrt(n)*sqrt(n) block contains no repeated or undetermined elements.
-   **/
-  static bool is_good_block(Grid const& cur_grid, std::size_t x, std::size_t y);
 
-public:
   /**
    * @brief Tells you whether you can color a certain node in a certain way (i.e., is it okay to use
    *        a particular number in this Sudoku cell?)
@@ -97,6 +82,21 @@ public:
    * @return uint_fast64_t The various colors (numbers) you may use, encoded using the above scheme.
    **/
   static std::uint_fast64_t good_colors(Grid const& cur_grid, std::size_t x, std::size_t y);
+  /**
+   * @brief Find the colors that every row, column and block of a board uses, all at once. The
+   *        colors that a cell may use are then the ones that none of its units use, which is much
+   *        cheaper than calling good_colors() for every cell.
+   *
+   * @param cur_board A Sudoku puzzle board.
+   * @param rows Overwritten with the mask of every row (n of them).
+   * @param columns Overwritten with the mask of every column (n of them).
+   * @param blocks Overwritten with the mask of every block (n of them, in row-major order).
+   * @param known Overwritten with the number of cells that have a value, if this is not NULL.
+   *              Defaults to NULL.
+   * @return bool Whether no unit has a repeated value. If it has, the masks are unspecified.
+   **/
+  static bool board_masks(Grid const& cur_grid, std::uint64_t* rows, std::uint64_t* columns,
+                          std::uint64_t* blocks, std::size_t* known = 0);
 private:
   /**
    * @brief Helper function for the above task. Tells you which colors have been used.
@@ -123,6 +123,31 @@ private:
    * @return int Which colors are used by that particular sqrt(n)*sqrt(n) block.
    **/
   static std::uint_fast64_t block_colors(Grid const& cur_grid, std::size_t x, std::size_t y);
+  /**
+   * @brief Helper function for board_masks(), which scans the board one cell at a time.
+   *
+   * @param cur_board A Sudoku puzzle board.
+   * @param rows Overwritten with the mask of every row.
+   * @param columns Overwritten with the mask of every column.
+   * @param blocks Overwritten with the mask of every block.
+   * @param known Overwritten with the number of cells that have a value.
+   * @return bool Whether no unit has a repeated value.
+   **/
+  static bool scan_scalar(Grid const& cur_grid, std::uint64_t* rows, std::uint64_t* columns,
+                          std::uint64_t* blocks, std::size_t& known);
+  /**
+   * @brief Helper function for board_masks(), which scans the board eight cells at a time with
+   *        AVX2. It must only be called on a processor that has AVX2, and on boards up to 32*32.
+   *
+   * @param cur_board A Sudoku puzzle board.
+   * @param rows Overwritten with the mask of every row.
+   * @param columns Overwritten with the mask of every column.
+   * @param blocks Overwritten with the mask of every block.
+   * @param known Overwritten with the number of cells that have a value.
+   * @return bool Whether no unit has a repeated value.
+   **/
+  static bool scan_avx2(Grid const& cur_grid, std::uint64_t* rows, std::uint64_t* columns,
+                        std::uint64_t* blocks, std::size_t& known);
 
 public:
   /**
@@ -140,32 +165,6 @@ public:
    * @return bool Whether the given board has any solutions.
    **/
   static bool is_good_partial_board(Grid const& cur_grid);
-private:
-  /**
-   * @brief Helper function for the above task.
-   *
-   * @param cur_board A Sudoku puzzle board.
-   * @param y The index for a particular row.
-   * @return bool Whether the given 1*n row has any repeated elements.
-   **/
-  static bool is_good_partial_row(Grid const& cur_grid, std::size_t y);
-  /**
-   * @brief Helper function for the above task.
-   *
-   * @param cur_board A Sudoku puzzle board.
-   * @param x The index for a particular column.
-   * @return bool Whether the given n*1 column has any repeated elements.
-   **/
-  static bool is_good_partial_column(Grid const& cur_grid, std::size_t x);
-  /**
-   * @brief Helper function for the above task.
-   *
-   * @param cur_board A Sudoku puzzle board.
-   * @param x The index for a particular starting row. Must be a multiple of 3.
-   * @param y The index for a particular starting column.  Must be a multiple of 3.
-   * @return bool Whether the given sqrt(n)*sqrt(n) block has any repeated elements.
-   **/
-  static bool is_good_partial_block(Grid const& cur_grid, std::size_t x, std::size_t y);
 };
 
 #endif // VALIDATOR_H
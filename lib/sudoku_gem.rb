@@ -1,13 +1,11 @@
 require 'sudoku_gem/sudoku_gem'
 
 class SudokuGem
-  def self.solution_for(puzzle)
-    text = self.solve(puzzle)
+  def self.solution_for(puzzle, threads = nil, **limits)
+    self.solve_grid(puzzle, threads, **limits)
+  end
 
-    if text
-      return text.split("\n").map { |x| x.split(' ').map{ |y| y.to_i } }
-    else
-      return nil
-    end
+  def self.solutions_for(puzzles, threads = nil, **limits)
+    self.solve_grid_batch(puzzles, threads, **limits)
   end
 end